@@ -11,9 +11,19 @@
 
 #include <map>
 #include <tuple>
+#include <utility>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <list>
+#include <memory>
 #include <functional>
+#include <chrono>
+#include <algorithm>
+#include <thread>
 
 #include "minilua.hpp"
 
@@ -22,6 +32,8 @@
 #include "lxeAttributes.hpp"
 #include "lxeParser.hpp"
 #include "lxeScriptEngine.hpp"
+#include "lxeQuery.hpp"
+#include "lxeAsync.hpp"
 #include "lxeEngine.hpp"
 
 
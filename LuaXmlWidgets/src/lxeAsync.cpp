@@ -0,0 +1,253 @@
+//
+//  lxeAsync.cpp
+//  LuaXmlWidgets
+//
+
+#include "lxe.hpp"
+#include <cstdio>
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+
+using namespace lxe;
+
+AsyncTasks::AsyncTasks(Engine*engine) {
+    this->engine=engine;
+    lifetime=std::make_shared<AsyncTasks*>(this);
+}
+
+void AsyncTasks::start(DomElement*owner, const TagAttribute&handler) {
+    LuaCoroutine coroutine;
+    if(handler.getType()==TA_FUNCTION) {
+        coroutine=engine->getLua()->functionRefCoroutine(handler.getFunctionRef());
+    } else if(handler.getType()==TA_STRING) {
+        coroutine=engine->getLua()->globalFunctionCoroutine(handler.getString());
+    } else {
+        throw RuntimeException(wxString::Format("Cannot execute attribute as function. Attribute type is %d", handler.getType()));
+    }
+    long long taskId=++taskIdGenerator;
+    Task&task=tasks[taskId];
+    task.id=taskId;
+    task.coroutine=coroutine;
+    task.owner=owner;
+    tasksByThread[coroutine.thread]=taskId;
+    resume(taskId);
+}
+
+void AsyncTasks::resume(long long taskId) {
+    auto it=tasks.find(taskId);
+    if(it==tasks.end()) return;
+    //nodes of unordered_map are stable, task started by this one does not move it
+    Task&task=it->second;
+    int operationId=task.awaitedOperation;
+    std::function<void(ValuesListWriter*)>results;
+    auto operation=operations.find(operationId);
+    if(operationId!=0) {
+        if(operation==operations.end() || !operation->second.completed) return;
+        task.awaitedOperation=0;
+        results=[&operation](ValuesListWriter*writer) {
+            AsyncResult&result=operation->second.result;
+            if(operation->second.type==ASYNC_TIMER) return;
+            if(!result.errorMessage.IsEmpty()) {
+                writer->pushNil();
+                writer->pushString(result.errorMessage);
+                return;
+            }
+            writer->pushBytes(result.output);
+            if(operation->second.type==ASYNC_PROCESS_OUTPUT) writer->pushInt(result.exitCode);
+        };
+    }
+    wxString errorMessage;
+    task.running=true;
+    auto start=std::chrono::steady_clock::now();
+    engine->getGcScheduler().beginEvent();
+    int status=engine->getLua()->resumeCoroutine(task.coroutine, results, errorMessage);
+    engine->getGcScheduler().endEvent();
+    task.runMilliseconds+=std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-start).count();
+    task.running=false;
+    if(operationId!=0) {
+        operations.erase(operationId);
+        task.operations.erase(std::remove(task.operations.begin(), task.operations.end(), operationId), task.operations.end());
+    }
+    if(status==LUA_YIELD && !task.cancelled && task.awaitedOperation==0) {
+        status=LUA_ERRRUN;
+        errorMessage="Event handler yielded outside of lxe.await";
+    }
+    if(status!=LUA_OK && status!=LUA_YIELD) {
+        wxPrintf("Lua error in event handler. Message: %s\n", errorMessage);
+    }
+    if(status!=LUA_YIELD || task.cancelled) {
+        release(taskId);
+        return;
+    }
+    //operation completed before the task awaited it
+    if(operations.find(task.awaitedOperation)->second.completed) {
+        std::weak_ptr<AsyncTasks*>weakLifetime=lifetime;
+        engine->getIdleScheduler()([weakLifetime, taskId]() {
+            std::shared_ptr<AsyncTasks*>tasks=weakLifetime.lock();
+            if(tasks) (*tasks)->resume(taskId);
+        });
+    }
+}
+
+void AsyncTasks::release(long long taskId) {
+    auto it=tasks.find(taskId);
+    if(it==tasks.end()) return;
+    Task&task=it->second;
+    engine->getGcScheduler().addHandlerDuration(task.runMilliseconds);
+    for(int operationId: task.operations) {
+        operations.erase(operationId);
+    }
+    tasksByThread.erase(task.coroutine.thread);
+    engine->getLua()->releaseCoroutine(task.coroutine);
+    tasks.erase(it);
+}
+
+long long AsyncTasks::findTaskId(lua_State*thread) {
+    auto it=tasksByThread.find(thread);
+    return it==tasksByThread.end()?0:it->second;
+}
+
+int AsyncTasks::addOperation(lua_State*thread, AsyncOperationType type) {
+    long long taskId=findTaskId(thread);
+    if(taskId==0) {
+        throw RuntimeException("Async operations are available only in event handlers");
+    }
+    if(!engine->getIdleScheduler()) {
+        throw RuntimeException("Async operations need idle scheduler of the engine");
+    }
+    int operationId=++operationIdGenerator;
+    Operation&operation=operations[operationId];
+    operation.type=type;
+    operation.taskId=taskId;
+    tasks[taskId].operations.push_back(operationId);
+    return operationId;
+}
+
+std::function<void(AsyncResult result)>AsyncTasks::completionPoster(int operationId) {
+    std::weak_ptr<AsyncTasks*>weakLifetime=lifetime;
+    //copied, worker thread must not touch the engine
+    std::function<void(std::function<void()>)>idleScheduler=engine->getIdleScheduler();
+    return [weakLifetime, idleScheduler, operationId](AsyncResult result) {
+        idleScheduler([weakLifetime, operationId, result]() {
+            std::shared_ptr<AsyncTasks*>tasks=weakLifetime.lock();
+            if(tasks) (*tasks)->complete(operationId, result);
+        });
+    };
+}
+
+int AsyncTasks::startTimer(lua_State*thread, int milliseconds) {
+    int operationId=addOperation(thread, ASYNC_TIMER);
+    if(timerScheduler) {
+        std::weak_ptr<AsyncTasks*>weakLifetime=lifetime;
+        timerScheduler(milliseconds, [weakLifetime, operationId]() {
+            std::shared_ptr<AsyncTasks*>tasks=weakLifetime.lock();
+            if(tasks) (*tasks)->complete(operationId, AsyncResult());
+        });
+        return operationId;
+    }
+    std::function<void(AsyncResult)>post=completionPoster(operationId);
+    std::thread([post, milliseconds]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+        post(AsyncResult());
+    }).detach();
+    return operationId;
+}
+
+int AsyncTasks::startFileRead(lua_State*thread, const wxString&path) {
+    int operationId=addOperation(thread, ASYNC_FILE_READ);
+    std::function<void(AsyncResult)>post=completionPoster(operationId);
+    std::string utf8Path(path.ToUTF8().data());
+    std::thread([post, utf8Path]() {
+        AsyncResult result;
+        MappedFile file;
+        if(!file.open(wxString::FromUTF8(utf8Path.data(), utf8Path.size()))) {
+            result.errorMessage=wxString::Format("Cannot read file '%s'", wxString::FromUTF8(utf8Path.data(), utf8Path.size()));
+        } else if(file.getLength()>0) {
+            result.output.assign(file.getData(), file.getLength());
+        }
+        post(result);
+    }).detach();
+    return operationId;
+}
+
+int AsyncTasks::startProcessOutput(lua_State*thread, const wxString&command) {
+    int operationId=addOperation(thread, ASYNC_PROCESS_OUTPUT);
+    std::function<void(AsyncResult)>post=completionPoster(operationId);
+    std::string utf8Command(command.ToUTF8().data());
+    std::thread([post, utf8Command]() {
+        AsyncResult result;
+#ifdef _WIN32
+        FILE*pipe=_popen(utf8Command.c_str(), "rb");
+#else
+        FILE*pipe=popen(utf8Command.c_str(), "r");
+#endif
+        if(pipe==NULL) {
+            result.errorMessage=wxString::Format("Cannot run command '%s'", wxString::FromUTF8(utf8Command.data(), utf8Command.size()));
+            post(result);
+            return;
+        }
+        char buffer[4096];
+        size_t count;
+        while((count=fread(buffer, 1, sizeof(buffer), pipe))>0) {
+            result.output.append(buffer, count);
+        }
+#ifdef _WIN32
+        result.exitCode=_pclose(pipe);
+#else
+        int status=pclose(pipe);
+        result.exitCode=WIFEXITED(status)?WEXITSTATUS(status):-1;
+#endif
+        post(result);
+    }).detach();
+    return operationId;
+}
+
+void AsyncTasks::await(lua_State*thread, int operationId) {
+    long long taskId=findTaskId(thread);
+    if(taskId==0) {
+        throw RuntimeException("lxe.await is available only in event handlers");
+    }
+    auto operation=operations.find(operationId);
+    if(operation==operations.end() || operation->second.taskId!=taskId) {
+        throw RuntimeException(wxString::Format("Unknown async operation %d", operationId));
+    }
+    tasks[taskId].awaitedOperation=operationId;
+}
+
+void AsyncTasks::complete(int operationId, AsyncResult result) {
+    auto operation=operations.find(operationId);
+    //task of operation was released
+    if(operation==operations.end()) return;
+    operation->second.completed=true;
+    operation->second.result=std::move(result);
+    auto task=tasks.find(operation->second.taskId);
+    if(task!=tasks.end() && task->second.awaitedOperation==operationId && !task->second.running) {
+        resume(task->first);
+    }
+}
+
+void AsyncTasks::cancelTasksOf(DomElement*element) {
+    std::vector<long long>released;
+    for(auto&it: tasks) {
+        Task&task=it.second;
+        if(task.cancelled) continue;
+        DomElement*owner=task.owner;
+        while(owner!=NULL && owner!=element) owner=owner->getParent();
+        if(owner==NULL) continue;
+        task.cancelled=true;
+        tasksCancelled++;
+        if(!task.running) released.push_back(task.id);
+    }
+    for(long long taskId: released) {
+        release(taskId);
+    }
+}
+
+int AsyncTasks::getSuspendedCount() {
+    int count=0;
+    for(auto&it: tasks) {
+        if(!it.second.running) count++;
+    }
+    return count;
+}
@@ -0,0 +1,92 @@
+//
+//  lxeAsync.hpp
+//  LuaXmlWidgets
+//
+
+#ifndef lxeAsync_hpp
+#define lxeAsync_hpp
+
+namespace lxe {
+class DomElement;
+class Engine;
+
+enum AsyncOperationType {ASYNC_TIMER, ASYNC_FILE_READ, ASYNC_PROCESS_OUTPUT};
+
+/**
+ Result of async operation, produced on worker thread and read on GUI thread
+ */
+struct AsyncResult {
+    ///content of file or output of process
+    std::string output;
+    int exitCode=0;
+    ///not empty when operation failed
+    wxString errorMessage;
+};
+
+/**
+ Event handlers running as Lua coroutines. Handler suspends in lxe.await until native operation completes, then it is
+ resumed from idle scheduler of the engine. Work of operations runs on worker threads, so idle scheduler must be safe
+ to call from any thread, like wxApp::CallAfter. Tasks are cancelled when their element or its ancestor is removed
+ */
+class AsyncTasks {
+private:
+    struct Task {
+        long long id;
+        LuaCoroutine coroutine;
+        DomElement*owner;
+        ///operations started by task, they are dropped with it
+        std::vector<int>operations;
+        int awaitedOperation=0;
+        ///time spent in resumes, reported as handler duration when task is released
+        double runMilliseconds=0;
+        bool running=false;
+        bool cancelled=false;
+    };
+    struct Operation {
+        AsyncOperationType type;
+        long long taskId;
+        bool completed=false;
+        AsyncResult result;
+    };
+    Engine*engine;
+    std::unordered_map<long long, Task>tasks;
+    std::unordered_map<lua_State*, long long>tasksByThread;
+    std::unordered_map<int, Operation>operations;
+    long long taskIdGenerator=0;
+    int operationIdGenerator=0;
+    long long tasksCancelled=0;
+    //worker threads hold weak pointer, results coming after engine is destroyed are dropped
+    std::shared_ptr<AsyncTasks*>lifetime;
+    std::function<void(int milliseconds, std::function<void()>callback)>timerScheduler;
+    ///throws RuntimeException if thread is not a task or engine has no idle scheduler
+    int addOperation(lua_State*thread, AsyncOperationType type);
+    long long findTaskId(lua_State*thread);
+    ///posts result of operation from worker thread to GUI thread
+    std::function<void(AsyncResult result)>completionPoster(int operationId);
+    void resume(long long taskId);
+    void release(long long taskId);
+public:
+    AsyncTasks(Engine*engine);
+    /**
+     Timer scheduler runs callback on GUI thread after delay. Without it every timer sleeps on its own worker thread
+     */
+    void setTimerScheduler(std::function<void(int milliseconds, std::function<void()>callback)>timerScheduler){this->timerScheduler=timerScheduler;}
+    ///runs handler as coroutine owned by element, owner can be NULL. Throws RuntimeException if handler is not a function
+    void start(DomElement*owner, const TagAttribute&handler);
+    ///operations belong to task of thread and return their id
+    int startTimer(lua_State*thread, int milliseconds);
+    int startFileRead(lua_State*thread, const wxString&path);
+    ///runs command through shell and collects its standard output
+    int startProcessOutput(lua_State*thread, const wxString&command);
+    ///task of thread is resumed with results of its operation once it completes and thread yields
+    void await(lua_State*thread, int operationId);
+    void complete(int operationId, AsyncResult result);
+    ///cancels tasks of element and its descendants, running task is released after it yields
+    void cancelTasksOf(DomElement*element);
+    int getSuspendedCount();
+    int getPendingOperationsCount(){return (int)operations.size();}
+    long long getTasksStarted(){return taskIdGenerator;}
+    long long getTasksCancelled(){return tasksCancelled;}
+};
+}
+#endif /* lxeAsync_hpp */
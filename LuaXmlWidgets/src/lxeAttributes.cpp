@@ -5,80 +5,171 @@
 
 using namespace lxe;
 
-void lxe::attributeHashMapNamesVisitor(AttributesMap*map, std::function<void(wxString&attrName)>handler) {
-    for(auto it = map->begin(); it != map->end(); ++it) {
-        wxString key=it->first;
-        handler(key);
+AttributesSchema::AttributesSchema(const AttributesSchema*parent, const AttributeDeclaration*declarations, int count) {
+    if(parent!=NULL) entries=parent->entries;
+    for(int i=0;i<count;i++) {
+        const AttributeDeclaration&declaration=declarations[i];
+        AttributeSchemaEntry entry={internAtom(std::string_view(declaration.name)), declaration.recreationRequired, declaration.handlerId};
+        bool overridden=false;
+        for(int j=0;j<entries.size();j++) {
+            if(entries[j].name==entry.name) {
+                entries[j]=entry;
+                overridden=true;
+                break;
+            }
+        }
+        if(!overridden) entries.push_back(entry);
+    }
+    buildPerfectHash();
+}
+
+void AttributesSchema::buildPerfectHash() {
+    //atoms are small dense integers, so multiplicative hash with some odd multiplier
+    //spreads them without collisions in a table with load factor below one half
+    int bits=1;
+    while((1u<<bits) < entries.size()*2) bits++;
+    for(; bits<=20; bits++) {
+        unsigned int candidate=0x9E3779B1u;
+        for(int attempt=0; attempt<256; attempt++, candidate+=0x6A09E668u) {
+            multiplier=candidate|1;
+            shift=32-bits;
+            slots.assign((size_t)1<<bits, -1);
+            bool collision=false;
+            for(int i=0;i<entries.size() && !collision;i++) {
+                int&slot=slots[slotIndex(entries[i].name)];
+                if(slot!=-1) collision=true;
+                slot=i;
+            }
+            if(!collision) return;
+        }
     }
+    throw RuntimeException("Cannot build attributes schema hash table");
+}
+
+std::vector<AttributeEntry>::iterator AttributesMap::lowerBound(Atom name) {
+    return std::lower_bound(entries.begin(), entries.end(), name, [](const AttributeEntry&entry, Atom name) {
+        return entry.name < name;
+    });
 }
 
-TagAttribute::TagAttribute():value(0) {
-    this->type=TA_NULL;
+TagAttribute*AttributesMap::find(Atom name) {
+    auto it=lowerBound(name);
+    return it!=entries.end() && it->name==name ? &it->value : NULL;
 }
-wxAny&TagAttribute::getValue() {
-    return value;
+
+bool AttributesMap::set(Atom name, const TagAttribute&value) {
+    auto it=lowerBound(name);
+    if(it!=entries.end() && it->name==name) {
+        it->value=value;
+        return false;
+    }
+    entries.insert(it, AttributeEntry{name, value});
+    return true;
 }
-TagAttributeType TagAttribute::getType()const {
-    return type;
+
+bool AttributesMap::erase(Atom name) {
+    auto it=lowerBound(name);
+    if(it==entries.end() || it->name!=name) return false;
+    entries.erase(it);
+    return true;
 }
-TagAttribute&TagAttribute::setNull() {
+
+void TagAttribute::release() {
+    if(type==TA_STRING && --stringValue->refCount==0) {
+        delete stringValue;
+    }
     type=TA_NULL;
-    this->value.MakeNull();
+}
+
+void TagAttribute::copyValue(const TagAttribute&other) {
+    type=other.type;
+    switch(type) {
+        case TA_NULL:doubleValue=0;break;
+        case TA_STRING:stringValue=other.stringValue;break;
+        case TA_INT:intValue=other.intValue;break;
+        case TA_DOUBLE:doubleValue=other.doubleValue;break;
+        case TA_BOOL:boolValue=other.boolValue;break;
+        case TA_FUNCTION:functionValue=other.functionValue;break;
+    }
+}
+
+TagAttribute&TagAttribute::operator=(const TagAttribute&other) {
+    if(this==&other) return *this;
+    release();
+    copyValue(other);
+    retain();
+    return *this;
+}
+
+TagAttribute&TagAttribute::operator=(TagAttribute&&other)noexcept {
+    if(this==&other) return *this;
+    release();
+    copyValue(other);
+    other.type=TA_NULL;
+    return *this;
+}
+
+TagAttribute&TagAttribute::setNull() {
+    release();
     return *this;
 }
 TagAttribute&TagAttribute::setString(const wxString&str) {
+    release();
+    stringValue=new SharedString{1, str};
     type=TA_STRING;
-    this->value=str;
     return *this;
 }
 TagAttribute&TagAttribute::setInt(int value) {
+    release();
     type=TA_INT;
-    this->value=value;
+    intValue=value;
     return *this;
 }
 TagAttribute&TagAttribute::setDouble(double value) {
+    release();
     type=TA_DOUBLE;
-    this->value=value;
+    doubleValue=value;
     return *this;
 }
 TagAttribute&TagAttribute::setBool(bool value) {
+    release();
     type=TA_BOOL;
-    this->value=value;
+    boolValue=value;
     return *this;
 }
 TagAttribute&TagAttribute::setFunction(FunctionRef ref) {
+    release();
     type=TA_FUNCTION;
-    this->value=ref;
+    functionValue=ref;
     return *this;
 }
-bool TagAttribute::isNull()const{
-    return type==TA_NULL;
-}
 
-bool TagAttribute::equals(TagAttribute&attr)const {
-    if(type!=attr.getType())return false;
+bool TagAttribute::equals(const TagAttribute&attr)const {
+    if(type!=attr.type)return false;
     switch(type) {
         case TA_NULL:return true;
-        case TA_INT:return value.As<int>()==attr.value.As<int>();
-        case TA_DOUBLE:return value.As<double>()==attr.value.As<double>();
-        case TA_BOOL:return value.As<bool>()==attr.value.As<bool>();
-        case TA_FUNCTION:return value.As<FunctionRef>().ref==attr.getInt();
-        case TA_STRING: {
-            wxString left=value.As<wxString>();
-            wxString right=attr.value.As<wxString>();
-            return left==right;
-        }
+        case TA_INT:return intValue==attr.intValue;
+        case TA_DOUBLE:return doubleValue==attr.doubleValue;
+        case TA_BOOL:return boolValue==attr.boolValue;
+        case TA_FUNCTION:return functionValue.ref==attr.functionValue.ref;
+        case TA_STRING:return stringValue==attr.stringValue || stringValue->value==attr.stringValue->value;
     }
     return true;
 }
 
+const wxString&TagAttribute::getStringRef()const {
+    if(type!=TA_STRING)
+        throw RuntimeException(wxString::Format("Cannot get reference to string value of attribute with type %d", type));
+    return stringValue->value;
+}
+
 wxString TagAttribute::getString()const {
     switch(type) {
-        case TA_INT:return wxString::Format("%d",value.As<int>());
-        case TA_DOUBLE:return wxString::Format("%lf",value.As<double>());
-        case TA_BOOL:return wxString(value.As<bool>()?"true":"false");
-        case TA_FUNCTION:return wxString::Format("Function_ref#%d",value.As<FunctionRef>().ref);
-        case TA_STRING:return value.As<wxString>();
+        case TA_INT:return wxString::Format("%d",intValue);
+        case TA_DOUBLE:return wxString::Format("%lf",doubleValue);
+        case TA_BOOL:return wxString(boolValue?"true":"false");
+        case TA_FUNCTION:return wxString::Format("Function_ref#%d",functionValue.ref);
+        case TA_STRING:return stringValue->value;
         case TA_NULL:
             return "null";
         default:
@@ -88,13 +179,13 @@ wxString TagAttribute::getString()const {
 
 int TagAttribute::getInt()const {
     switch(type) {
-        case TA_INT:return value.As<int>();
-        case TA_DOUBLE:return (int)value.As<double>();
-        case TA_BOOL:return (int)value.As<bool>();
-        case TA_FUNCTION:return value.As<FunctionRef>().ref;
+        case TA_INT:return intValue;
+        case TA_DOUBLE:return (int)doubleValue;
+        case TA_BOOL:return (int)boolValue;
+        case TA_FUNCTION:return functionValue.ref;
         case TA_STRING: {
             double dvalue;
-            if(value.As<wxString>().ToDouble(&dvalue)) {
+            if(stringValue->value.ToDouble(&dvalue)) {
                 return dvalue;
             } else {
                 throw RuntimeException("Cannot convert string value to integer");
@@ -109,12 +200,12 @@ int TagAttribute::getInt()const {
 
 double TagAttribute::getDouble()const {
     switch(type) {
-        case TA_INT:return value.As<int>();
-        case TA_DOUBLE:return value.As<double>();
-        case TA_BOOL:return value.As<bool>()?1.0:0.0;
+        case TA_INT:return intValue;
+        case TA_DOUBLE:return doubleValue;
+        case TA_BOOL:return boolValue?1.0:0.0;
         case TA_STRING: {
             double dvalue;
-            if(value.As<wxString>().ToDouble(&dvalue)) {
+            if(stringValue->value.ToDouble(&dvalue)) {
                 return dvalue;
             } else {
                 throw RuntimeException("Cannot convert string value to double");
@@ -129,12 +220,12 @@ double TagAttribute::getDouble()const {
 
 bool TagAttribute::getBool()const {
     switch(type) {
-        case TA_INT:return value.As<int>()!=0;
-        case TA_DOUBLE:return ((int)value.As<double>())!=0;
-        case TA_BOOL:return value.As<bool>();
+        case TA_INT:return intValue!=0;
+        case TA_DOUBLE:return ((int)doubleValue)!=0;
+        case TA_BOOL:return boolValue;
         case TA_FUNCTION:return true;
         case TA_STRING: {
-            const wxString&strValue=value.As<wxString>();
+            const wxString&strValue=stringValue->value;
             return strValue=="true"||strValue=="1";
         };
         case TA_NULL:
@@ -145,7 +236,7 @@ bool TagAttribute::getBool()const {
 }
 FunctionRef TagAttribute::getFunctionRef()const{
     switch(type) {
-        case TA_FUNCTION:return value.As<FunctionRef>();
+        case TA_FUNCTION:return functionValue;
         case TA_NULL:
             FunctionRef ref;
             ref.ref=-1;
@@ -156,113 +247,116 @@ FunctionRef TagAttribute::getFunctionRef()const{
 }
 
 
-void AttributesStorage::setOnChangeEventHandler(std::function<void(const wxString&name, TagAttribute&oldValue, TagAttribute&newValue)>onChange) {
+void AttributesStorage::setOnChangeEventHandler(std::function<void(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue)>onChange) {
     this->onChange=onChange;
 }
 
-std::function<void(const wxString&name, TagAttribute&oldValue, TagAttribute&newValue)> AttributesStorage::getOnChangeEventHandler() {
-    return onChange;
+bool AttributesStorage::isAttributeNameAllowed(Atom attributeName) {
+    return findSchemaEntry(attributeName)!=NULL;
 }
 
-void AttributesStorage::addAllowedAttributeNamesMap(String2BoolHashMap*map) {
-    allowedAttributeNamesMaps.push_back(map);
-}
-void AttributesStorage::addRecreationAttributeNamesMap(String2BoolHashMap*map) {
-    recreationAttributeNamesMaps.push_back(map);
+bool AttributesStorage::isAttributeRequireRecreation(Atom attributeName) {
+    const AttributeSchemaEntry*entry=findSchemaEntry(attributeName);
+    return entry!=NULL && entry->recreationRequired;
 }
 
-bool AttributesStorage::isAttributeNameAllowed(const wxString&attributeName) {
-    for(int i=0;i<allowedAttributeNamesMaps.size();i++){
-        if(allowedAttributeNamesMaps[i]->find(attributeName)!=allowedAttributeNamesMaps[i]->end()) {
-            return true;
-        }
-    }
-    return false;
+bool AttributesStorage::isDirectAttributeSet(Atom attributeName) {
+    return directAttributes.find(attributeName)!=NULL;
 }
 
-bool AttributesStorage::isAttributeRequireRecreation(const wxString&attributeName) {
-    for(int i=0;i<recreationAttributeNamesMaps.size();i++){
-        if(recreationAttributeNamesMaps[i]->find(attributeName)!=recreationAttributeNamesMaps[i]->end()){
-            return true;
+std::vector<AttributesStorage::MergedAttribute>&AttributesStorage::getMergedView() {
+    if(mergedViewVersion==version) return mergedView;
+    mergedView.clear();
+    for(auto it=directAttributes.begin(); it!=directAttributes.end(); ++it) {
+        mergedView.push_back({it->name, &it->value});
+    }
+    //layers are sorted by priority, so first found value wins
+    for(int i=0;i<attributesFromProperties.size();i++) {
+        AttributesMap&layer=attributesFromProperties[i].attributes;
+        size_t mergedSize=mergedView.size();
+        for(auto it=layer.begin(); it!=layer.end(); ++it) {
+            auto end=mergedView.begin()+mergedSize;
+            auto found=std::lower_bound(mergedView.begin(), end, it->name, [](const MergedAttribute&attribute, Atom name) {
+                return attribute.name < name;
+            });
+            if(found==end || found->name!=it->name) {
+                mergedView.push_back({it->name, &it->value});
+            }
         }
+        std::inplace_merge(mergedView.begin(), mergedView.begin()+mergedSize, mergedView.end(), [](const MergedAttribute&a, const MergedAttribute&b) {
+            return a.name < b.name;
+        });
     }
-    return false;
-}
-
-bool AttributesStorage::isDirectAttributeSet(const wxString&attributeName) {
-    return directAttributes.find(attributeName)!=directAttributes.end();
+    mergedViewVersion=version;
+    return mergedView;
 }
 
 wxArrayString AttributesStorage::getSettedDirectAttributeNames() {
     wxArrayString result;
-    attributeHashMapNamesVisitor(&directAttributes, [&result](wxString&name) {
-        result.push_back(name);
-    });
+    for(auto it=directAttributes.begin(); it!=directAttributes.end(); ++it) {
+        result.push_back(atomName(it->name));
+    }
     return result;
 }
 
 wxArrayString AttributesStorage::getAllSettedAtributeNames() {
     wxArrayString result;
-    String2BoolHashMap map;
-    attributeHashMapNamesVisitor(&directAttributes, [&map](wxString&name) {
-        map[name]=true;
-    });
-    for(int i=0;i<attributesFromProperties.size();i++) {
-        attributeHashMapNamesVisitor(&(attributesFromProperties[i].attributes), [&map](wxString&name) {
-            map[name]=true;
-        });
-    }
-    for(auto it = map.begin(); it != map.end(); ++it) {
-        result.push_back(it->first);
+    std::vector<MergedAttribute>&view=getMergedView();
+    for(int i=0;i<view.size();i++) {
+        result.push_back(atomName(view[i].name));
     }
     return result;
 }
 
-TagAttribute AttributesStorage::getAttribute(const wxString&attributeName) {
-    auto found=directAttributes.find(attributeName);
-    if(found!=directAttributes.end()) {
-        return found->second;
-    }
-    for(int i=0;i<attributesFromProperties.size();i++) {
-        PropertiesAttributes&propertiesAttributes=attributesFromProperties[i];
-        auto found=propertiesAttributes.attributes.find(attributeName);
-        if(found!=propertiesAttributes.attributes.end()) {
-            return found->second;
-        }
+const TagAttribute*AttributesStorage::findAttribute(Atom attributeName) {
+    if(attributesFromProperties.empty()) {
+        return directAttributes.find(attributeName);
     }
-    return TagAttribute().setNull();
+    std::vector<MergedAttribute>&view=getMergedView();
+    auto found=std::lower_bound(view.begin(), view.end(), attributeName, [](const MergedAttribute&attribute, Atom name) {
+        return attribute.name < name;
+    });
+    return found!=view.end() && found->name==attributeName ? found->value : NULL;
+}
+
+TagAttribute AttributesStorage::getAttribute(Atom attributeName) {
+    const TagAttribute*attribute=findAttribute(attributeName);
+    return attribute!=NULL?*attribute:TagAttribute();
 }
 
-void AttributesStorage::removeAttribute(const wxString&name, bool fireEvent) {
+void AttributesStorage::removeAttribute(Atom name, bool fireEvent) {
     if(isDirectAttributeSet(name)) {
         TagAttribute oldValue = getAttribute(name);
         directAttributes.erase(name);
-        if(fireEvent && !oldValue.isNull()) {
+        version++;
+        const AttributeSchemaEntry*entry=findSchemaEntry(name);
+        if(fireEvent && entry!=NULL && !oldValue.isNull()) {
             TagAttribute newValue;
             newValue.setNull();
-            onChange(name, oldValue, newValue);
+            onChange(*entry, oldValue, newValue);
         }
     }
 }
 
-void AttributesStorage::setAttribute(const wxString&attributeName, TagAttribute&value, bool fireEvent) {
-    if(!supportedAttributeName(attributeName)) {
-        throw RuntimeException(wxString::Format("Tag does not support attribute '%s'", attributeName));
+void AttributesStorage::setAttribute(Atom attributeName, TagAttribute&value, bool fireEvent) {
+    const AttributeSchemaEntry*entry=findSchemaEntry(attributeName);
+    if(entry==NULL) {
+        throw RuntimeException(wxString::Format("Tag does not support attribute '%s'", atomName(attributeName)));
     }
-    TagAttribute oldAttribute = getAttribute(attributeName);
-    directAttributes[attributeName] = value;
+    setAttribute(*entry, value, fireEvent);
+}
+
+void AttributesStorage::setAttribute(const AttributeSchemaEntry&attribute, TagAttribute&value, bool fireEvent) {
+    TagAttribute oldAttribute = getAttribute(attribute.name);
+    //changing value in place keeps merged view valid, only new names invalidate it
+    if(directAttributes.set(attribute.name, value)) version++;
     if(fireEvent && !oldAttribute.equals(value)) {
-        onChange(attributeName, oldAttribute, value);
+        onChange(attribute, oldAttribute, value);
     }
 }
 
-bool AttributesStorage::supportedAttributeName(const wxString&attributeName){
-    for(int i=0;i<allowedAttributeNamesMaps.size();i++){
-        if(allowedAttributeNamesMaps[i]->find(attributeName)!=allowedAttributeNamesMaps[i]->end()){
-            return true;
-        }
-    }
-    return false;
+bool AttributesStorage::supportedAttributeName(Atom attributeName){
+    return isAttributeNameAllowed(attributeName);
 }
 
 void AttributesStorage::addProperties(PropertiesAttributes&propertiesAttributes, bool fireEvent) {
@@ -288,24 +382,26 @@ void AttributesStorage::modifyProperties(PropertiesAttributes&propertiesAttribut
     //remember old values
     std::vector<TagAttribute>oldAttributeValues;
     AttributesMap&propAttrMap=propertiesAttributes.attributes;
-    wxArrayString propertiesKeys;
+    std::vector<Atom>propertiesKeys;
     for(auto it = propAttrMap.begin(); it != propAttrMap.end(); ++it) {
-        propertiesKeys.push_back(it->first);
+        propertiesKeys.push_back(it->name);
     }
     for(int i=0;i<propertiesKeys.size();i++){
         oldAttributeValues.push_back(getAttribute(propertiesKeys[i]));
     }
     // Modify the properties list
     actualModification();
+    version++;
     
     //check if old attribute not equal to new attribute and then send onChange event
     if(fireEvent) {
         for(int i=0;i<propertiesKeys.size();i++) {
-            wxString&propKey=propertiesKeys[i];
+            Atom propKey=propertiesKeys[i];
             TagAttribute newAttr=getAttribute(propKey);
             TagAttribute oldAttr=oldAttributeValues[i];
-            if(!newAttr.equals(oldAttr)) {
-                onChange(propertiesKeys[i], oldAttr, newAttr);
+            const AttributeSchemaEntry*entry=findSchemaEntry(propKey);
+            if(entry!=NULL && !newAttr.equals(oldAttr)) {
+                onChange(*entry, oldAttr, newAttr);
             }
         }
     }
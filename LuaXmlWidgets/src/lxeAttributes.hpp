@@ -13,14 +13,36 @@ enum TagAttributeType {
     TA_INT=100, TA_DOUBLE, TA_STRING, TA_BOOL,TA_FUNCTION, TA_NULL
 };
 
+/**
+ Attribute value, 16 bytes discriminated union. Strings are immutable and reference counted,
+ so copying any attribute never touches the heap
+ */
 class TagAttribute {
 private:
-    wxAny value;
+    struct SharedString {
+        int refCount;
+        wxString value;
+    };
+    union {
+        int intValue;
+        double doubleValue;
+        bool boolValue;
+        FunctionRef functionValue;
+        SharedString*stringValue;
+    };
     TagAttributeType type;
+    void retain() {if(type==TA_STRING) stringValue->refCount++;}
+    void release();
+    ///copies only the active member of the union, without retaining string
+    void copyValue(const TagAttribute&other);
 public:
-    TagAttribute();
-    wxAny&getValue();
-    TagAttributeType getType()const;
+    TagAttribute() {doubleValue=0; type=TA_NULL;}
+    TagAttribute(const TagAttribute&other) {copyValue(other); retain();}
+    TagAttribute(TagAttribute&&other)noexcept {copyValue(other); other.type=TA_NULL;}
+    TagAttribute&operator=(const TagAttribute&other);
+    TagAttribute&operator=(TagAttribute&&other)noexcept;
+    ~TagAttribute() {release();}
+    TagAttributeType getType()const {return type;}
     TagAttribute&setNull();
     TagAttribute&setString(const wxString&str);
     TagAttribute&setInt(int value);
@@ -28,10 +50,12 @@ public:
     TagAttribute&setBool(bool value);
     TagAttribute&setFunction(FunctionRef ref);
     
-    bool isNull()const;
-    bool equals(TagAttribute&attr)const;
+    bool isNull()const {return type==TA_NULL;}
+    bool equals(const TagAttribute&attr)const;
     
     wxString getString()const;
+    ///value of TA_STRING attribute without copying, throws for other types
+    const wxString&getStringRef()const;
     int getInt()const;
     double getDouble()const;
     bool getBool()const;
@@ -48,9 +72,75 @@ public:
     bool defaultIfNull(bool defaultValue)const{return isNull()?defaultValue:getBool();}
 };
 
-typedef std::unordered_map<wxString,  TagAttribute> AttributesMap;
+static_assert(sizeof(TagAttribute)<=16, "TagAttribute should stay compact");
 
-void attributeHashMapNamesVisitor(AttributesMap*map, std::function<void(wxString&attrName)>handler);
+class AttributeEntry {
+public:
+    Atom name;
+    TagAttribute value;
+};
+
+/**
+ Attributes sorted by atom in one flat vector. Elements usually have about a dozen attributes,
+ so binary search over contiguous entries is cheaper than hashing
+ */
+class AttributesMap {
+private:
+    std::vector<AttributeEntry>entries;
+    std::vector<AttributeEntry>::iterator lowerBound(Atom name);
+public:
+    TagAttribute*find(Atom name);
+    ///returns true if name was not present before
+    bool set(Atom name, const TagAttribute&value);
+    bool erase(Atom name);
+    int size()const {return (int)entries.size();}
+    bool empty()const {return entries.empty();}
+    std::vector<AttributeEntry>::const_iterator begin()const {return entries.begin();}
+    std::vector<AttributeEntry>::const_iterator end()const {return entries.end();}
+};
+
+/**
+ Attribute supported by a tag class. Classes declare them in constexpr tables
+ */
+struct AttributeDeclaration {
+    const char*name;
+    bool recreationRequired;
+    ///id passed to handleChangedAttribute of the tag class, 0 if attribute has no handler
+    int handlerId;
+};
+
+class AttributeSchemaEntry {
+public:
+    Atom name;
+    bool recreationRequired;
+    int handlerId;
+};
+
+/**
+ Attributes of one tag class merged with attributes of its parent class. Built once per class,
+ lookup is a single probe into collision free hash table
+ */
+class AttributesSchema {
+private:
+    std::vector<AttributeSchemaEntry>entries;
+    std::vector<int>slots;//index of entry or -1
+    unsigned int multiplier=0;
+    int shift=0;
+    unsigned int slotIndex(Atom name)const {return ((unsigned int)name*multiplier)>>shift;}
+    void buildPerfectHash();
+public:
+    AttributesSchema(const AttributesSchema*parent, const AttributeDeclaration*declarations, int count);
+    template<size_t N>
+    AttributesSchema(const AttributesSchema*parent, const AttributeDeclaration(&declarations)[N]):AttributesSchema(parent, declarations, (int)N) {}
+    const AttributeSchemaEntry*find(Atom name)const {
+        if(name<0) return NULL;
+        int index=slots[slotIndex(name)];
+        return index>=0 && entries[index].name==name ? &entries[index] : NULL;
+    }
+    int getSize()const {return (int)entries.size();}
+    const AttributeSchemaEntry&getEntry(int index)const {return entries[index];}
+    int getSlotsCount()const {return (int)slots.size();}
+};
 
 class PropertiesAttributes {
 public:
@@ -60,25 +150,42 @@ public:
 };
 
 class AttributesStorage {
-    std::vector<String2BoolHashMap*>recreationAttributeNamesMaps;
-    std::vector<String2BoolHashMap*>allowedAttributeNamesMaps;
+    struct MergedAttribute {
+        Atom name;
+        const TagAttribute*value;
+    };
+    const AttributesSchema*schema=NULL;
     AttributesMap directAttributes;
     std::vector<PropertiesAttributes> attributesFromProperties;
-    std::function<void(const wxString&name, TagAttribute&oldValue, TagAttribute&newValue)>onChange;
+    ///attributes of all layers sorted by name, direct attributes win. Rebuilt lazily when names or layers change
+    std::vector<MergedAttribute>mergedView;
+    unsigned int version=0;
+    unsigned int mergedViewVersion=(unsigned int)-1;
+    std::vector<MergedAttribute>&getMergedView();
+    std::function<void(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue)>onChange;
 public:
-    void setOnChangeEventHandler(std::function<void(const wxString&name, TagAttribute&oldValue, TagAttribute&newValue)>onChange);
-    std::function<void(const wxString&name, TagAttribute&oldValue, TagAttribute&newValue)> getOnChangeEventHandler();
-    void addAllowedAttributeNamesMap(String2BoolHashMap*map);
-    void addRecreationAttributeNamesMap(String2BoolHashMap*map);
-    bool isAttributeNameAllowed(const wxString&attributeName);
-    bool isAttributeRequireRecreation(const wxString&attributeName);
-    bool isDirectAttributeSet(const wxString&attributeName);
+    void setOnChangeEventHandler(std::function<void(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue)>onChange);
+    const std::function<void(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue)>&getOnChangeEventHandler() {return onChange;}
+    void setSchema(const AttributesSchema*schema) {this->schema=schema;}
+    const AttributesSchema*getSchema() {return schema;}
+    ///returns NULL if attribute is not supported
+    const AttributeSchemaEntry*findSchemaEntry(Atom attributeName) {return schema!=NULL?schema->find(attributeName):NULL;}
+    bool isAttributeNameAllowed(Atom attributeName);
+    bool isAttributeRequireRecreation(Atom attributeName);
+    bool isDirectAttributeSet(Atom attributeName);
     wxArrayString getSettedDirectAttributeNames();
     wxArrayString getAllSettedAtributeNames();
-    TagAttribute getAttribute(const wxString&attributeName);
-    void removeAttribute(const wxString&name, bool fireEvent);
-    void setAttribute(const wxString&attributeName, TagAttribute&value, bool fireEvent);
-    bool supportedAttributeName(const wxString&attributeName);
+    ///enumerates names of attributes from all layers without allocations
+    int getSettedAttributesCount() {return (int)getMergedView().size();}
+    Atom getSettedAttributeName(int index) {return getMergedView()[index].name;}
+    TagAttribute getAttribute(Atom attributeName);
+    ///returns NULL if attribute is not set. Pointer is valid until next modification of storage
+    const TagAttribute*findAttribute(Atom attributeName);
+    void removeAttribute(Atom name, bool fireEvent);
+    void setAttribute(Atom attributeName, TagAttribute&value, bool fireEvent);
+    ///same as setAttribute(Atom...) for callers that already found schema entry
+    void setAttribute(const AttributeSchemaEntry&attribute, TagAttribute&value, bool fireEvent);
+    bool supportedAttributeName(Atom attributeName);
     void addProperties(PropertiesAttributes&propertiesAttributes, bool fireEvent);
     void removeProperties(int id, bool fireEvent);
     void modifyProperties(PropertiesAttributes&propertiesAttributes, bool fireEvent, std::function<void()>actualModification) ;
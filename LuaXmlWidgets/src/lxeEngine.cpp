@@ -4,27 +4,102 @@
 
 #include "lxe.hpp"
 #include "../../lua_std_lib/generated/lua_std_lib.hpp"
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <filesystem>
 
 using namespace lxe;
 
-String2BoolHashMap*DomElement::allowedAttributes=NULL;
-String2BoolHashMap*DomElement::recreationRequiredAttributes=NULL;
-String2BoolHashMap*Script::allowedAttributes=NULL;
-String2BoolHashMap*Script::recreationRequiredAttributes=NULL;
+static constexpr AttributeDeclaration domElementAttributes[]={
+    {"id", false, 0},
+    {"class", false, 0},
+    {"properties", false, 0},
+    {"innerLXML", false, DOM_ELEMENT_INNER_LXML},
+    {"outerLXML", false, 0},
+};
+
+const AttributesSchema*DomElement::getAttributesSchema() {
+    static AttributesSchema schema(NULL, domElementAttributes);
+    return &schema;
+}
 
 DomElement::DomElement() {
     this->parent=NULL;
-    if(allowedAttributes==NULL) {
-        allowedAttributes=createAndFillStringsMap({"id", "properties", "innerLXML", "outerLXML"});
-        recreationRequiredAttributes=createAndFillStringsMap({});
-    }
-    addAllowedAttributeNamesMap(allowedAttributes);
+    setAttributesSchema(getAttributesSchema());
     
-    attributes.setOnChangeEventHandler([this](const wxString&name, TagAttribute&oldValue, TagAttribute&newValue){
-        handleChangedAttribute(name, oldValue, newValue);
+    attributes.setOnChangeEventHandler([this](const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue){
+        onAttributeChanged(attribute, oldValue, newValue);
     });
 }
 
+void DomElement::onAttributeChanged(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    //scheduled recreation applies all attributes anyway
+    if(recreationScheduled) return;
+    if(attributeBatchDepth==0) {
+        handleChangedAttribute(attribute, oldValue, newValue);
+        return;
+    }
+    //value before the batch is kept, so attribute changed back and forth does not fire at all
+    for(int i=0;i<pendingAttributeChanges.size();i++) {
+        if(pendingAttributeChanges[i].attribute==&attribute) return;
+    }
+    pendingAttributeChanges.push_back({&attribute, oldValue});
+}
+
+void DomElement::beginAttributeBatch() {
+    attributeBatchDepth++;
+}
+
+void DomElement::endAttributeBatch() {
+    if(attributeBatchDepth>1) {
+        attributeBatchDepth--;
+        return;
+    }
+    bool recreation=recreationPending;
+    try {
+        //handlers run while batch is still active, so attributes set by handlers are queued to the same loop
+        for(int i=0;i<pendingAttributeChanges.size() && !recreationPending;i++) {
+            PendingAttributeChange change=pendingAttributeChanges[i];
+            TagAttribute newValue=attributes.getAttribute(change.attribute->name);
+            if(!newValue.equals(change.oldValue)) {
+                handleChangedAttribute(*change.attribute, change.oldValue, newValue);
+            }
+        }
+        recreation=recreationPending;
+    } catch(...) {
+        pendingAttributeChanges.clear();
+        recreationPending=false;
+        attributeBatchDepth=0;
+        throw;
+    }
+    pendingAttributeChanges.clear();
+    recreationPending=false;
+    attributeBatchDepth=0;
+    //recreation applies all attributes, so handlers fired before it are not lost
+    if(recreation) {
+        scheduleRecreation();
+    }
+    onAttributeBatchApplied();
+}
+
+AttributeBatch::AttributeBatch(DomElement*element) {
+    this->element=element;
+    this->uncaughtExceptions=std::uncaught_exceptions();
+    element->beginAttributeBatch();
+}
+
+AttributeBatch::~AttributeBatch() noexcept(false) {
+    if(std::uncaught_exceptions()>uncaughtExceptions) {
+        //second exception while unwinding would terminate the program
+        try {
+            element->endAttributeBatch();
+        } catch(...) {
+        }
+        return;
+    }
+    element->endAttributeBatch();
+}
+
 void DomElement::registerEvent(int event, const wxString&attributeName, std::function<void()>createListener, std::function<void()>deleteListener) {
     deleteListener();
     if(getComputedAttribute(attributeName).isNull())
@@ -34,7 +109,7 @@ void DomElement::registerEvent(int event, const wxString&attributeName, std::fun
     if (attributeValue.getType()==TA_STRING || attributeValue.getType()==TA_FUNCTION) {
         createListener();
     } else {
-        throw RuntimeException(wxString::Format("Expected function name or function reference in attribute '%s' of tag %s", attributeName, tagName));
+        throw RuntimeException(wxString::Format("Expected function name or function reference in attribute '%s' of tag %s", attributeName, getTagName()));
     }
 }
 
@@ -53,14 +128,13 @@ DomElement*DomElement::topParent() {
     return lastNonNullParent;
 }
 
-void DomElement::initFromTag(Tag*tag) {
-    this->tagName = tag->getTagName();
-    AttributesMap&tagAttributes=tag->getAttributes();
-    for(auto it = tagAttributes.begin(); it != tagAttributes.end(); ++it) {
-        wxString key=it->first;
-        TagAttribute&attrValue=it->second;
-        attributes.setAttribute(key, attrValue, false);
-    }
+void DomElement::setPrecompiledTextContent(std::string_view bytecode) {
+    throw RuntimeException(wxString::Format("Tag '%s' does not support precompiled content", getTagName()));
+}
+
+void DomElement::initAttribute(Atom name, const TagAttribute&value) {
+    TagAttribute attrValue=value;
+    attributes.setAttribute(name, attrValue, false);
 }
 
 void DomElement::recreate() {
@@ -75,26 +149,35 @@ void DomElement::recreate() {
     if(parent!=NULL)parent->repaint();
 }
 
+void DomElement::scheduleRecreation() {
+    engine->scheduleRecreation(this);
+}
+
+void DomElement::ensureRecreated() {
+    if(!recreationScheduled) return;
+    //cleared first, so reads of native state from inside recreate do not recurse
+    recreationScheduled=false;
+    engine->onRecreationPerformed();
+    recreate();
+}
+
 void DomElement::applyAttributes(wxArrayString*attributeNames) {
     TagAttribute nullAttribute=TagAttribute().setNull();
     for(int i=0;i<attributeNames->size();i++){
-        wxString&name=(*attributeNames)[i];
-        if(isAttributeRequireRecreation(name))
+        const AttributeSchemaEntry*entry=attributes.findSchemaEntry(findAtom((*attributeNames)[i]));
+        if(entry==NULL || entry->recreationRequired || entry->handlerId==NO_ATTRIBUTE_HANDLER)
             continue;
-        TagAttribute attributeValue=attributes.getAttribute(name);
-        attributes.getOnChangeEventHandler()(name, attributeValue, nullAttribute);
+        TagAttribute attributeValue=attributes.getAttribute(entry->name);
+        handleChangedAttribute(*entry, attributeValue, nullAttribute);
     }
 }
 
-void DomElement::addAllowedAttributeNamesMap(String2BoolHashMap*map) {
-    attributes.addAllowedAttributeNamesMap(map);
-}
-
-void DomElement::addRecreationAttributeNamesMap(String2BoolHashMap*map) {
-    attributes.addRecreationAttributeNamesMap(map);
+bool DomElement::isAttributeRequireRecreation(const wxString&name) {
+    Atom atom=findAtom(name);
+    return atom!=NO_ATOM && attributes.isAttributeRequireRecreation(atom);
 }
 
-bool DomElement::isAttributeRequireRecreation(const wxString&name) {
+bool DomElement::isAttributeRequireRecreation(Atom name) {
     return attributes.isAttributeRequireRecreation(name);
 }
 
@@ -102,10 +185,17 @@ void DomElement::notifyParentAboutChange() {
     if(parent != NULL) parent->onChildChanged(this, wxString(""));
 }
 
+TableRef&DomElement::getLuaRef() {
+    if(luaRef.ref==0) {
+        luaRef=engine->createLuaDomElementObject(this);
+    }
+    return luaRef;
+}
+
 int DomElement::getChildIndex(DomElement*child) {
     unsigned long size = children.size();
     for (int i=0; i<size; i++) {
-        if (children[i]->getLuaRefHandle() == child->getLuaRefHandle()) return i;
+        if (children[i] == child) return i;
     }
     return -1;
 }
@@ -118,17 +208,13 @@ void DomElement::removeChildByIndex(int index) {
     children.erase(children.begin() + index);
 }
 
-bool DomElement::handleChangedAttribute(const wxString&name, TagAttribute&oldValue, TagAttribute&newValue) {
-    if (name=="id") {
-        wxString id = getAttribute(name);
-        engine->unregisterDomElementById(id);
-        engine->registerDomElementById(id, this);
-        return true;
-    }
-    if (name=="innerLXML") {
-        wxString innerLXML=newValue.defaultIfNull(wxString(""));
-        engine->replaceChildrenFromString(this, innerLXML);
-        return true;
+bool DomElement::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    switch(attribute.handlerId) {
+        case DOM_ELEMENT_INNER_LXML: {
+            wxString innerLXML=newValue.defaultIfNull(wxString(""));
+            engine->replaceChildrenFromString(this, innerLXML);
+            return true;
+        }
     }
     return false;
 }
@@ -146,18 +232,18 @@ bool DomElement::getDynamicAttributeValue(const wxString&name, TagAttribute&tagA
     }
     if (name=="outerLXML") {
         wxString result="<"+getTagName();
-        bool hasAttributes=getAllSettedAtributeNames().size()!=0;
-        wxArrayString settedAttributesNames=getAllSettedAtributeNames();
+        int attributesCount=attributes.getSettedAttributesCount();
         bool hasChild=getChildrenCount()>0;
-        if(hasAttributes) {
+        if(attributesCount>0) {
             result+=" ";
-            for(int i=0;i<settedAttributesNames.size();i++) {
+            for(int i=0;i<attributesCount;i++) {
+                const wxString&attributeName=atomName(attributes.getSettedAttributeName(i));
                 if(i!=0) result+=" ";
-                result+=settedAttributesNames[i]+"=";
-                TagAttributeType attributeType=getAttributeType(settedAttributesNames[i]);
+                result+=attributeName+"=";
+                TagAttributeType attributeType=getAttributeType(attributeName);
                 bool needQuoting=attributeType==TA_STRING || attributeType==TA_FUNCTION;
                 if(needQuoting) result+="\"";
-                wxString attributeValue=getAttribute(settedAttributesNames[i]);
+                wxString attributeValue=getAttribute(attributeName);
                 if(attributeValue.Contains("\n")) {
                     attributeValue.Replace("\n", "\\n");
                 }
@@ -190,6 +276,11 @@ bool DomElement::getDynamicAttributeValue(const wxString&name, TagAttribute&tagA
 }
 
 bool DomElement::hasSettedAttribute(const wxString&attributeName) {
+    Atom atom=findAtom(attributeName);
+    return atom!=NO_ATOM && attributes.isDirectAttributeSet(atom);
+}
+
+bool DomElement::hasSettedAttribute(Atom attributeName) {
     return attributes.isDirectAttributeSet(attributeName);
 }
 
@@ -198,116 +289,106 @@ wxArrayString DomElement::getAllSettedAtributeNames() {
 }
 
 void DomElement::setAttribute(const wxString&attributeName, TagAttribute&value) {
-    if(!attributes.isAttributeNameAllowed(attributeName)) {
+    Atom atom=findAtom(attributeName);
+    if(atom==NO_ATOM) {
+        //names from schemas are always interned, so unknown name cannot be allowed
         throw RuntimeException(wxString::Format("Tag %s does not support attribute %s", getTagName(), attributeName));
     }
-    bool fireEvent = true;
-    bool requireRecreation = isAttributeRequireRecreation(attributeName);
-    if(requireRecreation) {
-        fireEvent = false;
+    setAttribute(atom, value);
+}
+
+void DomElement::setAttribute(Atom attributeName, TagAttribute&value) {
+    const AttributeSchemaEntry*entry=attributes.findSchemaEntry(attributeName);
+    if(entry==NULL) {
+        throw RuntimeException(wxString::Format("Tag %s does not support attribute %s", getTagName(), atomName(attributeName)));
     }
-    attributes.setAttribute(attributeName, value, fireEvent);
+    bool requireRecreation = entry->recreationRequired;
+    attributes.setAttribute(*entry, value, !requireRecreation);
+    engine->getElementsIndex().onAttributeSet(this, attributeName);
     if(requireRecreation){
-        recreate();
+        if(isAttributeBatchActive()) {
+            recreationPending=true;
+        } else {
+            scheduleRecreation();
+        }
     }
 }
 
 TagAttributeType DomElement::getAttributeType(const wxString&attributeName){
-    TagAttribute attribute = attributes.getAttribute(attributeName);
+    Atom atom=findAtom(attributeName);
+    if(atom==NO_ATOM) return TA_NULL;
+    TagAttribute attribute = attributes.getAttribute(atom);
     return attribute.getType();
 }
 
+const TagAttribute*DomElement::findSettedAttribute(const wxString&attributeName) {
+    Atom atom=findAtom(attributeName);
+    if(atom==NO_ATOM || !attributes.isDirectAttributeSet(atom))
+        return NULL;
+    return attributes.findAttribute(atom);
+}
+
 int DomElement::getAttribute(const wxString&attributeName, int defaultValue) {
-    if(hasSettedAttribute(attributeName)) {
-        TagAttribute attribute=attributes.getAttribute(attributeName);
-        switch(attribute.getType()) {
-            case TA_INT:return attribute.getValue().As<int>();
-            case TA_DOUBLE:return (int)attribute.getValue().As<double>();
-            case TA_BOOL:return (int)attribute.getValue().As<bool>();
-            case TA_FUNCTION:return attribute.getValue().As<int>();
-            case TA_STRING: {
-                double value;
-                if(attribute.getValue().As<wxString>().ToDouble(&value)) {
-                    return value;
-                } else {
-                    return defaultValue;
-                }
-            };
-            case TA_NULL:
-                throw RuntimeException(wxString::Format("Cannot get value of attribute %s as number. It is null", attributeName));
-            default:
-                throw RuntimeException(wxString::Format("Cannot get value of attribute %s as number. Attribute type %d does not implemented", attributeName, attribute.getType()));
-        }
+    const TagAttribute*attribute=findSettedAttribute(attributeName);
+    if(attribute==NULL) return defaultValue;
+    switch(attribute->getType()) {
+        case TA_STRING: {
+            double value;
+            if(attribute->getStringRef().ToDouble(&value)) {
+                return value;
+            } else {
+                return defaultValue;
+            }
+        };
+        case TA_NULL:
+            throw RuntimeException(wxString::Format("Cannot get value of attribute %s as number. It is null", attributeName));
+        default:
+            return attribute->getInt();
     }
-    return defaultValue;
 }
 
 bool DomElement::getAttribute(const wxString&attributeName, bool defaultValue) {
-    if(hasSettedAttribute(attributeName)) {
-        TagAttribute attribute = attributes.getAttribute(attributeName);
-        switch(attribute.getType()) {
-            case TA_INT:return attribute.getValue().As<int>()!=0;
-            case TA_DOUBLE:return attribute.getValue().As<double>()!=0;
-            case TA_BOOL:return attribute.getValue().As<bool>();
-            case TA_FUNCTION:return attribute.getValue().As<int>()!=0;
-            case TA_STRING:{
-                const wxString&value=attribute.getValue().As<wxString>();
-                return value=="true"||value=="1";
-            };
-            case TA_NULL:
-                return false;
-            default:
-                throw RuntimeException(wxString::Format("Cannot get value of attribute %s. Attribute type %d does not implemented", attributeName, attribute.getType()));
-        }
+    const TagAttribute*attribute=findSettedAttribute(attributeName);
+    if(attribute==NULL) return defaultValue;
+    switch(attribute->getType()) {
+        case TA_DOUBLE:return attribute->getDouble()!=0;
+        case TA_FUNCTION:return attribute->getFunctionRef().ref!=0;
+        default:
+            return attribute->getBool();
     }
-    return defaultValue;
 }
 
 wxString DomElement::getAttribute(const wxString&attributeName, const wxString&defaultValue) {
-    if(hasSettedAttribute(attributeName)) {
-        TagAttribute attribute = attributes.getAttribute(attributeName);
-        switch(attribute.getType()){
-            case TA_INT:return wxString::Format("%d",attribute.getValue().As<int>());
-            case TA_DOUBLE:return wxString::Format("%lf",attribute.getValue().As<double>());
-            case TA_BOOL:return wxString(attribute.getValue().As<bool>()?"true":"false");
-            case TA_STRING:return attribute.getValue().As<wxString>();
-            case TA_FUNCTION:return wxString("Function#%d", attribute.getValue().As<int>());
-            case TA_NULL:
-                return "null";
-            default:
-                throw RuntimeException(wxString::Format("Cannot get value of attribute %s. Attribute type %d does not implemented", attributeName, attribute.getType()));
-        }
-    }
-    return defaultValue;
+    const TagAttribute*attribute=findSettedAttribute(attributeName);
+    if(attribute==NULL) return defaultValue;
+    if(attribute->getType()==TA_FUNCTION) return wxString::Format("Function#%d", attribute->getFunctionRef().ref);
+    return attribute->getString();
 }
 
 double DomElement::getAttribute(const wxString&attributeName, double defaultValue) {
-    if(hasSettedAttribute(attributeName)) {
-        TagAttribute attribute=attributes.getAttribute(attributeName);
-        switch(attribute.getType()) {
-            case TA_INT:return attribute.getValue().As<int>();
-            case TA_DOUBLE:return attribute.getValue().As<double>();
-            case TA_BOOL:return attribute.getValue().As<bool>()?1.0:0.0;
-            case TA_FUNCTION:return attribute.getValue().As<int>();
-            case TA_STRING: {
-                double value;
-                if(attribute.getValue().As<wxString>().ToDouble(&value)) {
-                    return value;
-                } else {
-                    return defaultValue;
-                }
-            };
-            case TA_NULL:
-                return 0;
-            default:
-                throw RuntimeException(wxString::Format("Cannot get value of attribute %s. Attribute type %d does not implemented", attributeName, attribute.getType()));
-        }
+    const TagAttribute*attribute=findSettedAttribute(attributeName);
+    if(attribute==NULL) return defaultValue;
+    switch(attribute->getType()) {
+        case TA_FUNCTION:return attribute->getFunctionRef().ref;
+        case TA_STRING: {
+            double value;
+            if(attribute->getStringRef().ToDouble(&value)) {
+                return value;
+            } else {
+                return defaultValue;
+            }
+        };
+        default:
+            return attribute->getDouble();
     }
-    return defaultValue;
 }
 
 TagAttribute DomElement::getComputedAttributeWithoutDynamic(const wxString&attributeName) {
-    if (hasSettedAttribute(attributeName)) {
+    return getComputedAttributeWithoutDynamic(findAtom(attributeName));
+}
+
+TagAttribute DomElement::getComputedAttributeWithoutDynamic(Atom attributeName) {
+    if (attributeName!=NO_ATOM && hasSettedAttribute(attributeName)) {
         return attributes.getAttribute(attributeName);
     }
     
@@ -317,17 +398,13 @@ TagAttribute DomElement::getComputedAttributeWithoutDynamic(const wxString&attri
 }
 
 TagAttribute DomElement::getComputedAttribute(const wxString&attributeName) {
+    ensureRecreated();
     TagAttribute value;
     if(getDynamicAttributeValue(attributeName, value)) {
         return value;
     }
     
-    if (hasSettedAttribute(attributeName)) {
-        return attributes.getAttribute(attributeName);
-    }
-
-    value.setNull();
-    return value;
+    return getComputedAttributeWithoutDynamic(findAtom(attributeName));
 }
 
 void Engine::init() {
@@ -337,6 +414,7 @@ void Engine::init() {
         if(!state)
             throw RuntimeException("Error while load lxe.lua module. " + result);
     });
+    initDomElementType();
     registerTagFactory("Script", [](){return new Script();});
 }
 
@@ -344,97 +422,330 @@ void Engine::initLua() {
     lua = new Lua(true);
 
     serializedFolderReader.load(LUA_STD_LIB, [](){});
-    lua->registerLuaModuleReader([this](char*filePath) {
+    //content points into LUA_STD_LIB, it is never copied
+    lua->registerLuaModuleReader([this](const char*filePath, std::string_view&content) {
         wxString path = filePath;
         if(!path.StartsWith("resource://")) {
-            return (char*)NULL;
+            return false;
         }
         path.Remove(0, wxString("resource://").size());
         path = wxString("/") + path;
 
         SerializedFileChunk*chunk = serializedFolderReader.findChunk(path.ToUTF8().data());
         if(chunk == NULL)
-            return (char*)NULL;
-        char*content = new char[chunk->dataLength + 1];
-        memchr(content, 0, chunk->dataLength + 1);
-        memcpy(content, chunk->data, chunk->dataLength);
-        return (char*)content;
+            return false;
+        content = std::string_view(chunk->data, chunk->dataLength);
+        return true;
     });
 }
 
 void Engine::registerTagFactory(wxString tagName, std::function<DomElement*()>tagFactory) {
-    tagName2DomElementFactory[tagName] =  tagFactory;
+    tagName2DomElementFactory[internAtom(tagName)] =  tagFactory;
 }
 
-TagsParser createParser(wxString&source, wxString fileName) {
-    TagsParser parser(source, fileName);
+void configureParser(TagsParser&parser) {
     parser.addTagWithRawTextContent("Script");
-    return parser;
+}
+
+///whole source is parsed before the first element is created, so syntax error does not leave a part of the document
+static void parseAndReplay(TagsParser&parser, TagsHandler*handler) {
+    std::unique_ptr<TagsDocument>document(parser.parseTags());
+    document->replay(handler);
 }
 
 void Engine::run(wxString source, wxString fileName) {
+    TagsParser parser(source, fileName);
+    configureParser(parser);
+    buildDocument([&parser](TagsHandler*handler){parseAndReplay(parser, handler);}, fileName);
+}
+
+void Engine::run(const char*source, size_t sourceLength, wxString fileName) {
+    if(CompiledLxmlReader::isCompiledLxml(source, sourceLength)) {
+        CompiledLxmlReader reader(source, sourceLength);
+        buildDocument([&reader](TagsHandler*handler){reader.read(handler);}, fileName);
+        return;
+    }
+    TagsParser parser(source, sourceLength, fileName);
+    configureParser(parser);
+    buildDocument([&parser](TagsHandler*handler){parseAndReplay(parser, handler);}, fileName);
+}
+
+void Engine::buildDocument(std::function<void(TagsHandler*handler)>parse, wxString&fileName) {
+    DomElementsBuilder builder(this, NULL, true);
     try {
-        TagsParser parser=createParser(source, fileName);
-        std::vector<Tag*>tags = parser.parseTags();
-        if(tags.size()==0) throw ParseException(wxString::Format("Source file %s does not have any tag", fileName), 0);
-        if(tags.size()>1)  throw ParseException(wxString::Format("Expected only one root tag in file %s", fileName), 0);
-        Tag*rootTag=tags[0];
-        if (rootTag->getType() != TagType_TAG) throw ParseException(wxString::Format("Root xml entity should be tag, but found ", rootTag->getType()), 0);
-        if (!rootTag->getTagName() == wxString("Application")) throw RuntimeException(wxString::Format("Root tag must be 'Application'. File '%s'", fileName));
-        rootElement = recursivelyInitElement(rootTag, NULL);
-        delete rootTag;
+        parse(&builder);
+        std::vector<DomElement*>&elements = builder.getCreatedElements();
+        if(elements.size()==0) throw ParseException(wxString::Format("Source file %s does not have any tag", fileName), 0);
+        if (!elements[0]->getTagName() == wxString("Application")) throw RuntimeException(wxString::Format("Root tag must be 'Application'. File '%s'", fileName));
+        rootElement = elements[0];
     } catch(ParseException&ex) {
-        wxPrintf(wxString::Format("Parsing error line:%d message: %s\n", ex.getLine(), ex.getErrorMessage()));
+        builder.rollback();
+        if(ex.getColumn()>=0)
+            wxPrintf(wxString::Format("Parsing error line:%d column:%d message: %s\n", ex.getLine(), ex.getColumn(), ex.getErrorMessage()));
+        else
+            wxPrintf(wxString::Format("Parsing error line:%d message: %s\n", ex.getLine(), ex.getErrorMessage()));
     } catch(RuntimeException&ex) {
+        builder.rollback();
         wxPrintf(wxString::Format("Runtime error message: %s\n", ex.getErrorMessage()));
     }
 }
 
-TableRef createLuaDomElementObject(Engine*engine, DomElement*domElement){
-    TableRef newObject=engine->getLua()->createNewLuaTable();
-    engine->getLua()->editGlobalTable([newObject, &engine](TableReaderWriter*tbl){
-        tbl->getTable("lxe", [newObject, &engine](TableReaderWriter*nestedTable){
-            TableRef prototypeObject=nestedTable->getTableRef("DomElementPrototype");
-            engine->getLua()->inheritTable(newObject, prototypeObject);
-        });
+std::string Engine::compileLxml(const char*source, size_t sourceLength, wxString fileName) {
+    //compilation needs only Lua compiler, no need for std libs or engine modules
+    Lua lua(true);
+    CompiledLxmlWriter writer([&lua, &fileName](std::string_view script, int line, std::string&bytecode, wxString&errorMessage) {
+        return lua.compile(script.data(), script.size(), wxString::Format("%s:%d", fileName, line), bytecode, errorMessage);
     });
-    
-    engine->getLua()->editTable(newObject, [domElement](TableReaderWriter*tbl){
-        tbl->put("_nativeHandler", domElement);
-    });
-    return newObject;
+    writer.addScriptTag("Script");
+    TagsParser parser(source, sourceLength, fileName);
+    configureParser(parser);
+    parser.parse(&writer);
+    return writer.getResult();
+}
+
+/**
+ Header of script cache file. Lua does not verify bytecode, so file is used only when it belongs to the same source
+ and its bytecode is complete and unchanged
+ */
+struct ScriptCacheHeader {
+    char magic[8];
+    uint64_t sourceHash;
+    uint64_t sourceLength;
+    uint64_t bytecodeHash;
+    uint64_t bytecodeLength;
+};
+static const char SCRIPT_CACHE_MAGIC[8]={'L', 'X', 'E', 'C', 'A', 'C', 'H', '1'};
+
+static bool isValidScriptCache(const char*data, size_t length, const std::string&source) {
+    if(length<sizeof(ScriptCacheHeader)) return false;
+    ScriptCacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    const char*bytecode=data+sizeof(header);
+    size_t bytecodeLength=length-sizeof(header);
+    return memcmp(header.magic, SCRIPT_CACHE_MAGIC, sizeof(header.magic))==0
+        && header.sourceLength==source.size() && header.sourceHash==hashBytes(source.data(), source.size())
+        && header.bytecodeLength==bytecodeLength && header.bytecodeHash==hashBytes(bytecode, bytecodeLength)
+        && bytecodeLength>strlen(LUA_SIGNATURE) && memcmp(bytecode, LUA_SIGNATURE, strlen(LUA_SIGNATURE))==0;
 }
 
-DomElement* Engine::recursivelyInitElement(Tag*tag, DomElement*parent) {
-    if(tagName2DomElementFactory.find(tag->getTagName()) == tagName2DomElementFactory.end())
-        throw RuntimeException(wxString::Format("Unknown tag name:%s", tag->getTagName()));
+bool Engine::evalScript(const wxString&source, const wxString&chunkName) {
+    if(scriptCacheDirectory.IsEmpty()) {
+        return lua->evalFile(source, chunkName);
+    }
+    std::string utf8(source.ToUTF8().data());
+    uint64_t sourceHash=hashBytes(utf8.data(), utf8.size());
+    //bytecode depends on Lua version and sizes of numbers, so they are part of the name
+    wxString cachePath=wxString::Format("%s/%016llx-%llx-%d-%d%d.luac", scriptCacheDirectory,
+        (unsigned long long)sourceHash, (unsigned long long)utf8.size(),
+        LUA_VERSION_RELEASE_NUM, (int)sizeof(lua_Integer), (int)sizeof(lua_Number));
+    MappedFile cachedFile;
+    if(cachedFile.open(cachePath) && isValidScriptCache(cachedFile.getData(), cachedFile.getLength(), utf8)) {
+        scriptCacheHits++;
+        return lua->evalBuffer(cachedFile.getData()+sizeof(ScriptCacheHeader), cachedFile.getLength()-sizeof(ScriptCacheHeader), chunkName);
+    }
+    //missing or damaged file is replaced
+    scriptCacheMisses++;
+    std::string bytecode;
+    wxString errorMessage;
+    if(!lua->compile(utf8.data(), utf8.size(), chunkName, bytecode, errorMessage)) {
+        wxPrintf("Lua error in file %s. Message: %s\n", chunkName, errorMessage);
+        return false;
+    }
+    ScriptCacheHeader header;
+    memcpy(header.magic, SCRIPT_CACHE_MAGIC, sizeof(header.magic));
+    header.sourceHash=sourceHash;
+    header.sourceLength=utf8.size();
+    header.bytecodeHash=hashBytes(bytecode.data(), bytecode.size());
+    header.bytecodeLength=bytecode.size();
+    //other process never sees partially written file
+    wxString temporaryPath=cachePath+".tmp";
+    wxFile cacheFile;
+    if(cacheFile.Create(temporaryPath, true) && cacheFile.Write(&header, sizeof(header)) && cacheFile.Write(bytecode.data(), bytecode.size()) && cacheFile.Close()) {
+        wxRenameFile(temporaryPath, cachePath, true);
+        pruneScriptCache(cachePath);
+    }
+    return lua->evalBuffer(bytecode.data(), bytecode.size(), chunkName);
+}
+
+void Engine::pruneScriptCache(const wxString&keptPath) {
+    //errors are ignored, cache still works when other process removes the same files
+    std::error_code error;
+    std::filesystem::path kept=std::filesystem::u8path(keptPath.ToUTF8().data());
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>>files;
+    for(std::filesystem::directory_iterator it(std::filesystem::u8path(scriptCacheDirectory.ToUTF8().data()), error), end; !error && it!=end; it.increment(error)) {
+        if(it->path().extension()!=".luac" || it->path()==kept)
+            continue;
+        std::error_code timeError;
+        std::filesystem::file_time_type modified=it->last_write_time(timeError);
+        if(!timeError)
+            files.push_back({modified, it->path()});
+    }
+    //kept file is the newest one
+    if((int)files.size()<scriptCacheLimit)
+        return;
+    std::sort(files.begin(), files.end());
+    size_t removedCount=files.size()-std::max(scriptCacheLimit-1, 0);
+    for(size_t i=0;i<removedCount;i++)
+        std::filesystem::remove(files[i].second, error);
+}
+
+TableRef Engine::createLuaDomElementObject(DomElement*domElement){
+    luaObjectsCreated++;
+    return lua->createUserData(domElementType, domElement);
+}
+
+DomElement*Engine::createDomElement(const wxString&tagName) {
+    Atom atom=findAtom(tagName);
+    if(atom==NO_ATOM)
+        throw RuntimeException(wxString::Format("Unknown tag name:%s", tagName));
+    return createDomElement(atom);
+}
+
+DomElement*Engine::createDomElement(Atom tagName) {
+    auto factory = tagName2DomElementFactory.find(tagName);
+    if(factory == tagName2DomElementFactory.end())
+        throw RuntimeException(wxString::Format("Unknown tag name:%s", atomName(tagName)));
     
-    std::function<DomElement*()> domElementSupplier = tagName2DomElementFactory[tag->getTagName()];
-    DomElement*element = domElementSupplier();
+    DomElement*element = factory->second();
     element->setEngine(this);
-    
-    TableRef luaObject=createLuaDomElementObject(this, element);
-    element->setLuaRef(luaObject);
-    
     element->setInitPhase(true);
-    element->initFromTag(tag);
-    
-    int childrenCount = (int)tag->getChildren().size();
-    if(childrenCount>0 && !element->isChildrenAllowed()) {
-        throw RuntimeException(wxString::Format("Tag '%s' does not accept child tags", element->getTagName()));
-    }
-    if(element->isInitChildrenBeforeTag()) {
-        for (int i = 0; i < childrenCount; i++) {
-            Tag* childTag = tag->getChildren()[i];
-            if(childTag->getType() == TagType_RAW_TEXT){
-                wxString textContent=element->getTextContent()+childTag->getText();
-                element->setTextContent(textContent);
-            } else if(childTag->getType() == TagType_TAG) {
-                recursivelyInitElement(childTag, element);
-            }
-        }
+    element->setTagName(tagName);
+    return element;
+}
+
+std::shared_ptr<TagsDocument> FragmentsCache::find(const wxString&text, size_t hash) {
+    auto it = entriesByHash.find(hash);
+    if(it == entriesByHash.end() || it->second->text != text) {
+        misses++;
+        return NULL;
+    }
+    hits++;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->document;
+}
+
+void FragmentsCache::put(const wxString&text, size_t hash, std::shared_ptr<TagsDocument>document) {
+    if(limit <= 0) return;
+    auto it = entriesByHash.find(hash);
+    if(it != entriesByHash.end()) {
+        //hash collision, newer fragment wins
+        entries.erase(it->second);
+    }
+    entries.push_front({hash, text, document});
+    entriesByHash[hash] = entries.begin();
+    evictOverLimit();
+}
+
+void FragmentsCache::setLimit(int limit) {
+    this->limit = limit;
+    evictOverLimit();
+}
+
+void FragmentsCache::evictOverLimit() {
+    while((int)entries.size() > std::max(limit, 0)) {
+        entriesByHash.erase(entries.back().hash);
+        entries.pop_back();
+        evictions++;
+    }
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-start).count();
+}
+
+void DurationStats::add(double milliseconds) {
+    if((int)recent.size()<RECENT_SAMPLES) {
+        recent.push_back(milliseconds);
+    } else {
+        recent[nextSample]=milliseconds;
+        nextSample=(nextSample+1)%RECENT_SAMPLES;
+    }
+    count++;
+    total+=milliseconds;
+    max=std::max(max, milliseconds);
+}
+
+double DurationStats::getPercentile(double p) {
+    if(recent.empty()) return 0;
+    std::vector<double>sorted(recent);
+    size_t index=std::min(sorted.size()-1, (size_t)(p*sorted.size()));
+    std::nth_element(sorted.begin(), sorted.begin()+index, sorted.end());
+    return sorted[index];
+}
+
+void GcScheduler::configure(const GcSettings&settings) {
+    this->settings=settings;
+    Lua*lua=engine->getLua();
+    if(settings.generational) {
+        lua->setGenerationalCollector(settings.minorMultiplier, settings.majorMultiplier);
+    } else {
+        lua->setIncrementalCollector(settings.pause, settings.stepMultiplier, settings.stepSize);
     }
+}
+
+void GcScheduler::beginEvent() {
+    if(eventDepth++>0) return;
+    //collector stopped by the application stays stopped after the event
+    collectorStopped=false;
+    if(settings.deferDuringEvents && engine->getLua()->isCollectorRunning()) {
+        engine->getLua()->stopCollector();
+        collectorStopped=true;
+    }
+}
+
+void GcScheduler::endEvent() {
+    if(--eventDepth>0) return;
+    if(collectorStopped) {
+        engine->getLua()->restartCollector();
+        collectorStopped=false;
+    }
+    scheduleIdleCollection();
+}
+
+void GcScheduler::scheduleIdleCollection() {
+    if(idleScheduled || settings.idleBudgetMs<=0 || !engine->getIdleScheduler()) return;
+    idleScheduled=true;
+    std::weak_ptr<GcScheduler*>weakLifetime=lifetime;
+    engine->getIdleScheduler()([weakLifetime](){
+        std::shared_ptr<GcScheduler*>scheduler=weakLifetime.lock();
+        if(scheduler) (*scheduler)->runIdleSlice();
+    });
+}
+
+void GcScheduler::runIdleSlice() {
+    idleScheduled=false;
+    //idle of nested event loop, the event schedules collection again when it ends
+    if(eventDepth>0) return;
+    Lua*lua=engine->getLua();
+    if(!lua->isCollectorRunning()) return;
+    auto start=std::chrono::steady_clock::now();
+    bool finished;
+    do {
+        finished=lua->collectStep();
+        idleSteps++;
+        //in generational mode every step is a whole young collection and state never returns to pause
+        if(settings.generational) finished=true;
+    } while(!finished && millisecondsSince(start)<settings.idleBudgetMs);
+    idlePauses.add(millisecondsSince(start));
+    if(finished) {
+        idleCycles++;
+    } else {
+        scheduleIdleCollection();
+    }
+}
+
+DomElementsBuilder::DomElementsBuilder(Engine*engine, DomElement*rootParent, bool singleRoot) {
+    this->engine=engine;
+    this->rootParent=rootParent;
+    this->singleRoot=singleRoot;
+}
+
+void DomElementsBuilder::initElement(OpenedElement&openedElement) {
+    DomElement*element=openedElement.element;
+    DomElement*parent=openedElement.parent;
     wxArrayString attributeNames = element->getAllSettedAtributeNames();
+    //indexed before initialization, so scripts and handlers running during it can find the element
+    engine->getElementsIndex().add(element);
     element->initElement(parent, &attributeNames);
     element->applyAttributes(&attributeNames);
     
@@ -445,22 +756,141 @@ DomElement* Engine::recursivelyInitElement(Tag*tag, DomElement*parent) {
         parent->onChildAdded(element);
     }
     element->onAddedToParent();
-    
-    if(!element->isInitChildrenBeforeTag()) {
-        for (int i = 0; i < childrenCount; i++) {
-            Tag* childTag = tag->getChildren()[i];
-            if(childTag->getType() == TagType_RAW_TEXT) {
-                wxString textContent=element->getTextContent()+childTag->getText();
-                element->setTextContent(textContent);
-            } else if(childTag->getType() == TagType_TAG) {
-                recursivelyInitElement(childTag, element);
-            }
-        }
+    openedElement.initialized=true;
+}
+
+DomElement*DomElementsBuilder::prepareParentForChild() {
+    OpenedElement&openedParent=openedElements.back();
+    DomElement*parent=openedParent.element;
+    if(!parent->isChildrenAllowed()) {
+        throw RuntimeException(wxString::Format("Tag '%s' does not accept child tags", parent->getTagName()));
     }
-    
+    if(!openedParent.initialized && !parent->isInitChildrenBeforeTag()) {
+        initElement(openedParent);
+    }
+    return parent;
+}
+
+void DomElementsBuilder::onOpenTag(std::string_view tagName, int line) {
+    DomElement*parent=rootParent;
+    if(!openedElements.empty()) {
+        parent=prepareParentForChild();
+    } else if(singleRoot && !createdElements.empty()) {
+        throw RuntimeException("Expected only one root tag");
+    }
+    //names of registered tags are interned, unknown names from markup must not grow the atom table
+    Atom tagAtom=AtomTable::instance().find(tagName);
+    if(tagAtom==NO_ATOM)
+        throw RuntimeException(wxString::Format("Unknown tag name:%s", wxString::FromUTF8(tagName.data(), tagName.size())));
+    DomElement*element=engine->createDomElement(tagAtom);
+    openedElements.push_back({element, parent, false});
+}
+
+void DomElementsBuilder::initAttribute(std::string_view name, const TagAttribute&value) {
+    DomElement*element=openedElements.back().element;
+    //names from schemas are always interned, same as in DomElement::setAttribute
+    Atom atom=AtomTable::instance().find(name);
+    if(atom==NO_ATOM)
+        throw RuntimeException(wxString::Format("Tag %s does not support attribute %s", element->getTagName(), wxString::FromUTF8(name.data(), name.size())));
+    element->initAttribute(atom, value);
+}
+
+void DomElementsBuilder::onAttribute(const TokenAttribute&attribute, int line) {
+    initAttribute(attribute.name, attribute.toTagAttribute());
+}
+
+void DomElementsBuilder::onTypedAttribute(std::string_view name, const TagAttribute&value, int line) {
+    initAttribute(name, value);
+}
+
+void DomElementsBuilder::onPrecompiledText(std::string_view bytecode, int line) {
+    DomElement*element=prepareParentForChild();
+    element->setPrecompiledTextContent(bytecode);
+}
+
+void DomElementsBuilder::onText(std::string_view text, int line) {
+    DomElement*element=prepareParentForChild();
+    wxString textContent=element->getTextContent()+spanToWxString(text);
+    element->setTextContent(textContent);
+}
+
+void DomElementsBuilder::onCloseTag(std::string_view tagName, int line) {
+    OpenedElement&openedElement=openedElements.back();
+    if(!openedElement.initialized) {
+        initElement(openedElement);
+    }
+    DomElement*element=openedElement.element;
+    openedElements.pop_back();
     element->setInitPhase(false);
     element->onFinishedInitialisation();
-    return element;
+    if(openedElements.empty()) {
+        createdElements.push_back(element);
+    }
+}
+
+void DomElementsBuilder::rollback() {
+    //innermost first. Initialized element is a child of the enclosing one and goes away with it
+    for(int i=(int)openedElements.size()-1;i>=0;i--) {
+        if(i==0 || !openedElements[i].initialized) {
+            engine->removeDomElement(openedElements[i].element);
+        }
+    }
+    openedElements.clear();
+    for(DomElement*element: createdElements) {
+        engine->removeDomElement(element);
+    }
+    createdElements.clear();
+}
+
+void Engine::scheduleRecreation(DomElement*domElement) {
+    recreationRequests++;
+    if(!idleScheduler) {
+        recreationsPerformed++;
+        domElement->recreate();
+        return;
+    }
+    if(domElement->isRecreationScheduled()) return;
+    domElement->setRecreationScheduled(true);
+    scheduledRecreations.push_back(domElement);
+    if(scheduledRecreations.size()==1) {
+        std::weak_ptr<Engine*>weakLifetime=lifetime;
+        idleScheduler([weakLifetime](){
+            std::shared_ptr<Engine*>engine=weakLifetime.lock();
+            if(engine) (*engine)->runScheduledRecreations();
+        });
+    }
+}
+
+void Engine::runScheduledRecreations() {
+    //recreations requested while running go to a new list with its own idle callback
+    std::vector<DomElement*>elements;
+    elements.swap(scheduledRecreations);
+    //runs from idle callback, failed element must not leave the others scheduled but out of the list
+    for(int i=0;i<elements.size();i++) {
+        try {
+            elements[i]->ensureRecreated();
+        } catch(RuntimeException&ex) {
+            wxPrintf(wxString::Format("Recreation of tag %s failed: %s\n", elements[i]->getTagName(), ex.getErrorMessage()));
+        } catch(std::exception&ex) {
+            wxPrintf(wxString::Format("Recreation of tag %s failed: %s\n", elements[i]->getTagName(), ex.what()));
+        }
+    }
+}
+
+void Engine::releaseRemovedElement(DomElement*domElement) {
+    if(domElement->isRecreationScheduled()) {
+        domElement->setRecreationScheduled(false);
+        scheduledRecreations.erase(std::remove(scheduledRecreations.begin(), scheduledRecreations.end(), domElement), scheduledRecreations.end());
+    }
+    //objects kept by scripts must not reach freed element
+    if(domElement->hasLuaRef()) {
+        getLua()->clearUserData(domElement->getLuaRef());
+        getLua()->tableRefRemove(domElement->getLuaRef());
+        domElement->clearLuaRef();
+    }
+    for(int i=0;i<domElement->getChildrenCount();i++) {
+        releaseRemovedElement(domElement->getChild(i));
+    }
 }
 
 void Engine::removeDomElement(DomElement*domElement) {
@@ -474,12 +904,9 @@ void Engine::removeDomElement(DomElement*domElement) {
         }
     }
     
-    if (domElement->hasSettedAttribute("id")) {
-        wxString id=domElement->getAttribute("id");
-        unregisterDomElementById(id);
-    }
-    getLua()->tableRefRemove(domElement->getLuaRef());
-    domElement->clearLuaRef();
+    elementsIndex.remove(domElement);
+    asyncTasks.cancelTasksOf(domElement);
+    releaseRemovedElement(domElement);
     domElement->destroyElement();
     //TODO: check if I should do delete domElement
 }
@@ -504,19 +931,9 @@ void Engine::fireElementIdChangedEvent(wxString&id, DomElement*domElement) {
     }
 }
 
-void Engine::unregisterDomElementById(wxString&id) {
-    if(idToDomElementMap.find(id)!=idToDomElementMap.end()) {
-        idToDomElementMap.erase(id);
-        fireElementIdChangedEvent(id, NULL);
-    }
-}
-
-void Engine::registerDomElementById(wxString&id, DomElement*domElement) {
-    idToDomElementMap[id]=domElement;
-    fireElementIdChangedEvent(id, domElement);
-}
-
 void Engine::replaceChildrenFromString(DomElement*currentDomElement, wxString&innerLXML) {
+    //children are created inside native window of the element, it must not be replaced after them
+    currentDomElement->ensureRecreated();
     int childrenCount=currentDomElement->getChildrenCount();
     for (int i=0; i<childrenCount; i++) {
         removeDomElement(currentDomElement->getChild(0));
@@ -526,16 +943,29 @@ void Engine::replaceChildrenFromString(DomElement*currentDomElement, wxString&in
     innerLXML.Trim();
     if(innerLXML.IsEmpty()) return;
     
-    TagsParser parser = createParser(innerLXML, "innerLXML");
-    std::vector<Tag*>tags = parser.parseTags();
-    for(int i=0;i<tags.size();i++){
-        DomElement*newChildElement = recursivelyInitElement(tags[i], currentDomElement);
-        delete tags[i];
+    size_t hash = std::hash<wxString>()(innerLXML);
+    std::shared_ptr<TagsDocument> document = fragmentsCache.find(innerLXML, hash);
+    if(!document) {
+        TagsParser parser(innerLXML, "innerLXML");
+        configureParser(parser);
+        document.reset(parser.parseTags());
+        fragmentsCache.put(innerLXML, hash, document);
     }
+    DomElementsBuilder builder(this, currentDomElement, false);
+    try {
+        document->replay(&builder);
+    } catch(...) {
+        builder.rollback();
+        throw;
+    }
+}
+
+DomElement*Engine::querySelector(const wxString&selector) {
+    return elementsIndex.querySelector(Selector::parse(selector));
 }
 
-DomElement*Engine::getDomElementById(wxString&id) {
-    return idToDomElementMap[id];
+void Engine::querySelectorAll(const wxString&selector, std::vector<DomElement*>&result) {
+    elementsIndex.querySelectorAll(Selector::parse(selector), result);
 }
 
 ExecBuilder Engine::execFunctionFromAttributeBuilder(const TagAttribute&tagAttribute) {
@@ -548,13 +978,14 @@ ExecBuilder Engine::execFunctionFromAttributeBuilder(const TagAttribute&tagAttri
     }
 }
 
+void Engine::runEventHandler(DomElement*owner, const TagAttribute&handler) {
+    asyncTasks.start(owner, handler);
+}
+
 DomElement*getSelfDomElement(Engine*engine, ValuesListReader*args) {
-    DomElement* domElement;
-    args->getTable(0, [&domElement](TableReader*tableReader){
-        domElement=(DomElement*)tableReader->getUserData("_nativeHandler");
-    });
+    DomElement*domElement=(DomElement*)args->getUserData(0, engine->getDomElementType());
     if(domElement==NULL) {
-        throw NativeError(wxString::Format("Cannot extract _nativehandle from dom element"));
+        throw NativeError(wxString::Format("Self is not a dom element or the element was removed"));
     }
     return domElement;
 }
@@ -603,75 +1034,291 @@ TagAttribute extractTagAttributeValueFromArgs(ValuesListReader*args, int index)
     }
 }
 
-void ffi_DomElementPrototype_setAttribute(Engine*engine, ValuesListReader*args, ValuesListWriter*retValues) {
-    DomElement*domElement = getSelfDomElement(engine, args);
-    wxString attributeName = args->getString(1);
+//argument and result types of functions bound by NativeBinding, context of all of them is Engine
+namespace lxe {
+template<> struct LuaArgument<DomElement*> {
+    static DomElement*get(lua_State*state, int index, void*context) {
+        ValuesListReader args(Lua::fromState(state), state, index, 1);
+        return getSelfDomElement((Engine*)context, &args);
+    }
+};
+template<> struct LuaArgument<TagAttribute> {
+    static TagAttribute get(lua_State*state, int index, void*context) {
+        ValuesListReader args(Lua::fromState(state), state, index, 1);
+        return extractTagAttributeValueFromArgs(&args, 0);
+    }
+};
+template<> struct LuaResult<TagAttribute> {
+    static int push(lua_State*state, void*context, TagAttribute attribute) {
+        if(attribute.getType()==TA_NULL) {
+            lua_pushnil(state);
+            return 1;
+        }
+        ValuesListWriter retValues(Lua::fromState(state), state);
+        pushAttributeToFunctionResult(&attribute, &retValues);
+        return retValues.getValuesCount();
+    }
+};
+template<> struct LuaResult<DomElement*> {
+    static int push(lua_State*state, void*context, DomElement*domElement) {
+        if(domElement==NULL) {
+            lua_pushnil(state);
+            return 1;
+        }
+        lua_rawgeti(state, LUA_REGISTRYINDEX, domElement->getLuaRef().ref);
+        return 1;
+    }
+};
+template<> struct LuaResult<std::vector<DomElement*>> {
+    static int push(lua_State*state, void*context, const std::vector<DomElement*>&domElements) {
+        lua_createtable(state, (int)domElements.size(), 0);
+        for(int i=0;i<domElements.size();i++) {
+            lua_rawgeti(state, LUA_REGISTRYINDEX, domElements[i]->getLuaRef().ref);
+            lua_rawseti(state, -2, i+1);
+        }
+        return 1;
+    }
+};
+}
+
+void ffi_DomElementPrototype_setAttribute(Engine*engine, DomElement*domElement, LuaAtom name, TagAttribute attribute) {
+    wxString attributeName=name.atom!=NO_ATOM?atomName(name.atom):wxString::FromUTF8(name.name.data(), name.name.size());
     try {
-        TagAttribute attribute=extractTagAttributeValueFromArgs(args, 2);
-        domElement->setAttribute(attributeName, attribute);
+        if(name.atom==NO_ATOM) {
+            //names from schemas are always interned, so unknown name cannot be allowed
+            throw RuntimeException(wxString::Format("Tag %s does not support attribute %s", domElement->getTagName(), attributeName));
+        }
+        domElement->setAttribute(name.atom, attribute);
     } catch(RuntimeException&ex) {
         throw NativeError(wxString::Format("Cannot set attribute '%s'. Error message: %s", attributeName, ex.getErrorMessage()));
     }
 }
 
-void ffi_DomElementPrototype_getAttribute(Engine*engine, ValuesListReader*args, ValuesListWriter*retValues) {
-    DomElement*domElement=getSelfDomElement(engine, args);
-    wxString attributeName=args->getString(1);
+void ffi_DomElementPrototype_setAttributes(Engine*engine, ValuesListReader*args, ValuesListWriter*retValues) {
+    DomElement*domElement = getSelfDomElement(engine, args);
+    try {
+        AttributeBatch batch(domElement);
+        args->getTable(1, [domElement](TableReader*table) {
+            table->forEachStringKey([domElement](std::string_view name, ValuesListReader*value) {
+                Atom atom=AtomTable::instance().find(name);
+                wxString attributeName=atom!=NO_ATOM?atomName(atom):wxString::FromUTF8(name.data(), name.size());
+                try {
+                    if(atom==NO_ATOM) {
+                        throw RuntimeException(wxString::Format("Tag %s does not support attribute %s", domElement->getTagName(), attributeName));
+                    }
+                    TagAttribute attribute=extractTagAttributeValueFromArgs(value, 0);
+                    domElement->setAttribute(atom, attribute);
+                } catch(RuntimeException&ex) {
+                    throw NativeError(wxString::Format("Cannot set attribute '%s'. Error message: %s", attributeName, ex.getErrorMessage()));
+                }
+            });
+        });
+    } catch(RuntimeException&ex) {
+        throw NativeError(wxString::Format("Cannot set attributes. Error message: %s", ex.getErrorMessage()));
+    }
+}
+
+///dynamic attributes are looked up by name, because they do not have to be in schema of the tag
+TagAttribute ffi_DomElementPrototype_getAttribute(Engine*engine, DomElement*domElement, LuaAtom name) {
     TagAttribute attribute;
+    domElement->ensureRecreated();
+    wxString attributeName=name.atom!=NO_ATOM?atomName(name.atom):wxString::FromUTF8(name.name.data(), name.name.size());
     if(domElement->getDynamicAttributeValue(attributeName, attribute)) {
-        pushAttributeToFunctionResult(&attribute, retValues);
-        return;
+        return attribute;
     }
-    if(!domElement->hasSettedAttribute(attributeName)) {
-        return;//nil
+    if(name.atom==NO_ATOM || !domElement->hasSettedAttribute(name.atom)) {
+        return TagAttribute().setNull();
     }
-    attribute=domElement->getComputedAttribute(attributeName);
-    pushAttributeToFunctionResult(&attribute, retValues);
+    return domElement->getComputedAttributeWithoutDynamic(name.atom);
 }
 
-int ffi_DomElementPrototype_hasAttribute(Engine*engine, ValuesListReader*args) {
-    DomElement*domElement = getSelfDomElement(engine, args);
-    wxString attributeName = args->getString(1);
-    return domElement->hasSettedAttribute(attributeName);
+///el.name reads attribute, methods are found in prototype before this is called
+TagAttribute ffi_DomElement_getField(Engine*engine, DomElement*domElement, LuaAtom name) {
+    if(!name.isString()) return TagAttribute().setNull();
+    return ffi_DomElementPrototype_getAttribute(engine, domElement, name);
 }
 
-void ffi_Document_getElementById(Engine*engine, ValuesListReader*args, ValuesListWriter*retValues) {
-    wxString id=args->getString(1);
-    
-    DomElement*domElement=engine->getDomElementById(id);
-    retValues->pushTableRef(domElement->getLuaRef(), false);
+bool ffi_DomElementPrototype_hasAttribute(Engine*engine, DomElement*domElement, LuaAtom name) {
+    return name.atom!=NO_ATOM && domElement->hasSettedAttribute(name.atom);
+}
+
+DomElement*ffi_Document_getElementById(Engine*engine, LuaUnused document, wxString id) {
+    return engine->getDomElementById(id);
+}
+
+DomElement*ffi_Document_querySelector(Engine*engine, LuaUnused document, wxString selector) {
+    return engine->querySelector(selector);
+}
+
+std::vector<DomElement*>ffi_Document_querySelectorAll(Engine*engine, LuaUnused document, wxString selector) {
+    std::vector<DomElement*>domElements;
+    engine->querySelectorAll(selector, domElements);
+    return domElements;
+}
+
+void ffi_Lxe_setFragmentCacheLimit(Engine*engine, int limit) {
+    engine->getFragmentsCache().setLimit(limit);
+}
+
+void ffi_Lxe_getFragmentCacheStats(Engine*engine, ValuesListWriter*retValues) {
+    FragmentsCache&cache = engine->getFragmentsCache();
+    retValues->pushTable([&cache](TableWriter*table){
+        table->put("hits", (double)cache.getHits());
+        table->put("misses", (double)cache.getMisses());
+        table->put("evictions", (double)cache.getEvictions());
+        table->put("size", cache.getSize());
+        table->put("limit", cache.getLimit());
+    });
+}
+
+void ffi_Lxe_getRecreationStats(Engine*engine, ValuesListWriter*retValues) {
+    retValues->pushTable([engine](TableWriter*table){
+        table->put("requested", (double)engine->getRecreationRequests());
+        table->put("performed", (double)engine->getRecreationsPerformed());
+        table->put("avoided", (double)(engine->getRecreationRequests()-engine->getRecreationsPerformed()));
+    });
+}
+
+void ffi_Lxe_getMemoryStats(Engine*engine, ValuesListWriter*retValues) {
+    LuaAllocator*allocator=engine->getLua()->getAllocator();
+    retValues->pushTable([allocator](TableWriter*table){
+        table->put("live", (double)allocator->getLiveBytes());
+        table->put("peak", (double)allocator->getPeakBytes());
+        table->put("pool", (double)allocator->getPoolBytes());
+        table->put("allocations", (double)allocator->getAllocations());
+        table->put("allocatedBytes", (double)allocator->getAllocatedBytes());
+        table->put("allocationRate", allocator->getAllocationRate());
+    });
+}
+
+void ffi_Lxe_getGcStats(Engine*engine, ValuesListWriter*retValues) {
+    GcScheduler&scheduler=engine->getGcScheduler();
+    retValues->pushTable([&scheduler](TableWriter*table){
+        DurationStats&pauses=scheduler.getIdlePauses();
+        DurationStats&handlers=scheduler.getHandlers();
+        table->put("idleSteps", (double)scheduler.getIdleSteps());
+        table->put("idleCycles", (double)scheduler.getIdleCycles());
+        table->put("idleSlices", (double)pauses.getCount());
+        table->put("idlePauseTotalMs", pauses.getTotal());
+        table->put("idlePauseMaxMs", pauses.getMax());
+        table->put("idlePauseP50Ms", pauses.getPercentile(0.5));
+        table->put("idlePauseP99Ms", pauses.getPercentile(0.99));
+        table->put("handlers", (double)handlers.getCount());
+        table->put("handlerMaxMs", handlers.getMax());
+        table->put("handlerP50Ms", handlers.getPercentile(0.5));
+        table->put("handlerP95Ms", handlers.getPercentile(0.95));
+        table->put("handlerP99Ms", handlers.getPercentile(0.99));
+    });
+}
+
+///fields missing in table keep their current values
+void ffi_Lxe_configureGc(Engine*engine, ValuesListReader*args) {
+    if(args->getType(0)!=LTYPE_TABLE) {
+        throw NativeError("lxe.configureGc expects table of settings");
+    }
+    GcSettings settings=engine->getGcScheduler().getSettings();
+    args->getTable(0, [&settings](TableReader*table){
+        if(table->exists("mode")) {
+            wxString mode=table->getString("mode");
+            if(mode!="incremental" && mode!="generational") {
+                throw NativeError(wxString::Format("Unknown collector mode '%s'", mode));
+            }
+            settings.generational=mode=="generational";
+        }
+        if(table->exists("pause")) settings.pause=table->getInt("pause");
+        if(table->exists("stepMultiplier")) settings.stepMultiplier=table->getInt("stepMultiplier");
+        if(table->exists("stepSize")) settings.stepSize=table->getInt("stepSize");
+        if(table->exists("minorMultiplier")) settings.minorMultiplier=table->getInt("minorMultiplier");
+        if(table->exists("majorMultiplier")) settings.majorMultiplier=table->getInt("majorMultiplier");
+        if(table->exists("idleBudgetMs")) settings.idleBudgetMs=table->getDouble("idleBudgetMs");
+        if(table->exists("deferDuringEvents")) settings.deferDuringEvents=table->getBool("deferDuringEvents");
+    });
+    engine->getGcScheduler().configure(settings);
+}
+
+int ffi_Lxe_startTimer(Engine*engine, lua_State*thread, int milliseconds) {
+    return engine->getAsyncTasks().startTimer(thread, milliseconds);
+}
+
+int ffi_Lxe_startFileRead(Engine*engine, lua_State*thread, wxString path) {
+    return engine->getAsyncTasks().startFileRead(thread, path);
+}
+
+int ffi_Lxe_startProcessOutput(Engine*engine, lua_State*thread, wxString command) {
+    return engine->getAsyncTasks().startProcessOutput(thread, command);
+}
+
+void ffi_Lxe_await(Engine*engine, lua_State*thread, int operationId) {
+    engine->getAsyncTasks().await(thread, operationId);
+}
+
+void Engine::initDomElementType() {
+    lua->editGlobalTable([this](TableReaderWriter*tbl){
+        tbl->getTable("lxe", [this](TableReaderWriter*lxeTable){
+            domElementPrototype=lxeTable->getTableRef("DomElementPrototype");
+        });
+    });
+    //el.name = value has the same arguments as el:setAttribute(name, value)
+    domElementType=lua->createUserDataType<ffi_DomElement_getField, ffi_DomElementPrototype_setAttribute>(domElementPrototype, this);
 }
 
 void Engine::registerNativeFunctions(){
-    lua->registerNativeFunction("DomElementPrototype_hasAttribute", [this](ValuesListReader*args, ValuesListWriter*retValues) {
-        retValues->pushBool(ffi_DomElementPrototype_hasAttribute(this, args));
+    lua->bindNativeFunction<ffi_DomElementPrototype_hasAttribute>("DomElementPrototype_hasAttribute", this);
+    lua->bindNativeFunction<ffi_DomElementPrototype_getAttribute>("DomElementPrototype_getAttribute", this);
+    lua->bindNativeFunction<ffi_DomElementPrototype_setAttribute>("DomElementPrototype_setAttribute", this);
+    lua->registerNativeFunction("DomElementPrototype_setAttributes", [this](ValuesListReader*args, ValuesListWriter*retValues) {
+        ffi_DomElementPrototype_setAttributes(this, args, retValues);
+    });
+    lua->bindNativeFunction<ffi_Document_getElementById>("Document_getElementById", this);
+    lua->bindNativeFunction<ffi_Document_querySelector>("Document_querySelector", this);
+    lua->bindNativeFunction<ffi_Document_querySelectorAll>("Document_querySelectorAll", this);
+    lua->bindNativeFunction<ffi_Lxe_setFragmentCacheLimit>("Lxe_setFragmentCacheLimit", this);
+    lua->registerNativeFunction("Lxe_getFragmentCacheStats", [this](ValuesListReader*args, ValuesListWriter*retValues) {
+        ffi_Lxe_getFragmentCacheStats(this, retValues);
     });
-    lua->registerNativeFunction("DomElementPrototype_getAttribute", [this](ValuesListReader*args, ValuesListWriter*retValues) {
-        ffi_DomElementPrototype_getAttribute(this, args, retValues);
+    lua->registerNativeFunction("Lxe_getRecreationStats", [this](ValuesListReader*args, ValuesListWriter*retValues) {
+        ffi_Lxe_getRecreationStats(this, retValues);
     });
-    lua->registerNativeFunction("DomElementPrototype_setAttribute", [this](ValuesListReader*args, ValuesListWriter*retValues) {
-        ffi_DomElementPrototype_setAttribute(this, args, retValues);
+    lua->registerNativeFunction("Lxe_getMemoryStats", [this](ValuesListReader*args, ValuesListWriter*retValues) {
+        ffi_Lxe_getMemoryStats(this, retValues);
     });
-    lua->registerNativeFunction("Document_getElementById", [this](ValuesListReader*args, ValuesListWriter*retValues) {
-        ffi_Document_getElementById(this, args, retValues);
+    lua->bindNativeFunction<ffi_Lxe_startTimer>("Lxe_startTimer", this);
+    lua->bindNativeFunction<ffi_Lxe_startFileRead>("Lxe_startFileRead", this);
+    lua->bindNativeFunction<ffi_Lxe_startProcessOutput>("Lxe_startProcessOutput", this);
+    lua->bindNativeFunction<ffi_Lxe_await>("Lxe_await", this);
+    lua->registerNativeFunction("Lxe_getGcStats", [this](ValuesListReader*args, ValuesListWriter*retValues) {
+        ffi_Lxe_getGcStats(this, retValues);
+    });
+    lua->registerNativeFunction("Lxe_configureGc", [this](ValuesListReader*args, ValuesListWriter*retValues) {
+        ffi_Lxe_configureGc(this, args);
     });
 }
 
 //----------------- Script
+const AttributesSchema*Script::getAttributesSchema() {
+    static AttributesSchema schema(DomElement::getAttributesSchema(), NULL, 0);
+    return &schema;
+}
+
 Script::Script() {
-    if(allowedAttributes==NULL) {
-        allowedAttributes=createAndFillStringsMap({});
-    }
-    addAllowedAttributeNamesMap(allowedAttributes);
+    setAttributesSchema(getAttributesSchema());
     setChildrenAllowed(true);
 }
 
+void Script::setPrecompiledTextContent(std::string_view bytecode) {
+    precompiledContent.assign(bytecode.data(), bytecode.size());
+}
+
 void Script::onFinishedInitialisation() {
-    getEngine()->getLua()->evalFile(getTextContent(), "scriptTag");
+    if(!precompiledContent.empty()) {
+        getEngine()->getLua()->evalBuffer(precompiledContent.data(), precompiledContent.size(), "scriptTag");
+        return;
+    }
+    getEngine()->evalScript(getTextContent(), "scriptTag");
 }
 
-bool Script::handleChangedAttribute(const wxString&name, TagAttribute&oldValue, TagAttribute&newValue) {
-    return DomElement::handleChangedAttribute(name, oldValue, newValue);
+bool Script::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    return DomElement::handleChangedAttribute(attribute, oldValue, newValue);
 }
 
 bool Script::getDynamicAttributeValue(const wxString&attributeName, TagAttribute&tagAttribute) {
@@ -7,13 +7,26 @@
 
 namespace lxe {
 class Engine;
+
+/**
+ Ids of attribute handlers in AttributeDeclaration tables. Ids are unique along class hierarchy,
+ derived classes continue numbering from DOM_ELEMENT_HANDLERS_END
+ */
+enum DomElementAttributeHandler {
+    NO_ATTRIBUTE_HANDLER=0,
+    DOM_ELEMENT_INNER_LXML,
+    DOM_ELEMENT_HANDLERS_END
+};
+
 class DomElement {
 private:
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
-    TableRef luaRef;
+    struct PendingAttributeChange {
+        const AttributeSchemaEntry*attribute;
+        TagAttribute oldValue;
+    };
+    TableRef luaRef={0};
     wxString id;
-    wxString tagName;
+    Atom tagName=NO_ATOM;
     Engine*engine;
     bool initPhase;
     DomElement*parent;
@@ -24,27 +37,44 @@ private:
     std::unordered_map<int, bool> registeredEvents;
     bool childrenAllowed = false;
     bool initChildrenBeforeTag = false;
+    int attributeBatchDepth = 0;
+    bool recreationPending = false;
+    bool recreationScheduled = false;
+    std::vector<PendingAttributeChange>pendingAttributeChanges;
+    void onAttributeChanged(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue);
 protected:
-    void addAllowedAttributeNamesMap(String2BoolHashMap*map);
-    void addRecreationAttributeNamesMap(String2BoolHashMap*map);
+    ///called by constructor of every class in hierarchy, so schema of the most derived class wins
+    void setAttributesSchema(const AttributesSchema*schema) {attributes.setSchema(schema);}
     bool isAttributeRequireRecreation(const wxString&name);
+    bool isAttributeRequireRecreation(Atom name);
+    const TagAttribute*findSettedAttribute(const wxString&attributeName);
     void registerEvent(int event, const wxString&fieldName, std::function<void()>createListener, std::function<void()>deleteListener);
     void setChildrenAllowed(bool value){childrenAllowed=value;}
     void setInitChildrenBeforeTag(bool value){initChildrenBeforeTag=value;}
+    ///called once at the end of attribute batch, after change handlers. Classes apply changes they deferred during batch here
+    virtual void onAttributeBatchApplied() {}
     
 public:
     DomElement();
     virtual ~DomElement(){}
+    static const AttributesSchema*getAttributesSchema();
+    ///schema set on this element, the one of its most derived class
+    const AttributesSchema*getSchema(){return attributes.getSchema();}
     virtual void repaint(){}
-    void initFromTag(Tag*tag);
-    void setLuaRef(TableRef luaRef){this->luaRef=luaRef;}
-    TableRef&getLuaRef(){return this->luaRef;}
+    void setTagName(Atom tagName){this->tagName=tagName;}
+    ///sets attribute from markup without firing change events
+    void initAttribute(Atom name, const TagAttribute&value);
+    ///Lua userdata of element is created on first access, most elements are never touched by scripts
+    TableRef&getLuaRef();
+    bool hasLuaRef(){return luaRef.ref!=0;}
     void clearLuaRef(){luaRef.ref=0;}
-    int getLuaRefHandle(){return this->luaRef.ref;}
     void setEngine(Engine*engine) {this->engine=engine;}
     Engine*getEngine() {return engine;}
-    wxString& getTagName() {return tagName;}
+    const wxString& getTagName() {return atomName(tagName);}
+    Atom getTagNameAtom() {return tagName;}
     void setTextContent(wxString&text) {this->textContent=text;}
+    ///content compiled from .lxmlc, only elements that execute their text(like Script) support it
+    virtual void setPrecompiledTextContent(std::string_view bytecode);
     wxString&getTextContent() {return textContent;};
     void setParent(DomElement*parent) {this->parent=parent;}
     DomElement* getParent() {return parent;}
@@ -56,6 +86,13 @@ public:
     virtual void initElement(DomElement*parent,wxArrayString*attributesNames) {}
     virtual void destroyElement() {}
     virtual void recreate();
+    ///recreation is deferred by engine and coalesced, change handlers are skipped until it runs
+    void scheduleRecreation();
+    bool isRecreationScheduled() {return recreationScheduled;}
+    ///managed by Engine that keeps list of scheduled elements
+    void setRecreationScheduled(bool value) {recreationScheduled=value;}
+    ///runs scheduled recreation now, called before native state of element is read
+    void ensureRecreated();
     void applyAttributes(wxArrayString*attributesNames);
     DomElement* getChild(int index){return children[index];}
     int getChildrenCount()const{return (int)children.size();}
@@ -71,11 +108,23 @@ public:
     int getChildIndex(DomElement*child);
     virtual void addChild(DomElement*child);
     virtual void removeChildByIndex(int index);
-    virtual bool handleChangedAttribute(const wxString&name, TagAttribute&oldValue, TagAttribute&newValue);
+    ///dispatches on attribute.handlerId, ids not handled by class are passed to its parent class
+    virtual bool handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue);
+    ///returns NULL if tag does not support attribute
+    const AttributeSchemaEntry*findAttributeSchemaEntry(Atom attributeName) {return attributes.findSchemaEntry(attributeName);}
     wxArrayString getAllSettedAtributeNames();
+    int getSettedAttributesCount() {return attributes.getSettedAttributesCount();}
+    Atom getSettedAttributeName(int index) {return attributes.getSettedAttributeName(index);}
     bool hasSettedAttribute(const wxString&attributeName);
+    bool hasSettedAttribute(Atom attributeName);
     
     void setAttribute(const wxString&attributeName, TagAttribute&value);
+    void setAttribute(Atom attributeName, TagAttribute&value);
+    ///change handlers of attributes set inside batch are deferred to its end, use AttributeBatch instead of calling directly
+    void beginAttributeBatch();
+    ///fires handler once for every attribute changed in batch, or recreates element once if any changed attribute requires it
+    void endAttributeBatch();
+    bool isAttributeBatchActive() {return attributeBatchDepth>0;}
     virtual bool getDynamicAttributeValue(const wxString&attributeName, TagAttribute&tagAttribute);
     TagAttributeType getAttributeType(const wxString&attributeName);
     wxString getAttribute(const wxString&attributeName, const wxString&defaultValue);
@@ -84,46 +133,269 @@ public:
     double getAttribute(const wxString&attributeName, double defaultValue);
     bool getAttribute(const wxString&attributeName, bool defaultValue);
     TagAttribute getComputedAttributeWithoutDynamic(const wxString&attributeName);
+    TagAttribute getComputedAttributeWithoutDynamic(Atom attributeName);
     TagAttribute getComputedAttribute(const wxString&attributeName);
 };
 
+/**
+ Scope grouping attribute changes of element, so setting several attributes recreates element and
+ runs its change handlers at most once. Batches may nest, changes are applied when outermost ends
+ */
+class AttributeBatch {
+    DomElement*element;
+    int uncaughtExceptions;
+public:
+    explicit AttributeBatch(DomElement*element);
+    ///throws exceptions of change handlers unless stack is already unwinding
+    ~AttributeBatch() noexcept(false);
+    AttributeBatch(const AttributeBatch&)=delete;
+    AttributeBatch&operator=(const AttributeBatch&)=delete;
+};
+
+/**
+ Creates dom elements directly from parser events. Element is initialized when its attributes are read,
+ or after its children if element requires children to be initialized first
+ */
+class DomElementsBuilder: public TagsHandler {
+private:
+    struct OpenedElement {
+        DomElement*element;
+        DomElement*parent;
+        bool initialized;
+    };
+    Engine*engine;
+    DomElement*rootParent;
+    bool singleRoot;
+    std::vector<OpenedElement>openedElements;
+    std::vector<DomElement*>createdElements;
+    void initElement(OpenedElement&openedElement);
+    DomElement*prepareParentForChild();
+    void initAttribute(std::string_view name, const TagAttribute&value);
+public:
+    DomElementsBuilder(Engine*engine, DomElement*rootParent, bool singleRoot);
+    void onOpenTag(std::string_view tagName, int line)override;
+    void onAttribute(const TokenAttribute&attribute, int line)override;
+    void onTypedAttribute(std::string_view name, const TagAttribute&value, int line)override;
+    void onText(std::string_view text, int line)override;
+    void onPrecompiledText(std::string_view bytecode, int line)override;
+    void onCloseTag(std::string_view tagName, int line)override;
+    bool isLineNumbersRequired()override{return false;}
+    std::vector<DomElement*>&getCreatedElements(){return createdElements;}
+    ///removes elements created so far, including unfinished ones. Called when parsing or creation throws
+    void rollback();
+};
+
+/**
+ LRU cache of parsed innerLXML fragments keyed by hash of the text. Parsed documents are immutable and shared,
+ so fragment evicted while its elements are being created stays alive until the creation ends
+ */
+class FragmentsCache {
+private:
+    struct Entry {
+        size_t hash;
+        wxString text;
+        std::shared_ptr<TagsDocument> document;
+    };
+    std::list<Entry>entries;//most recently used first
+    std::unordered_map<size_t, std::list<Entry>::iterator>entriesByHash;
+    int limit=32;
+    long long hits=0;
+    long long misses=0;
+    long long evictions=0;
+    void evictOverLimit();
+public:
+    std::shared_ptr<TagsDocument> find(const wxString&text, size_t hash);
+    void put(const wxString&text, size_t hash, std::shared_ptr<TagsDocument>document);
+    ///0 disables caching
+    void setLimit(int limit);
+    int getLimit(){return limit;}
+    int getSize(){return (int)entries.size();}
+    long long getHits(){return hits;}
+    long long getMisses(){return misses;}
+    long long getEvictions(){return evictions;}
+};
+
+/**
+ Count, total and max of durations in milliseconds. Percentiles are computed from the most recent samples
+ */
+class DurationStats {
+private:
+    static const int RECENT_SAMPLES=1024;
+    std::vector<double>recent;
+    int nextSample=0;
+    long long count=0;
+    double total=0;
+    double max=0;
+public:
+    void add(double milliseconds);
+    ///p is in range 0..1, returns 0 when there are no samples
+    double getPercentile(double p);
+    long long getCount(){return count;}
+    double getTotal(){return total;}
+    double getMax(){return max;}
+};
+
+/**
+ Policy of the Lua collector. Zero parameters keep Lua defaults
+ */
+struct GcSettings {
+    bool generational=false;
+    int pause=0;
+    int stepMultiplier=0;
+    int stepSize=0;
+    int minorMultiplier=0;
+    int majorMultiplier=0;
+    ///time of collector work per idle slice, 0 disables idle collection
+    double idleBudgetMs=2;
+    ///collector is stopped while event handlers run, garbage they made is collected on idle
+    bool deferDuringEvents=false;
+};
+
+/**
+ Moves work of the Lua collector out of event handlers. After every event a collection cycle is run in
+ idle slices limited by time budget, so automatic steps triggered by allocation debt rarely land inside handlers
+ */
+class GcScheduler {
+private:
+    Engine*engine;
+    GcSettings settings;
+    int eventDepth=0;
+    bool idleScheduled=false;
+    bool collectorStopped=false;
+    long long idleSteps=0;
+    long long idleCycles=0;
+    DurationStats idlePauses;
+    DurationStats handlers;
+    //idle callbacks hold weak pointer, slices coming after engine is destroyed are dropped
+    std::shared_ptr<GcScheduler*>lifetime=std::make_shared<GcScheduler*>(this);
+public:
+    GcScheduler(Engine*engine){this->engine=engine;}
+    ///applies collector mode of settings to Lua state of the engine
+    void configure(const GcSettings&settings);
+    const GcSettings&getSettings(){return settings;}
+    ///events may nest, collector is restarted and idle collection scheduled when the outermost one ends.
+    ///Handler suspended in lxe.await runs as several events
+    void beginEvent();
+    void endEvent();
+    ///time one handler ran, sum of its events
+    void addHandlerDuration(double milliseconds){handlers.add(milliseconds);}
+    ///does nothing without idle scheduler of the engine
+    void scheduleIdleCollection();
+    ///runs collector steps until the cycle finishes or budget is spent, unfinished cycle continues on next idle
+    void runIdleSlice();
+    long long getIdleSteps(){return idleSteps;}
+    long long getIdleCycles(){return idleCycles;}
+    ///durations of idle slices
+    DurationStats&getIdlePauses(){return idlePauses;}
+    ///durations of event handlers including collector steps they triggered, one sample per handler
+    DurationStats&getHandlers(){return handlers;}
+};
+
 class Engine {
 private:
     Lua*lua;
     SerializedFolderReader serializedFolderReader;
-    DomElement*rootElement;
-    std::unordered_map<wxString, std::function<DomElement*()>> tagName2DomElementFactory;
-    std::unordered_map<wxString, DomElement*>idToDomElementMap;
+    DomElement*rootElement=NULL;
+    std::unordered_map<Atom, std::function<DomElement*()>> tagName2DomElementFactory;
+    ElementsIndex elementsIndex;
     std::vector<std::function<void(wxString, DomElement*)>>elementIdChangedEventHandlers;
     long long handleGenerator=0;
+    ///lxe.DomElementPrototype holds methods of elements, other fields of their Lua objects are attributes
+    TableRef domElementPrototype={0};
+    UserDataType domElementType;
+    long long luaObjectsCreated=0;
+    FragmentsCache fragmentsCache;
+    std::function<void(std::function<void()>)>idleScheduler;
+    std::vector<DomElement*>scheduledRecreations;
+    long long recreationRequests=0;
+    long long recreationsPerformed=0;
+    wxString scriptCacheDirectory;
+    long long scriptCacheHits=0;
+    long long scriptCacheMisses=0;
+    int scriptCacheLimit=256;
+    void pruneScriptCache(const wxString&keptPath);
+    GcScheduler gcScheduler;
+    AsyncTasks asyncTasks;
+    //idle callbacks hold weak pointer, so callback coming after engine is destroyed does nothing
+    std::shared_ptr<Engine*>lifetime=std::make_shared<Engine*>(this);
+    ///drops state kept for removed element and its descendants, their native windows are destroyed with it
+    void releaseRemovedElement(DomElement*domElement);
+    void buildDocument(std::function<void(TagsHandler*handler)>parse, wxString&fileName);
 public:
-    Engine() { init(); }
+    Engine():elementsIndex(this),gcScheduler(this),asyncTasks(this) { init(); }
     virtual void init();
     void initLua();
     void registerNativeFunctions();
+    ///resolves prototype of elements from lxe.lua and creates userdata type of their Lua objects
+    void initDomElementType();
     Lua*getLua(){return lua;}
     void registerTagFactory(wxString tagName, std::function<DomElement*()>tagFactory);
     long long nextHandle() { return ++handleGenerator; }
+    ///embedded lua_std_lib, .lua files are text or bytecode depending on prepareBuild.py options
+    SerializedFolderReader&getSerializedFolderReader(){return serializedFolderReader;}
     void run(wxString source, wxString fileName);
-    DomElement*recursivelyInitElement(Tag*tag, DomElement*parent);
+    ///Runs UTF-8 source without converting it to wxString first. Source can also be compiled .lxmlc
+    void run(const char*source, size_t sourceLength, wxString fileName);
+    ///Compiles lxml source to .lxmlc with Lua bytecode for scripts. Throws ParseException
+    static std::string compileLxml(const char*source, size_t sourceLength, wxString fileName);
+    /**
+     Enables cache of compiled Script tags in existing directory. Bytecode is reused while text of script and Lua
+     version are the same. Damaged files are detected by hashes in their header and replaced, but the directory
+     must not be writable by others, valid header does not make bytecode safe. Empty string disables the cache
+     */
+    void setScriptCacheDirectory(const wxString&directory){scriptCacheDirectory=directory;}
+    const wxString&getScriptCacheDirectory(){return scriptCacheDirectory;}
+    ///files of edited scripts are never hit again, so after each miss only the newest limit .luac files are kept
+    void setScriptCacheLimit(int limit){scriptCacheLimit=limit;}
+    int getScriptCacheLimit(){return scriptCacheLimit;}
+    long long getScriptCacheHits(){return scriptCacheHits;}
+    long long getScriptCacheMisses(){return scriptCacheMisses;}
+    ///runs text of Script tag, through the bytecode cache when it is enabled
+    bool evalScript(const wxString&source, const wxString&chunkName);
+    DomElement*createDomElement(const wxString&tagName);
+    DomElement*createDomElement(Atom tagName);
+    TableRef createLuaDomElementObject(DomElement*domElement);
+    const UserDataType&getDomElementType(){return domElementType;}
+    long long getLuaObjectsCreated(){return luaObjectsCreated;}
     void removeDomElement(DomElement*domElement);
-    void unregisterDomElementById(wxString&id);
-    void registerDomElementById(wxString&id, DomElement*domElement);
     void replaceChildrenFromString(DomElement*domElement, wxString&innerHtml);
-    DomElement*getDomElementById(wxString&id);
+    FragmentsCache&getFragmentsCache(){return fragmentsCache;}
+    ///scheduler runs callback on next idle of event loop. Without scheduler recreations are not deferred. Async
+    ///operations call it from worker threads, so it must be thread safe like wxApp::CallAfter
+    void setIdleScheduler(std::function<void(std::function<void()>)>idleScheduler){this->idleScheduler=idleScheduler;}
+    const std::function<void(std::function<void()>)>&getIdleScheduler(){return idleScheduler;}
+    void scheduleRecreation(DomElement*domElement);
+    void runScheduledRecreations();
+    void onRecreationPerformed(){recreationsPerformed++;}
+    long long getRecreationRequests(){return recreationRequests;}
+    long long getRecreationsPerformed(){return recreationsPerformed;}
+    ///returns NULL if no element has id
+    DomElement*getDomElementById(const wxString&id) {return elementsIndex.findById(id);}
+    ElementsIndex&getElementsIndex(){return elementsIndex;}
+    ///returns first element matching selector or NULL, throws RuntimeException on wrong selector
+    DomElement*querySelector(const wxString&selector);
+    void querySelectorAll(const wxString&selector, std::vector<DomElement*>&result);
     void addElementIdChangedEventHandler(std::function<void(wxString, DomElement*element)>handler);
     void removeElementIdChangedEventHandler(std::function<void(wxString, DomElement*element)>handler);
     void fireElementIdChangedEvent(wxString&id, DomElement*domElement);
     ExecBuilder execFunctionFromAttributeBuilder(const TagAttribute&tagAttribute);
+    /**
+     Runs handler of widget event without arguments as coroutine owned by element, so it can wait for async operations
+     with lxe.await. Collector work is scheduled by GcScheduler around every resume
+     */
+    void runEventHandler(DomElement*owner, const TagAttribute&handler);
+    GcScheduler&getGcScheduler(){return gcScheduler;}
+    AsyncTasks&getAsyncTasks(){return asyncTasks;}
 };
 
 class Script: public virtual DomElement {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
+    std::string precompiledContent;
 public:
     Script();
+    static const AttributesSchema*getAttributesSchema();
+    virtual void setPrecompiledTextContent(std::string_view bytecode)override;
     virtual void onFinishedInitialisation()override;
-    virtual bool handleChangedAttribute(const wxString&name, TagAttribute&oldValue, TagAttribute&newValue) override;
+    virtual bool handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) override;
     virtual bool getDynamicAttributeValue(const wxString&attributeName, TagAttribute&tagAttribute) override;
 };
 }
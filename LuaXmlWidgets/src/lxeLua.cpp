@@ -51,6 +51,7 @@ ValueType getTypeFromLuaType(int type) {
         case LUA_TNUMBER:return LTYPE_DOUBLE;
         case LUA_TBOOLEAN:return LTYPE_BOOL;
         case LUA_TSTRING:return LTYPE_STRING;
+        case LUA_TTABLE:return LTYPE_TABLE;
         case LUA_TFUNCTION:return LTYPE_FUNCTION;
         case LUA_TUSERDATA:return LTYPE_USERDATA;
         default: return LTYPE_OTHER;
@@ -69,31 +70,165 @@ void TableReader::getTable(int key, std::function<void(TableReaderWriter*)>lambd
     lambda(&nestedTableReaderWriter);
 }
 
-void TableReader::getTable(wxString key, std::function<void(TableReaderWriter*)>lambda) {
-    lua_pushstring(state, key.ToUTF8().data());
+void TableReader::getTable(const LuaKey&key, std::function<void(TableReaderWriter*)>lambda) {
+    key.push(state);
     lua_gettable(state, -2);
     TableReaderWriter nestedTableReaderWriter(lua, state);
     lambda(&nestedTableReaderWriter);
     lua_pop(state, 1);
 }
 
-ExecBuilder*TableReader::execBuilder(wxString key) {
-    lua_pushstring(state, key.ToUTF8().data());
+void TableReader::forEachStringKey(std::function<void(std::string_view key, ValuesListReader*value)>visitor) {
+    lua_pushnil(state);
+    while(lua_next(state, -2)!=0) {
+        //lua_tolstring would convert number keys in place and break lua_next
+        if(lua_type(state, -2)==LUA_TSTRING) {
+            size_t length;
+            const char*key=lua_tolstring(state, -2, &length);
+            ValuesListReader value(lua, state, lua_gettop(state), 1);
+            visitor(std::string_view(key, length), &value);
+        }
+        lua_pop(state, 1);
+    }
+}
+
+ExecBuilder*TableReader::execBuilder(const LuaKey&key) {
+    key.push(state);
     lua_gettable(state, -2);
     return new ExecBuilder(lua, state, true);
 }
 
+Lua::Lua(bool loadAllLuaStdLibs, LuaAllocator*allocator) {
+    this->allocator = allocator!=NULL ? allocator : new PooledLuaAllocator();
+    state = lua_newstate(LuaAllocator::luaAlloc, this->allocator);
+    //the same setup as luaL_newstate does
+    lua_atpanic(state, &panic);
+    lua_setwarnf(state, warnfoff, state);
+    *(Lua**)lua_getextraspace(state)=this;
+    if(loadAllLuaStdLibs) luaL_openlibs(state);
+    lua_newtable(state);
+    lua_setglobal(state, "LuaWrapperFFI");
+    configureCustomModuleReader();
+}
+
+void*LuaAllocator::luaAlloc(void*userData, void*block, size_t oldSize, size_t newSize) {
+    LuaAllocator*allocator=(LuaAllocator*)userData;
+    if(newSize==0) {
+        if(block!=NULL) {
+            allocator->liveBytes-=oldSize;
+            allocator->freeBlock(block, oldSize);
+        }
+        return NULL;
+    }
+    void*result;
+    if(block==NULL) {
+        //for new blocks oldSize is type of Lua object
+        oldSize=0;
+        result=allocator->allocateBlock(newSize);
+        if(result!=NULL) allocator->allocations++;
+    } else {
+        result=allocator->resizeBlock(block, oldSize, newSize);
+    }
+    if(result==NULL) {
+        return NULL;
+    }
+    allocator->liveBytes+=newSize;
+    allocator->liveBytes-=oldSize;
+    if(newSize>oldSize) allocator->allocatedBytes+=newSize-oldSize;
+    if(allocator->liveBytes>allocator->peakBytes) allocator->peakBytes=allocator->liveBytes;
+    return result;
+}
+
+double LuaAllocator::getAllocationRate() {
+    double seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-createdAt).count();
+    return seconds>0?allocatedBytes/seconds:0;
+}
+
+PooledLuaAllocator::~PooledLuaAllocator() {
+    for(char*page: pages) {
+        free(page);
+    }
+}
+
+void*PooledLuaAllocator::allocatePooled(int sizeClass) {
+    FreeBlock*freeBlock=freeLists[sizeClass];
+    size_t blockSize=(sizeClass+1)*SIZE_CLASS_STEP;
+    if(freeBlock!=NULL) {
+        freeLists[sizeClass]=freeBlock->next;
+        return freeBlock;
+    }
+    if(pageCursor==NULL || (size_t)(pageEnd-pageCursor)<blockSize) {
+        //rest of the page is too small for this class and stays unused
+        char*page=(char*)malloc(PAGE_SIZE);
+        if(page==NULL) {
+            return NULL;
+        }
+        pages.push_back(page);
+        pageCursor=page;
+        pageEnd=page+PAGE_SIZE;
+    }
+    void*block=pageCursor;
+    pageCursor+=blockSize;
+    return block;
+}
+
+void*PooledLuaAllocator::allocateBlock(size_t size) {
+    if(size>MAX_POOLED_SIZE) {
+        return malloc(size);
+    }
+    return allocatePooled(getSizeClass(size));
+}
+
+void*PooledLuaAllocator::resizeBlock(void*block, size_t oldSize, size_t newSize) {
+    //block kept on failed shrink is still a malloc block
+    bool mallocBlock=oldSize>MAX_POOLED_SIZE || isKeptLargeBlock(block);
+    if(mallocBlock && newSize>MAX_POOLED_SIZE) {
+        void*result=realloc(block, newSize);
+        if(result==NULL) return newSize<=oldSize?block:NULL;
+        keptLargeBlocks.erase(block);
+        return result;
+    }
+    if(!mallocBlock && newSize<=MAX_POOLED_SIZE && getSizeClass(oldSize)==getSizeClass(newSize)) {
+        return block;
+    }
+    void*newBlock=allocateBlock(newSize);
+    if(newBlock==NULL) {
+        //Lua expects that shrinking never fails, old block is big enough for the new size
+        if(newSize>oldSize) return NULL;
+        if(mallocBlock) keptLargeBlocks.insert(block);
+        return block;
+    }
+    memcpy(newBlock, block, oldSize<newSize?oldSize:newSize);
+    freeBlock(block, oldSize);
+    return newBlock;
+}
+
+void PooledLuaAllocator::freeBlock(void*block, size_t size) {
+    if(size>MAX_POOLED_SIZE) {
+        free(block);
+        return;
+    }
+    if(isKeptLargeBlock(block)) {
+        keptLargeBlocks.erase(block);
+        free(block);
+        return;
+    }
+    int sizeClass=getSizeClass(size);
+    FreeBlock*freeBlock=(FreeBlock*)block;
+    freeBlock->next=freeLists[sizeClass];
+    freeLists[sizeClass]=freeBlock;
+}
+
 int genericLuaNativeFunctionHandler(lua_State* state) {
-    int functionId = (int)lua_tointeger(state, lua_upvalueindex(1));
-    Lua*lua=(Lua*)getPointerFromLuaRegistry(state, "wrapper");
-    NativeFunction nativeFunction = lua->getNativeFunction(functionId);
+    NativeFunction*nativeFunction=(NativeFunction*)lua_touserdata(state, lua_upvalueindex(1));
+    Lua*lua=Lua::fromState(state);
     int argsCount=lua_gettop(state);
     
     ValuesListReader argsReader(lua, state, 1, argsCount);
     ValuesListWriter returnWriter(lua, state);
     
     try {
-        nativeFunction(&argsReader, &returnWriter);
+        (*nativeFunction)(&argsReader, &returnWriter);
         return returnWriter.getValuesCount();
     } catch (NativeError&error) {
         lua_pushstring(state, error.errorMessage.ToUTF8().data());
@@ -101,8 +236,8 @@ int genericLuaNativeFunctionHandler(lua_State* state) {
     }
 }
 
-void* getPointerFromLuaRegistry(lua_State*state, wxString name) {
-    lua_pushstring(state, name.ToUTF8().data());
+void* getPointerFromLuaRegistry(lua_State*state, const char*name) {
+    lua_pushstring(state, name);
     lua_gettable(state, LUA_REGISTRYINDEX);
     if (!lua_islightuserdata(state, -1)) {
         luaL_error(state, "Expected light userdata");
@@ -113,25 +248,57 @@ void* getPointerFromLuaRegistry(lua_State*state, wxString name) {
     return pointer;
 }
 
-TableWriter& TableWriter::putNativeFunction(wxString key, NativeFunction nativeFunction) {
-    lua_pushstring(state, key.ToUTF8().data());
-    
-    int functionId = (int)lua->nativeFunctionMap.size();
-    lua->nativeFunctionMap[functionId]=nativeFunction;
-    lua_pushinteger(state, functionId);
-    lua_pushcclosure(state, genericLuaNativeFunctionHandler, 1);
-    
+TableWriter& TableWriter::putNativeFunction(const LuaKey&key, NativeFunction nativeFunction) {
+    key.push(state);
+    lua->pushNativeFunction(std::move(nativeFunction));
     lua_settable(state, -3);
     return *this;
 }
 
+CompiledChunksCache&CompiledChunksCache::instance() {
+    static CompiledChunksCache cache;
+    return cache;
+}
+
+static int appendChunk(lua_State*state, const void*data, size_t size, void*userData) {
+    try {
+        ((std::string*)userData)->append((const char*)data, size);
+    } catch(std::bad_alloc&) {
+        return 1;
+    }
+    return 0;
+}
+
+int CompiledChunksCache::load(lua_State*state, std::string_view content, const char*chunkName) {
+    if(content.size()>0 && content[0]==LUA_SIGNATURE[0]) {
+        return luaL_loadbufferx(state, content.data(), content.size(), chunkName, "b");
+    }
+    //chunk name is kept in bytecode for error messages, so it is part of the key
+    std::string key=std::string(chunkName)+"\n"+std::to_string(hashBytes(content.data(), content.size()))+"\n"+std::to_string(content.size());
+    auto found=bytecodeByKey.find(key);
+    if(found!=bytecodeByKey.end()) {
+        hits++;
+        return luaL_loadbufferx(state, found->second.data(), found->second.size(), chunkName, "b");
+    }
+    misses++;
+    int status=luaL_loadbufferx(state, content.data(), content.size(), chunkName, "t");
+    if(status!=LUA_OK) {
+        return status;
+    }
+    std::string bytecode;
+    //loaded chunk is still usable, it is just not shared
+    if(lua_dump(state, appendChunk, &bytecode, 0)!=0) return status;
+    bytecodeByKey.emplace(std::move(key), std::move(bytecode));
+    return status;
+}
+
 int customModulesLoader(lua_State* state) {
     const char* moduleName = luaL_checkstring(state, 1);
-    Lua*lua=(Lua*)getPointerFromLuaRegistry(state, "wrapper");
+    Lua*lua=Lua::fromState(state);
+    std::string_view content;
     for(int i=0;i<lua->getLuaModulesReadersCount();i++){
-        char*content=lua->getLuaModuleReader(i)((char*)moduleName);
-        if(content!=NULL){
-            luaL_loadbuffer(state, content, strlen(content), moduleName);
+        if(lua->getLuaModuleReader(i)(moduleName, content)){
+            CompiledChunksCache::instance().load(state, content, moduleName);
             return 1;
         }
     }
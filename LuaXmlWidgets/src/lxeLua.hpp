@@ -24,7 +24,32 @@ typedef struct{
 typedef struct{
     int ref;
 } TableRef;
+/**
+ Type of full userdata objects holding single native pointer. Objects are recognized by address of their metatable
+ */
+typedef struct{
+    TableRef metatable;
+    const void*metatablePointer;
+} UserDataType;
+
 
+/**
+ Key of Lua table field or global. Literal keys are pushed without conversion, atom keys reuse Lua string created once
+ per atom, wxString keys are converted to UTF-8 once. Keys are passed by reference and live until end of the call
+ */
+class LuaKey {
+    std::string buffer;
+    const char*key;
+    Atom atom=NO_ATOM;
+public:
+    LuaKey(const char*key) {this->key=key;}
+    LuaKey(const wxString&key):buffer(key.ToUTF8().data()) {this->key=buffer.c_str();}
+    explicit LuaKey(Atom atom) {this->atom=atom; this->key=AtomTable::instance().getUtf8Name(atom).data();}
+    LuaKey(const LuaKey&)=delete;
+    LuaKey&operator=(const LuaKey&)=delete;
+    const char*c_str()const {return key;}
+    inline void push(lua_State*state)const;
+};
 
 enum ValueType {LTYPE_INT, LTYPE_DOUBLE, LTYPE_BOOL, LTYPE_TABLE, LTYPE_STRING, LTYPE_FUNCTION, LTYPE_USERDATA, LTYPE_NIL, LTYPE_OTHER};
 class ExecBuilder;
@@ -35,6 +60,11 @@ class ValuesListReader;
 class ValuesListWriter;
 
 typedef std::function<void(ValuesListReader*args, ValuesListWriter*retValues)> NativeFunction;
+/**
+ Points content to module and returns true if reader knows it. Content is Lua source or bytecode, it is not copied
+ and must stay valid until the reader returns next module
+ */
+typedef std::function<bool(const char*moduleName, std::string_view&content)> LuaModuleReader;
 
 ValueType getLuaTypeOnTop(lua_State*state);
 ValueType getTypeFromLuaType(int type);
@@ -45,8 +75,8 @@ class TableReader {
 public:
     TableReader(Lua*lua,lua_State*state) {this->lua=lua; this->state=state;}
     
-    bool exists(wxString key) {
-        lua_pushstring(state, key.ToUTF8().data());
+    bool exists(const LuaKey&key) {
+        key.push(state);
         lua_gettable(state, -2);
         bool isPresent=!lua_isnil(state, -1);
         lua_pop(state, 1);
@@ -64,8 +94,8 @@ public:
     /**
         Make a reference to function that is currently on top of stack. Reference will prevent gc to collect it.
      */
-    FunctionRef getFunctionRef(wxString key) {
-        lua_pushstring(state, key.ToUTF8().data());
+    FunctionRef getFunctionRef(const LuaKey&key) {
+        key.push(state);
         lua_gettable(state, -2);
         int ref=luaL_ref(state, LUA_REGISTRYINDEX);
         return {ref};
@@ -83,8 +113,8 @@ public:
     /**
         Make a reference to table that is currently on top of stack. Reference will prevent gc to collect it.
      */
-    TableRef getTableRef(wxString key) {
-        lua_pushstring(state, key.ToUTF8().data());
+    TableRef getTableRef(const LuaKey&key) {
+        key.push(state);
         lua_gettable(state, -2);
         int ref=luaL_ref(state, LUA_REGISTRYINDEX);
         return {ref};
@@ -97,8 +127,8 @@ public:
         lua_pop(state, 1);
         return type;
     }
-    ValueType getType(wxString key){
-        lua_pushstring(state, key.ToUTF8().data());
+    ValueType getType(const LuaKey&key){
+        key.push(state);
         lua_gettable(state, -2);
         ValueType type= getLuaTypeOnTop(state);
         lua_pop(state, 1);
@@ -113,8 +143,8 @@ public:
         return value;
     }
     
-    int getInt(wxString key) {
-        lua_pushstring(state, key.ToUTF8().data());
+    int getInt(const LuaKey&key) {
+        key.push(state);
         lua_gettable(state, -2);
         int value=lua_tonumber(state, -1);
         lua_pop(state,1);
@@ -129,8 +159,8 @@ public:
         return value;
     }
     
-    double getDouble(wxString key) {
-        lua_pushstring(state, key.ToUTF8().data());
+    double getDouble(const LuaKey&key) {
+        key.push(state);
         lua_gettable(state, -2);
         double value=lua_tonumber(state, -1);
         lua_pop(state,1);
@@ -145,8 +175,8 @@ public:
         return value;
     }
     
-    wxString getString(wxString key) {
-        lua_pushstring(state, key.ToUTF8().data());
+    wxString getString(const LuaKey&key) {
+        key.push(state);
         lua_gettable(state, -2);
         wxString value=lua_tostring(state, -1);
         lua_pop(state,1);
@@ -161,8 +191,8 @@ public:
         return value;
     }
     
-    bool getBool(wxString key) {
-        lua_pushstring(state, key.ToUTF8().data());
+    bool getBool(const LuaKey&key) {
+        key.push(state);
         lua_gettable(state, -2);
         bool value=lua_toboolean(state, -1);
         lua_pop(state,1);
@@ -177,8 +207,8 @@ public:
         return value;
     }
     
-    void* getUserData(wxString key) {
-        lua_pushstring(state, key.ToUTF8().data());
+    void* getUserData(const LuaKey&key) {
+        key.push(state);
         lua_gettable(state, -2);
         void* value=lua_touserdata(state, -1);
         lua_pop(state,1);
@@ -186,9 +216,13 @@ public:
     }
     
     void getTable(int key, std::function<void(TableReaderWriter*)>lambda);
-    void getTable(wxString key, std::function<void(TableReaderWriter*)>lambda);
+    void getTable(const LuaKey&key, std::function<void(TableReaderWriter*)>lambda);
+    /**
+        Calls visitor for every string key of table. Value of the key is readable from the reader at index 0
+     */
+    void forEachStringKey(std::function<void(std::string_view key, ValuesListReader*value)>visitor);
     
-    ExecBuilder*execBuilder(wxString key);
+    ExecBuilder*execBuilder(const LuaKey&key);
 };
 
 
@@ -204,8 +238,8 @@ public:
         return *this;
     }
     
-    TableWriter&put(wxString key, int value) {
-        lua_pushstring(state, key.ToUTF8().data());
+    TableWriter&put(const LuaKey&key, int value) {
+        key.push(state);
         lua_pushinteger(state, value);
         lua_settable(state, -3);
         return *this;
@@ -217,8 +251,8 @@ public:
         return *this;
     }
     
-    TableWriter&put(wxString key, double value) {
-        lua_pushstring(state, key.ToUTF8().data());
+    TableWriter&put(const LuaKey&key, double value) {
+        key.push(state);
         lua_pushnumber(state, value);
         lua_settable(state, -3);
         return *this;
@@ -230,8 +264,8 @@ public:
         return *this;
     }
     
-    TableWriter&put(wxString key, wxString value) {
-        lua_pushstring(state, key.ToUTF8().data());
+    TableWriter&put(const LuaKey&key, wxString value) {
+        key.push(state);
         lua_pushstring(state, value.ToUTF8().data());
         lua_settable(state, -3);
         return *this;
@@ -243,8 +277,8 @@ public:
         return *this;
     }
     
-    TableWriter&put(wxString key, bool value) {
-        lua_pushstring(state, key.ToUTF8().data());
+    TableWriter&put(const LuaKey&key, bool value) {
+        key.push(state);
         lua_pushboolean(state, value);
         lua_settable(state, -3);
         return *this;
@@ -256,8 +290,8 @@ public:
         return *this;
     }
     
-    TableWriter&put(wxString key, void* value) {
-        lua_pushstring(state, key.ToUTF8().data());
+    TableWriter&put(const LuaKey&key, void* value) {
+        key.push(state);
         lua_pushlightuserdata(state, value);
         lua_settable(state, -3);
         return *this;
@@ -272,8 +306,8 @@ public:
         return *this;
     }
     
-    TableWriter&put(wxString key, FunctionRef functionRef, bool freeRef) {
-        lua_pushstring(state, key.ToUTF8().data());
+    TableWriter&put(const LuaKey&key, FunctionRef functionRef, bool freeRef) {
+        key.push(state);
         lua_rawgeti(state, LUA_REGISTRYINDEX, functionRef.ref);
         lua_settable(state, -3);
         if (freeRef) {
@@ -291,8 +325,8 @@ public:
         return *this;
     }
     
-    TableWriter&put(wxString key, TableRef tableRef, bool freeRef) {
-        lua_pushstring(state, key.ToUTF8().data());
+    TableWriter&put(const LuaKey&key, TableRef tableRef, bool freeRef) {
+        key.push(state);
         lua_rawgeti(state, LUA_REGISTRYINDEX, tableRef.ref);
         lua_settable(state, -3);
         if (freeRef) {
@@ -310,8 +344,8 @@ public:
         return *this;
     }
     
-    TableWriter&putTable(wxString key, std::function<void(TableWriter*)>tableWriterLambda) {
-        lua_pushstring(state, key.ToUTF8().data());
+    TableWriter&putTable(const LuaKey&key, std::function<void(TableWriter*)>tableWriterLambda) {
+        key.push(state);
         lua_newtable(state);
         TableWriter tableWriter(lua, state);
         tableWriterLambda(&tableWriter);
@@ -319,8 +353,8 @@ public:
         return *this;
     }
     
-    TableWriter&putNil(wxString key) {
-        lua_pushstring(state, key.ToUTF8().data());
+    TableWriter&putNil(const LuaKey&key) {
+        key.push(state);
         lua_pushnil(state);
         lua_settable(state, -3);
         return *this;
@@ -332,7 +366,7 @@ public:
         return *this;
     }
     
-    TableWriter& putNativeFunction(wxString key, NativeFunction nativeFunction);
+    TableWriter& putNativeFunction(const LuaKey&key, NativeFunction nativeFunction);
 };
 
 class TableReaderWriter:public TableReader,public TableWriter{
@@ -370,6 +404,12 @@ public:
         count++;
         return this;
     }
+    ///pushes bytes as they are, without conversion through wxString
+    ValuesListWriter*pushBytes(std::string_view value) {
+        lua_pushlstring(state, value.data(), value.size());
+        count++;
+        return this;
+    }
     ValuesListWriter*pushUserData(void*value) {
         lua_pushlightuserdata(state, value);
         count++;
@@ -416,8 +456,24 @@ public:
     int getInt(int index) { return (int)lua_tointeger(state, offset + index);}
     double getDouble(int index) { return lua_tonumber(state, offset + index);}
     wxString getString(int index) { return wxString(lua_tostring(state, offset + index));}
+    ///atom of string argument, NO_ATOM if it is not a string or not an interned name
+    inline Atom getAtom(int index);
+    ///points into Lua string, valid while value stays on the stack
+    std::string_view getStringView(int index) {
+        size_t length;
+        const char*value=lua_tolstring(state, offset + index, &length);
+        return value==NULL?std::string_view():std::string_view(value, length);
+    }
     bool getBool(int index) { return lua_toboolean(state, offset + index);}
     void*getUserData(int index){ return lua_touserdata(state, offset+index);}
+    ///returns pointer held by object of userDataType, NULL if value is not such object
+    void*getUserData(int index, const UserDataType&userDataType) {
+        void**slot=(void**)lua_touserdata(state, offset+index);
+        if(slot==NULL || lua_islightuserdata(state, offset+index) || !lua_getmetatable(state, offset+index)) return NULL;
+        bool matches=lua_topointer(state, -1)==userDataType.metatablePointer;
+        lua_pop(state, 1);
+        return matches?*slot:NULL;
+    }
     void getTable(int index, std::function<void(TableReader*reader)>tableReader) {
         lua_pushvalue(state, offset + index);
         TableReader reader(lua, state);
@@ -437,6 +493,14 @@ public:
     }
 };
 
+/**
+ Lua thread anchored in registry, so it is not collected while it is suspended
+ */
+struct LuaCoroutine {
+    lua_State*thread=NULL;
+    int ref=LUA_NOREF;
+};
+
 class ExecBuilder: ValuesListWriter {
     Lua*lua;
     lua_State*state;
@@ -473,29 +537,177 @@ public:
     }
 };
 
+/**
+ Memory of single Lua state with accounting of live, peak and allocated bytes. Blocks come from malloc, subclasses
+ override allocateBlock/resizeBlock/freeBlock to manage memory differently. Lua always passes size of existing block,
+ so blocks do not need headers
+ */
+class LuaAllocator {
+private:
+    size_t liveBytes=0;
+    size_t peakBytes=0;
+    long long allocations=0;
+    long long allocatedBytes=0;
+    std::chrono::steady_clock::time_point createdAt=std::chrono::steady_clock::now();
+protected:
+    virtual void*allocateBlock(size_t size) {return malloc(size);}
+    ///Lua expects that shrinking never fails, so block is kept when realloc cannot shrink it
+    virtual void*resizeBlock(void*block, size_t oldSize, size_t newSize) {
+        void*result=realloc(block, newSize);
+        return result==NULL && newSize<=oldSize ? block : result;
+    }
+    virtual void freeBlock(void*block, size_t size) {free(block);}
+public:
+    virtual ~LuaAllocator() {}
+    ///lua_Alloc, userData is the allocator
+    static void*luaAlloc(void*userData, void*block, size_t oldSize, size_t newSize);
+    size_t getLiveBytes() {return liveBytes;}
+    size_t getPeakBytes() {return peakBytes;}
+    ///count of new blocks
+    long long getAllocations() {return allocations;}
+    ///sum of bytes requested by new and grown blocks
+    long long getAllocatedBytes() {return allocatedBytes;}
+    ///allocated bytes per second since the allocator was created
+    double getAllocationRate();
+    ///memory taken from system for pools of small blocks, both used and free
+    virtual size_t getPoolBytes() {return 0;}
+};
+
+/**
+ Keeps blocks up to MAX_POOLED_SIZE in free lists of size classes, which are carved from pages and reused without
+ going to malloc. Tables, short strings, closures and upvalues of Lua are such blocks. Pages are released with the
+ allocator, bigger blocks use malloc
+ */
+class PooledLuaAllocator: public LuaAllocator {
+public:
+    static constexpr size_t SIZE_CLASS_STEP=16;
+    static constexpr size_t MAX_POOLED_SIZE=256;
+    static constexpr size_t PAGE_SIZE=64*1024;
+private:
+    struct FreeBlock {
+        FreeBlock*next;
+    };
+    FreeBlock*freeLists[MAX_POOLED_SIZE/SIZE_CLASS_STEP]={};
+    std::vector<char*>pages;
+    char*pageCursor=NULL;
+    char*pageEnd=NULL;
+    ///malloc blocks shrunk to pooled size when no pooled block was available, they are freed with free()
+    std::unordered_set<void*>keptLargeBlocks;
+    static int getSizeClass(size_t size) {return (int)((size-1)/SIZE_CLASS_STEP);}
+    void*allocatePooled(int sizeClass);
+    bool isKeptLargeBlock(void*block) {return !keptLargeBlocks.empty() && keptLargeBlocks.count(block)>0;}
+protected:
+    void*allocateBlock(size_t size) override;
+    void*resizeBlock(void*block, size_t oldSize, size_t newSize) override;
+    void freeBlock(void*block, size_t size) override;
+public:
+    PooledLuaAllocator() {}
+    PooledLuaAllocator(const PooledLuaAllocator&)=delete;
+    PooledLuaAllocator&operator=(const PooledLuaAllocator&)=delete;
+    ~PooledLuaAllocator();
+    size_t getPoolBytes() override {return pages.size()*PAGE_SIZE;}
+};
+
+/**
+ Bytecode of modules loaded from source, shared by Lua states of all engines, so module that every new engine requires
+ is compiled once. Modules that already are bytecode are loaded directly
+ */
+class CompiledChunksCache {
+private:
+    std::unordered_map<std::string, std::string>bytecodeByKey;
+    long long hits=0;
+    long long misses=0;
+public:
+    static CompiledChunksCache&instance();
+    ///pushes loaded chunk or error message like luaL_loadbufferx and returns its status
+    int load(lua_State*state, std::string_view content, const char*chunkName);
+    void clear() {bytecodeByKey.clear();}
+    int getSize() {return (int)bytecodeByKey.size();}
+    long long getHits() {return hits;}
+    long long getMisses() {return misses;}
+};
+
 int genericLuaNativeFunctionHandler(lua_State*state);
-void* getPointerFromLuaRegistry(lua_State*state, wxString name);
+template<auto function> struct NativeBinding;
+template<auto getField> int userDataIndexHandler(lua_State*state);
+void* getPointerFromLuaRegistry(lua_State*state, const char*name);
 
 class Lua {
 private:
     lua_State*state;
-    std::unordered_map<int, NativeFunction> nativeFunctionMap;
-    std::vector<std::function<char*(char*)>>luaModulesReaders;
+    LuaAllocator*allocator;
+    //deque keeps addresses stable, closures hold pointer to their function as upvalue
+    std::deque<NativeFunction> nativeFunctions;
+    std::vector<LuaModuleReader>luaModulesReaders;
+    //Lua strings of atoms anchored in registry, so their addresses identify atoms of keys coming from scripts
+    std::vector<int>atomStringRefs;
+    std::unordered_map<const void*, Atom>atomsByStringAddress;
+    ///pushes closure calling nativeFunction
+    void pushNativeFunction(NativeFunction nativeFunction) {
+        nativeFunctions.push_back(std::move(nativeFunction));
+        lua_pushlightuserdata(state, &nativeFunctions.back());
+        lua_pushcclosure(state, genericLuaNativeFunctionHandler, 1);
+    }
+    template<auto function>
+    void pushBoundFunction(typename NativeBinding<function>::Context*context) {
+        lua_pushlightuserdata(state, context);
+        lua_pushcclosure(state, NativeBinding<function>::call, 1);
+    }
 public:
     friend class ValuesListWriter;
     friend class ValuesListReader;
     friend class TableWriter;
     
-    Lua(bool loadAllLuaStdLibs) {
-        state = luaL_newstate();
-        putPointerInRegistry("wrapper", this);
-        if(loadAllLuaStdLibs) luaL_openlibs(state);
-        lua_newtable(state);
-        lua_setglobal(state, "LuaWrapperFFI");
-        configureCustomModuleReader();
-    }
+    ///takes ownership of allocator, NULL means PooledLuaAllocator
+    Lua(bool loadAllLuaStdLibs, LuaAllocator*allocator=NULL);
     ~Lua() {
         if(state!=NULL)lua_close(state);
+        delete allocator;
+    }
+    LuaAllocator*getAllocator() {return allocator;}
+    ///0 keeps Lua default of the parameter, see collectgarbage("incremental")
+    void setIncrementalCollector(int pause, int stepMultiplier, int stepSize) {lua_gc(state, LUA_GCINC, pause, stepMultiplier, stepSize);}
+    ///0 keeps Lua default of the parameter, see collectgarbage("generational")
+    void setGenerationalCollector(int minorMultiplier, int majorMultiplier) {lua_gc(state, LUA_GCGEN, minorMultiplier, majorMultiplier);}
+    ///runs one basic step of the collector even when it is stopped, returns true when the step finished a cycle
+    bool collectStep() {return lua_gc(state, LUA_GCSTEP, 0)!=0;}
+    void stopCollector() {lua_gc(state, LUA_GCSTOP);}
+    void restartCollector() {lua_gc(state, LUA_GCRESTART);}
+    bool isCollectorRunning() {return lua_gc(state, LUA_GCISRUNNING)!=0;}
+    ///wrapper is kept in extra space of lua_State, so native callbacks get it without registry lookup
+    static Lua*fromState(lua_State*state) {return *(Lua**)lua_getextraspace(state);}
+    ///pushes name of atom to stack of thread, Lua string is created once per atom
+    void pushAtom(lua_State*thread, Atom atom) {
+        if(atom>=(int)atomStringRefs.size()) atomStringRefs.resize(atom+1, LUA_NOREF);
+        if(atomStringRefs[atom]!=LUA_NOREF) {
+            lua_rawgeti(thread, LUA_REGISTRYINDEX, atomStringRefs[atom]);
+            return;
+        }
+        std::string_view name=AtomTable::instance().getUtf8Name(atom);
+        lua_pushlstring(thread, name.data(), name.size());
+        atomsByStringAddress[lua_tostring(thread, -1)]=atom;
+        lua_pushvalue(thread, -1);
+        atomStringRefs[atom]=luaL_ref(thread, LUA_REGISTRYINDEX);
+    }
+    /**
+     Atom of string at stack index, NO_ATOM if value is not string or name was never interned. Short Lua strings are
+     interned by Lua, so after first lookup the same key from scripts is resolved by its address. Thread is the one
+     the caller runs on, strings are anchored in registry that is shared by all threads of the state
+     */
+    Atom toAtom(lua_State*thread, int index) {
+        if(lua_type(thread, index)!=LUA_TSTRING) return NO_ATOM;
+        size_t length;
+        const char*value=lua_tolstring(thread, index, &length);
+        auto found=atomsByStringAddress.find(value);
+        if(found!=atomsByStringAddress.end()) return found->second;
+        Atom atom=AtomTable::instance().find(std::string_view(value, length));
+        if(atom!=NO_ATOM && (atom>=(int)atomStringRefs.size() || atomStringRefs[atom]==LUA_NOREF)) {
+            lua_pushvalue(thread, index);
+            atomsByStringAddress[value]=atom;
+            if(atom>=(int)atomStringRefs.size()) atomStringRefs.resize(atom+1, LUA_NOREF);
+            atomStringRefs[atom]=luaL_ref(thread, LUA_REGISTRYINDEX);
+        }
+        return atom;
     }
     bool evalFile(wxString source, wxString fileName) {
         if(luaL_loadstring(state, source.ToUTF8().data())!= LUA_OK||lua_pcall(state, 0, LUA_MULTRET, 0)!= LUA_OK) {
@@ -505,12 +717,43 @@ public:
         }
         return true;
     }
+    ///Runs chunk that can be either Lua source or precompiled bytecode
+    bool evalBuffer(const char*buffer, size_t length, wxString chunkName) {
+        if(luaL_loadbufferx(state, buffer, length, chunkName.ToUTF8().data(), "bt")!= LUA_OK||lua_pcall(state, 0, LUA_MULTRET, 0)!= LUA_OK) {
+            wxPrintf("Lua error in file %s. Message: %s\n", chunkName, wxString(lua_tostring(state, lua_gettop(state))));
+            lua_pop(state, 1);
+            return false;
+        }
+        return true;
+    }
+    ///Compiles source to bytecode without running it. Debug info is kept, so errors still have line numbers
+    bool compile(const char*source, size_t sourceLength, wxString chunkName, std::string&bytecode, wxString&errorMessage) {
+        if(luaL_loadbufferx(state, source, sourceLength, chunkName.ToUTF8().data(), "t")!=LUA_OK) {
+            errorMessage=wxString(lua_tostring(state, lua_gettop(state)));
+            lua_pop(state, 1);
+            return false;
+        }
+        int status=lua_dump(state, [](lua_State*state, const void*data, size_t size, void*userData) {
+            try {
+                ((std::string*)userData)->append((const char*)data, size);
+            } catch(std::bad_alloc&) {
+                return 1;
+            }
+            return 0;
+        }, &bytecode, 0);
+        lua_pop(state, 1);
+        if(status!=0) {
+            bytecode.clear();
+            errorMessage=wxString::Format("Cannot dump bytecode of chunk %s", chunkName);
+            return false;
+        }
+        return true;
+    }
     bool evalExpression(wxString source) {
         return evalExpression(source, [](bool state, auto result){});
     }
     bool evalExpression(wxString source, std::function<void(bool state, wxString&result)>onComplete) {
-        const char*s=source.ToUTF8().data();
-        if((luaL_loadstring(state, s)!=LUA_OK)||(lua_pcall(state, 0, 1, 0) != LUA_OK)) {
+        if((luaL_loadstring(state, source.ToUTF8().data())!=LUA_OK)||(lua_pcall(state, 0, 1, 0) != LUA_OK)) {
             wxString errorMessage=wxString::Format("Lua error. Message: %s\n", wxString(lua_tostring(state, lua_gettop(state))));
             onComplete(false, errorMessage);
             lua_pop(state, 1);
@@ -525,12 +768,17 @@ public:
         }
         return true;
     }
-    void putPointerInRegistry(wxString name, void* pointer) {
-        lua_pushstring(state, name.ToUTF8().data());
+    LuaCoroutine newCoroutine() {
+        lua_State*thread=lua_newthread(state);
+        int ref=luaL_ref(state, LUA_REGISTRYINDEX);
+        return {thread, ref};
+    }
+    void putPointerInRegistry(const char*name, void* pointer) {
+        lua_pushstring(state, name);
         lua_pushlightuserdata(state, pointer);
         lua_settable(state, LUA_REGISTRYINDEX);
     }
-    void* getPointerFromRegistry(wxString name) {
+    void* getPointerFromRegistry(const char*name) {
         return getPointerFromLuaRegistry(state, name);
     }
     void editGlobalTable(std::function<void(TableReaderWriter*)>readerWriterLambda) {
@@ -545,46 +793,46 @@ public:
         readerWriterLambda(&readerWriter);
         lua_pop(state, 1);
     }
-    bool globalPresent(wxString key) {
-        lua_getglobal(state, key.ToUTF8().data());
+    bool globalPresent(const LuaKey&key) {
+        lua_getglobal(state, key.c_str());
         bool isPresent = !lua_isnil(state, -1);
         lua_pop(state, 1);
         return isPresent;
     }
-    int globalInt(wxString key) {
-        lua_getglobal(state, key.ToUTF8().data());
+    int globalInt(const LuaKey&key) {
+        lua_getglobal(state, key.c_str());
         int value = (int)lua_tointeger(state, -1);
         lua_pop(state, 1);
         return value;
     }
-    double globalDouble(wxString key) {
-        lua_getglobal(state, key.ToUTF8().data());
+    double globalDouble(const LuaKey&key) {
+        lua_getglobal(state, key.c_str());
         double value = lua_tonumber(state, -1);
         lua_pop(state, 1);
         return value;
     }
-    bool globalBool(wxString key) {
-        lua_getglobal(state, key.ToUTF8().data());
+    bool globalBool(const LuaKey&key) {
+        lua_getglobal(state, key.c_str());
         bool value = lua_toboolean(state, -1);
         lua_pop(state, 1);
         return value;
     }
-    wxString globalString(wxString key) {
-        lua_getglobal(state, key.ToUTF8().data());
+    wxString globalString(const LuaKey&key) {
+        lua_getglobal(state, key.c_str());
         wxString value = wxString(lua_tostring(state, -1));
         lua_pop(state, 1);
         return value;
     }
     
-    void* globalUserData(wxString key) {
-        lua_getglobal(state, key.ToUTF8().data());
+    void* globalUserData(const LuaKey&key) {
+        lua_getglobal(state, key.c_str());
         void*value=lua_touserdata(state, -1);
         lua_pop(state, 1);
         return value;
     }
-    ExecBuilder globalFunctionExec(wxString functionName) {
+    ExecBuilder globalFunctionExec(const LuaKey&functionName) {
         lua_pushglobaltable(state);
-        lua_pushstring(state, functionName.ToUTF8().data());
+        functionName.push(state);
         lua_gettable(state, -2);
         lua_remove(state, -2);
         return ExecBuilder(this, state, false);
@@ -594,6 +842,45 @@ public:
         lua_rawgeti(state, LUA_REGISTRYINDEX, functionRef.ref);
         return ExecBuilder(this, state, false);
     }
+    ///coroutine that runs global function on first resume, it stays alive until releaseCoroutine
+    LuaCoroutine globalFunctionCoroutine(const LuaKey&functionName) {
+        LuaCoroutine coroutine=newCoroutine();
+        lua_pushglobaltable(coroutine.thread);
+        functionName.push(coroutine.thread);
+        lua_gettable(coroutine.thread, -2);
+        lua_remove(coroutine.thread, -2);
+        return coroutine;
+    }
+    LuaCoroutine functionRefCoroutine(FunctionRef functionRef) {
+        LuaCoroutine coroutine=newCoroutine();
+        lua_rawgeti(coroutine.thread, LUA_REGISTRYINDEX, functionRef.ref);
+        return coroutine;
+    }
+    /**
+     Resumes coroutine with values written by args, values it yields or returns are dropped. Returns LUA_YIELD when
+     coroutine is suspended again, LUA_OK when it finished, otherwise error status with errorMessage
+     */
+    int resumeCoroutine(LuaCoroutine&coroutine, std::function<void(ValuesListWriter*)>args, wxString&errorMessage) {
+        ValuesListWriter argsWriter(this, coroutine.thread);
+        if(args) args(&argsWriter);
+        int resultsCount=0;
+        int status=lua_resume(coroutine.thread, state, argsWriter.getValuesCount(), &resultsCount);
+        if(status==LUA_OK || status==LUA_YIELD) {
+            lua_pop(coroutine.thread, resultsCount);
+            return status;
+        }
+        const char*message=lua_tostring(coroutine.thread, -1);
+        errorMessage=message==NULL?wxString("error object is not a string"):wxString::FromUTF8(message);
+        return status;
+    }
+    ///closes pending to-be-closed variables of coroutine and lets it be collected
+    void releaseCoroutine(LuaCoroutine&coroutine) {
+        if(coroutine.thread==NULL) return;
+        lua_closethread(coroutine.thread, state);
+        luaL_unref(state, LUA_REGISTRYINDEX, coroutine.ref);
+        coroutine.thread=NULL;
+        coroutine.ref=LUA_NOREF;
+    }
     
     TableRef createNewLuaTable(){
         lua_newtable(state);
@@ -603,19 +890,28 @@ public:
     /**
      Register native function in predefined table LuaWrapperFFI
      */
-    void registerNativeFunction(wxString functionName, NativeFunction nativeFunction) {
-        int functionId = (int)nativeFunctionMap.size();
-        nativeFunctionMap[functionId]=nativeFunction;
+    void registerNativeFunction(const LuaKey&functionName, NativeFunction nativeFunction) {
         lua_getglobal(state, "LuaWrapperFFI");
-        lua_pushinteger(state, functionId);
-        lua_pushcclosure(state, genericLuaNativeFunctionHandler, 1);
-        lua_setfield(state, -2, functionName.ToUTF8().data());
+        pushNativeFunction(std::move(nativeFunction));
+        lua_setfield(state, -2, functionName.c_str());
+        lua_pop(state, 1);
+    }
+    /**
+     Register function with typed arguments in predefined table LuaWrapperFFI. Function gets context as first
+     parameter, arguments are checked and converted by LuaArgument and result pushed by LuaResult, see NativeBinding
+     */
+    template<auto function>
+    void bindNativeFunction(const LuaKey&functionName, typename NativeBinding<function>::Context*context) {
+        lua_getglobal(state, "LuaWrapperFFI");
+        pushBoundFunction<function>(context);
+        lua_setfield(state, -2, functionName.c_str());
         lua_pop(state, 1);
     }
     /**
-        customModuleReader can be a lambda that accepts path to file/module and responds with module content
+        customModuleReader can be a lambda that accepts path to file/module and responds with module content.
+        Content may be precompiled bytecode, so readers must return only trusted content
      */
-    void registerLuaModuleReader(std::function<char*(char*)>customModuleReader) {
+    void registerLuaModuleReader(LuaModuleReader customModuleReader) {
         this->luaModulesReaders.push_back(customModuleReader);
     }
     
@@ -623,19 +919,48 @@ public:
         return (int)this->luaModulesReaders.size();
     }
     
-    std::function<char*(char*)> getLuaModuleReader(int index) {
+    const LuaModuleReader&getLuaModuleReader(int index) {
         return this->luaModulesReaders[index];
     }
     
-    NativeFunction getNativeFunction(int functionId) {
-        return nativeFunctionMap[functionId];
-    }
     void functionRefRemove(FunctionRef ref){
         luaL_unref(state, LUA_REGISTRYINDEX, ref.ref);
     }
     void tableRefRemove(TableRef ref){
         luaL_unref(state, LUA_REGISTRYINDEX, ref.ref);
     }
+    /**
+     Creates type of userdata objects. Fields found in methodsTable are methods, other fields are read by bound function
+     getField(context, object, key) and written by setField(context, object, key, value)
+     */
+    template<auto getField, auto setField>
+    UserDataType createUserDataType(TableRef methodsTable, typename NativeBinding<getField>::Context*context) {
+        lua_newtable(state);
+        lua_pushlightuserdata(state, context);
+        lua_rawgeti(state, LUA_REGISTRYINDEX, methodsTable.ref);
+        lua_pushcclosure(state, userDataIndexHandler<getField>, 2);
+        lua_setfield(state, -2, "__index");
+        pushBoundFunction<setField>(context);
+        lua_setfield(state, -2, "__newindex");
+        const void*metatablePointer=lua_topointer(state, -1);
+        int ref=luaL_ref(state, LUA_REGISTRYINDEX);
+        return {{ref}, metatablePointer};
+    }
+    TableRef createUserData(const UserDataType&userDataType, void*pointer) {
+        void**slot=(void**)lua_newuserdatauv(state, sizeof(void*), 0);
+        *slot=pointer;
+        lua_rawgeti(state, LUA_REGISTRYINDEX, userDataType.metatable.ref);
+        lua_setmetatable(state, -2);
+        int ref=luaL_ref(state, LUA_REGISTRYINDEX);
+        return {ref};
+    }
+    ///objects still referenced by scripts hold NULL afterwards, so native side can reject them
+    void clearUserData(TableRef ref) {
+        lua_rawgeti(state, LUA_REGISTRYINDEX, ref.ref);
+        void**slot=(void**)lua_touserdata(state, -1);
+        if(slot!=NULL && !lua_islightuserdata(state, -1)) *slot=NULL;
+        lua_pop(state, 1);
+    }
     void inheritTable(TableRef childRef, TableRef parentRef) {
         lua_rawgeti(state, LUA_REGISTRYINDEX, childRef.ref);
         if (!lua_istable(state, -1)) {
@@ -672,5 +997,137 @@ public:
     }
 };
 
+Atom ValuesListReader::getAtom(int index) {
+    return lua->toAtom(state, offset + index);
+}
+
+void LuaKey::push(lua_State*state)const {
+    if(atom!=NO_ATOM) {
+        Lua::fromState(state)->pushAtom(state, atom);
+        return;
+    }
+    lua_pushstring(state, key);
+}
+
+/**
+ String argument resolved to atom. Name points into Lua string and is valid during the call, values that are not
+ strings have NO_ATOM and NULL name
+ */
+struct LuaAtom {
+    Atom atom=NO_ATOM;
+    std::string_view name;
+    bool isString()const {return name.data()!=NULL;}
+};
+
+///skipped argument, like self of methods of plain Lua tables
+struct LuaUnused {};
+
+/**
+ Converts Lua value at stack index to argument of bound function, context is the one function was bound with.
+ Wrong values raise Lua error. Specialize for other argument types
+ */
+template<typename T> struct LuaArgument;
+template<> struct LuaArgument<int> {
+    static int get(lua_State*state, int index, void*context) {return (int)luaL_checkinteger(state, index);}
+};
+template<> struct LuaArgument<double> {
+    static double get(lua_State*state, int index, void*context) {return luaL_checknumber(state, index);}
+};
+template<> struct LuaArgument<bool> {
+    static bool get(lua_State*state, int index, void*context) {return lua_toboolean(state, index);}
+};
+template<> struct LuaArgument<lua_State*> {
+    static lua_State*get(lua_State*state, int index, void*context) {
+        lua_State*thread=lua_tothread(state, index);
+        if(thread==NULL) luaL_typeerror(state, index, "thread");
+        return thread;
+    }
+};
+template<> struct LuaArgument<std::string_view> {
+    static std::string_view get(lua_State*state, int index, void*context) {
+        size_t length;
+        const char*value=luaL_checklstring(state, index, &length);
+        return std::string_view(value, length);
+    }
+};
+template<> struct LuaArgument<wxString> {
+    static wxString get(lua_State*state, int index, void*context) {
+        size_t length;
+        const char*value=luaL_checklstring(state, index, &length);
+        return wxString::FromUTF8(value, length);
+    }
+};
+template<> struct LuaArgument<LuaUnused> {
+    static LuaUnused get(lua_State*state, int index, void*context) {return LuaUnused();}
+};
+template<> struct LuaArgument<LuaAtom> {
+    static LuaAtom get(lua_State*state, int index, void*context) {
+        if(lua_type(state, index)!=LUA_TSTRING) return LuaAtom();
+        size_t length;
+        const char*value=lua_tolstring(state, index, &length);
+        return {Lua::fromState(state)->toAtom(state, index), std::string_view(value, length)};
+    }
+};
+
+///Pushes result of bound function, returns count of pushed values. Specialize for other result types
+template<typename T> struct LuaResult;
+template<> struct LuaResult<int> {
+    static int push(lua_State*state, void*context, int value) {lua_pushinteger(state, value); return 1;}
+};
+template<> struct LuaResult<double> {
+    static int push(lua_State*state, void*context, double value) {lua_pushnumber(state, value); return 1;}
+};
+template<> struct LuaResult<bool> {
+    static int push(lua_State*state, void*context, bool value) {lua_pushboolean(state, value); return 1;}
+};
+template<> struct LuaResult<wxString> {
+    static int push(lua_State*state, void*context, const wxString&value) {lua_pushstring(state, value.ToUTF8().data()); return 1;}
+};
+
+/**
+ lua_CFunction calling function(Context*context, Args...args). Context is light userdata in the first upvalue, so calls
+ do not look up or copy anything. NativeError and RuntimeException become Lua errors
+ */
+template<typename ContextType, typename Result, typename...Args, Result(*function)(ContextType*, Args...)>
+struct NativeBinding<function> {
+    typedef ContextType Context;
+    static int call(lua_State*state) {
+        Context*context=(Context*)lua_touserdata(state, lua_upvalueindex(1));
+        wxString errorMessage;
+        try {
+            return invoke(state, context, std::index_sequence_for<Args...>());
+        } catch(NativeError&error) {
+            errorMessage=error.errorMessage;
+        } catch(RuntimeException&ex) {
+            errorMessage=ex.getErrorMessage();
+        }
+        lua_pushstring(state, errorMessage.ToUTF8().data());
+        return lua_error(state);
+    }
+private:
+    template<size_t...indexes>
+    static int invoke(lua_State*state, Context*context, std::index_sequence<indexes...>) {
+        //braced initialization converts arguments in order, so error is reported for the first wrong one
+        std::tuple<std::decay_t<Args>...>arguments{LuaArgument<std::decay_t<Args>>::get(state, (int)indexes+1, context)...};
+        if constexpr(std::is_void_v<Result>) {
+            function(context, std::get<indexes>(arguments)...);
+            return 0;
+        } else {
+            return LuaResult<std::decay_t<Result>>::push(state, context, function(context, std::get<indexes>(arguments)...));
+        }
+    }
+};
+
+///__index of userdata types, context is the first upvalue and methods table the second
+template<auto getField>
+int userDataIndexHandler(lua_State*state) {
+    lua_pushvalue(state, 2);
+    if(lua_rawget(state, lua_upvalueindex(2))!=LUA_TNIL) {
+        return 1;
+    }
+    lua_pop(state, 1);
+    return NativeBinding<getField>::call(state);
+}
+
 }
 #endif
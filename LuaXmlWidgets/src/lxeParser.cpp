@@ -4,17 +4,117 @@
 
 #include "lxe.hpp"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LXE_SCAN_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#include <emmintrin.h>
+#define LXE_SCAN_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 using namespace lxe;
 
-StringParser::StringParser(wxString&string){
-    this->string=string;
-    stringLength=(unsigned int)string.length();
+#if defined(LXE_SCAN_AVX2) || defined(LXE_SCAN_SSE2)
+static inline int countTrailingZeros(unsigned int value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return (int)index;
+#else
+    return __builtin_ctz(value);
+#endif
+}
+#endif
+
+const char*lxe::scanDelimitersScalar(const char*begin, const char*end, const char*delimiters) {
+    for (const char*p = begin; p < end; p++) {
+        char c = *p;
+        for (const char*d = delimiters; *d; d++) {
+            if (c == *d) {
+                return p;
+            }
+        }
+    }
+    return end;
+}
+
+#if defined(LXE_SCAN_AVX2) || defined(LXE_SCAN_SSE2)
+///longer delimiter sets are scanned by scalar loop
+static const int MAX_VECTOR_DELIMITERS = 4;
+#endif
+
+#if defined(LXE_SCAN_AVX2)
+const char*lxe::scanDelimiters(const char*begin, const char*end, const char*delimiters) {
+    int delimitersCount = (int)strlen(delimiters);
+    if (delimitersCount == 0 || delimitersCount > MAX_VECTOR_DELIMITERS) {
+        return scanDelimitersScalar(begin, end, delimiters);
+    }
+    __m256i delimiterVectors[MAX_VECTOR_DELIMITERS];
+    for (int i = 0; i < delimitersCount; i++) {
+        delimiterVectors[i] = _mm256_set1_epi8(delimiters[i]);
+    }
+    const char*p = begin;
+    while (end - p >= 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)p);
+        __m256i hits = _mm256_cmpeq_epi8(block, delimiterVectors[0]);
+        for (int i = 1; i < delimitersCount; i++) {
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, delimiterVectors[i]));
+        }
+        unsigned int hitMask = (unsigned int)_mm256_movemask_epi8(hits);
+        if (hitMask != 0) {
+            return p + countTrailingZeros(hitMask);
+        }
+        p += 32;
+    }
+    return scanDelimitersScalar(p, end, delimiters);
+}
+#elif defined(LXE_SCAN_SSE2)
+const char*lxe::scanDelimiters(const char*begin, const char*end, const char*delimiters) {
+    int delimitersCount = (int)strlen(delimiters);
+    if (delimitersCount == 0 || delimitersCount > MAX_VECTOR_DELIMITERS) {
+        return scanDelimitersScalar(begin, end, delimiters);
+    }
+    __m128i delimiterVectors[MAX_VECTOR_DELIMITERS];
+    for (int i = 0; i < delimitersCount; i++) {
+        delimiterVectors[i] = _mm_set1_epi8(delimiters[i]);
+    }
+    const char*p = begin;
+    while (end - p >= 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)p);
+        __m128i hits = _mm_cmpeq_epi8(block, delimiterVectors[0]);
+        for (int i = 1; i < delimitersCount; i++) {
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, delimiterVectors[i]));
+        }
+        unsigned int hitMask = (unsigned int)_mm_movemask_epi8(hits);
+        if (hitMask != 0) {
+            return p + countTrailingZeros(hitMask);
+        }
+        p += 16;
+    }
+    return scanDelimitersScalar(p, end, delimiters);
+}
+#else
+const char*lxe::scanDelimiters(const char*begin, const char*end, const char*delimiters) {
+    return scanDelimitersScalar(begin, end, delimiters);
+}
+#endif
+
+wxString lxe::spanToWxString(std::string_view span) {
+    return wxString::FromUTF8(span.data(), span.size());
+}
+
+StringParser::StringParser(const char*data, int dataLength){
+    this->data=data;
+    this->dataLength=dataLength;
     currentIndex=0;
-    line=0;
 }
 
 bool StringParser::eof(){
-    return currentIndex>=stringLength;
+    return currentIndex>=dataLength;
 }
 
 void StringParser::skip(int count){
@@ -22,21 +122,19 @@ void StringParser::skip(int count){
         getChar();
 }
 
-wchar_t StringParser::getChar() {
+int StringParser::getChar() {
     if (eof()) {
-        return (char) -1;
+        return -1;
     }
-    wchar_t c = string[currentIndex].GetValue();
-    if (c == '\n')
-        line++;
+    int c = (unsigned char)data[currentIndex];
     currentIndex++;
     return c;
 }
-wchar_t StringParser::peek(int offset) {
-    if (currentIndex + offset >= stringLength) {
-        return (wchar_t) -1;
+int StringParser::peek(int offset) {
+    if (currentIndex + offset >= dataLength) {
+        return -1;
     }
-    return string[currentIndex + offset].GetValue();
+    return (unsigned char)data[currentIndex + offset];
 }
 
 void StringParser::rewind() {
@@ -45,7 +143,7 @@ void StringParser::rewind() {
 
 void StringParser::skipBlank() {
     while (!eof()) {
-        wchar_t c = getChar();
+        int c = getChar();
         if (!(c == ' ' || c == '\t' || c == '\n' || c == '\r')) {
             rewind();
             break;
@@ -57,72 +155,189 @@ int StringParser::getCurrentIndex() {
     return currentIndex;
 }
 
+void StringParser::buildNewLineIndex() {
+    const char*end = data + dataLength;
+    const char*p = scanDelimiters(data, end, "\n");
+    while (p < end) {
+        newLineOffsets.push_back((int)(p - data));
+        p = scanDelimiters(p + 1, end, "\n");
+    }
+    newLineIndexBuilt = true;
+}
+
 int StringParser::getLine(){
-    return line;
+    return getLineAt(currentIndex);
+}
+
+int StringParser::getLineAt(int offset) {
+    if (!newLineIndexBuilt) {
+        buildNewLineIndex();
+    }
+    return (int)(std::lower_bound(newLineOffsets.begin(), newLineOffsets.end(), offset) - newLineOffsets.begin());
+}
+
+int StringParser::getColumnAt(int offset) {
+    int line = getLineAt(offset);
+    int lineStart = line == 0 ? 0 : newLineOffsets[line - 1] + 1;
+    return offset - lineStart;
 }
 
 void StringParser::setCurrentIndex(int currentIndex) {
     this->currentIndex = currentIndex;
 }
 
-bool StringParser::match(wxString token) {
-    int restOfLength = stringLength - currentIndex;
-    if (token.length() > restOfLength) {
+bool StringParser::skipUntilAnyOf(const char*delimiters) {
+    const char*found = scanDelimiters(data + currentIndex, data + dataLength, delimiters);
+    currentIndex = (int)(found - data);
+    return currentIndex < dataLength;
+}
+
+bool StringParser::match(const char*token) {
+    int tokenLength = (int)strlen(token);
+    int restOfLength = dataLength - currentIndex;
+    if (tokenLength > restOfLength) {
         return false;
     }
+    if (memcmp(data + currentIndex, token, tokenLength) != 0) {
+        return false;
+    }
+    skip(tokenLength);
+    return true;
+}
+
+TagAttribute lxe::literalToTagAttribute(TagAttributeType type, std::string_view literal) {
+    switch (type) {
+        case TA_STRING:
+            return TagAttribute().setString(spanToWxString(literal));
+        case TA_BOOL:
+            return TagAttribute().setBool(literal == "true");
+        case TA_INT:
+        case TA_DOUBLE: {
+            //literal is not zero terminated, numbers are short so copy it to the stack
+            char buffer[64];
+            size_t length = std::min(literal.size(), sizeof(buffer) - 1);
+            memcpy(buffer, literal.data(), length);
+            buffer[length] = 0;
+            if (type == TA_DOUBLE) {
+                return TagAttribute().setDouble(strtod(buffer, NULL));
+            }
+            return TagAttribute().setInt((int)strtol(buffer, NULL, 10));
+        }
+        default:
+            return TagAttribute().setNull();
+    }
+}
 
-    for (int i = 0; i < token.length(); i++) {
-        wchar_t tokenChar = token[i].GetValue();
-        wchar_t sourceChar = string[currentIndex + i].GetValue();
-        if (tokenChar != sourceChar) {
-            return false;
+TagAttribute TokenAttribute::toTagAttribute()const {
+    return literalToTagAttribute(type, value.get());
+}
+
+void Tag::addAttribute(TagAttributeEntry*attribute) {
+    attribute->next = NULL;
+    if (lastAttribute == NULL) {
+        firstAttribute = attribute;
+    } else {
+        lastAttribute->next = attribute;
+    }
+    lastAttribute = attribute;
+}
+
+TagAttributeEntry*Tag::findAttribute(std::string_view name) {
+    for (TagAttributeEntry*attribute = firstAttribute; attribute != NULL; attribute = attribute->next) {
+        if (attribute->name == name) {
+            return attribute;
         }
     }
-    skip((unsigned int)token.length());
-    return true;
+    return NULL;
 }
 
-Token Token::createEOF(int line){
+bool Tag::hasAttribute(const wxString&name) {
+    wxScopedCharBuffer utf8Name = name.ToUTF8();
+    return findAttribute(std::string_view(utf8Name.data(), utf8Name.length())) != NULL;
+}
+
+TagAttribute Tag::getAttribute(const wxString&name) {
+    wxScopedCharBuffer utf8Name = name.ToUTF8();
+    TagAttributeEntry*attribute = findAttribute(std::string_view(utf8Name.data(), utf8Name.length()));
+    if (attribute == NULL) {
+        return TagAttribute().setNull();
+    }
+    return literalToTagAttribute(attribute->type, attribute->value);
+}
+
+wxArrayString Tag::getAttributeNames() {
+    wxArrayString list;
+    for (TagAttributeEntry*attribute = firstAttribute; attribute != NULL; attribute = attribute->next) {
+        list.Add(spanToWxString(attribute->name));
+    }
+    return list;
+}
+
+void Tag::addChild(Tag*child) {
+    if (lastChild == NULL) {
+        firstChild = child;
+    } else {
+        lastChild->nextSibling = child;
+    }
+    lastChild = child;
+    childrenCount++;
+}
+
+Tag*Tag::getChild(int index) {
+    Tag*child = firstChild;
+    for (int i = 0; i < index && child != NULL; i++) {
+        child = child->nextSibling;
+    }
+    return child;
+}
+
+Token Token::createEOF(int offset){
     Token token;
     token.type=TokenType_EOF;
-    token.line=line;
+    token.offset=offset;
     return token;
 }
-Token Token::createTagToken(int line, wxString&tagName, AttributesMap&attributes, bool selfClosed){
+Token Token::createTagToken(int offset, std::string_view tagName, std::vector<TokenAttribute>&&attributes, bool selfClosed){
     Token token;
     token.type=TokenType_TAG;
-    token.line=line;
+    token.offset=offset;
     token.selfClosed=selfClosed;
-    token.attributes=attributes;
+    token.attributes=std::move(attributes);
     token.tagName=tagName;
     return token;
 }
-Token Token::createClosingTagToken(int line, wxString&tagName){
+Token Token::createClosingTagToken(int offset, std::string_view tagName){
     Token token;
     token.type=TokenType_TAG_CLOSING;
-    token.line=line;
+    token.offset=offset;
     token.tagName=tagName;
     return token;
 }
-Token Token::createCommentToken(int line, wxString&text){
+Token Token::createCommentToken(int offset, std::string_view text){
     Token token;
     token.type=TokenType_COMMENT;
-    token.line=line;
-    token.text=text;
+    token.offset=offset;
+    token.text=TokenString(text);
     return token;
 }
-Token Token::createRawTextToken(int line, wxString&text){
+Token Token::createRawTextToken(int offset, std::string_view text){
     Token token;
     token.type=TokenType_RAW_TEXT;
-    token.line=line;
-    token.text=text;
+    token.offset=offset;
+    token.text=TokenString(text);
     return token;
 }
 
 
 
 TagsTokenizer::TagsTokenizer(wxString source) {
-    stringParser=new StringParser(source);
+    wxScopedCharBuffer utf8Source = source.ToUTF8();
+    ownedSource.assign(utf8Source.data(), utf8Source.length());
+    stringParser=new StringParser(ownedSource.data(), (int)ownedSource.size());
+}
+
+TagsTokenizer::TagsTokenizer(const char*source, size_t sourceLength) {
+    stringParser=new StringParser(source, (int)sourceLength);
 }
 
 TagsTokenizer::~TagsTokenizer(){
@@ -130,23 +345,33 @@ TagsTokenizer::~TagsTokenizer(){
 }
 
 void TagsTokenizer::addTagWithRawTextContent(wxString tag) {
-    tagsWithRawTextContent.Add(tag);
+    wxScopedCharBuffer utf8Tag = tag.ToUTF8();
+    tagsWithRawTextContent.push_back(std::string(utf8Tag.data(), utf8Tag.length()));
 }
 
-void TagsTokenizer::ungetToken(Token ungetToken) {
-    this->_ungetToken = ungetToken;
+bool TagsTokenizer::isTagWithRawTextContent(std::string_view tag) {
+    for (int i = 0; i < tagsWithRawTextContent.size(); i++) {
+        if (tagsWithRawTextContent[i] == tag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TagsTokenizer::ungetToken(Token&&ungetToken) {
+    this->_ungetToken = std::move(ungetToken);
     hasUngetToken = true;
 }
 
 Token TagsTokenizer::nextToken() {
     if (hasUngetToken) {
         hasUngetToken=false;
-        return _ungetToken;
+        return std::move(_ungetToken);
     }
 
     stringParser->skipBlank();
     if (stringParser->eof()) {
-        return Token::createEOF(stringParser->getLine());
+        return Token::createEOF(stringParser->getCurrentIndex());
     }
     
     if (stringParser->match("<!--")) {
@@ -157,70 +382,68 @@ Token TagsTokenizer::nextToken() {
     }
 
     rawTextFinished = false;
-    if (!rawTextFinished && !tagsStack.empty() && tagsWithRawTextContent.Index(lastTagInStack())!=wxNOT_FOUND) {
+    if (!rawTextFinished && !tagsStack.empty() && isTagWithRawTextContent(lastTagInStack())) {
         return readRawText();
     }
-    wchar_t c = stringParser->getChar();
-    throw ParseException(wxString::Format("Expected start of tag, but found [%c]", c), stringParser->getLine());
+    int c = stringParser->getChar();
+    throw createException(wxString::Format("Expected start of tag, but found [%c]", c), stringParser->getCurrentIndex());
 }
 
 Token TagsTokenizer::readRawText() {
-    int line = stringParser->getLine();
-    wxString text;
+    int offset = stringParser->getCurrentIndex();
+    int startIndex = stringParser->getCurrentIndex();
     while (true) {
-        wchar_t c = stringParser->peek(0);
-        if (c == '<') {
-            int parsingPosition = stringParser->getCurrentIndex();
+        if (!stringParser->skipUntilAnyOf("<")) {
+            break;
+        }
+        int parsingPosition = stringParser->getCurrentIndex();
+        stringParser->getChar();
+        stringParser->skipBlank();
+        if (stringParser->peek(0) == '/') {
             stringParser->getChar();
-            stringParser->skipBlank();
-            if (stringParser->peek(0) == '/') {
-                stringParser->getChar();
-                if (isTokenStartChar(stringParser->peek(0))) {
-                    wxString endTagName = readToken();
-                    if (!tagsStack.empty() && lastTagInStack()==endTagName) {
-                        stringParser->skipBlank();
-                        if (stringParser->peek(0) == '>') {
-                            //finish token is matched
-                            stringParser->setCurrentIndex(parsingPosition);
-                            rawTextFinished = true;
-                            break;
-                        }
+            if (isTokenStartChar(stringParser->peek(0))) {
+                std::string_view endTagName = readToken();
+                if (!tagsStack.empty() && lastTagInStack()==endTagName) {
+                    stringParser->skipBlank();
+                    if (stringParser->peek(0) == '>') {
+                        //finish token is matched
+                        stringParser->setCurrentIndex(parsingPosition);
+                        rawTextFinished = true;
+                        break;
                     }
                 }
             }
-            stringParser->setCurrentIndex(parsingPosition);
         }
-
-        text.append(c);
+        stringParser->setCurrentIndex(parsingPosition);
         stringParser->getChar();
     }
-    return Token::createRawTextToken(line, text);
+    return Token::createRawTextToken(offset, stringParser->span(startIndex, stringParser->getCurrentIndex()));
 }
 
 Token TagsTokenizer::readTag() {
     stringParser->skipBlank();
-    int line = stringParser->getLine();
-    wchar_t c = stringParser->peek(0);
+    int offset = stringParser->getCurrentIndex();
+    int c = stringParser->peek(0);
     if (c == '/') {
         stringParser->getChar();
         return readClosingTag();
     } else if (c == '>') {
-        throw ParseException("Empty tags <> are not allowed", stringParser->getLine());
+        throw createException("Empty tags <> are not allowed", stringParser->getCurrentIndex());
     } else if (isTokenStartChar(c)) {
-        wxString tagName = readToken();
+        std::string_view tagName = readToken();
         bool selfClosing = false;
-        AttributesMap attributes;
+        std::vector<TokenAttribute> attributes;
         while (true) {
             stringParser->skipBlank();
             c = stringParser->peek(0);
-            if (c == (wchar_t) -1) {
-                throw ParseException(wxString::Format("Unexpected end while parsing tag [%s]", tagName), stringParser->getLine());
+            if (c == -1) {
+                throw createException(wxString::Format("Unexpected end while parsing tag [%s]", spanToWxString(tagName)), stringParser->getCurrentIndex());
             }
             if (c == '/') {
                 selfClosing = true;
                 stringParser->getChar();
                 if (stringParser->peek(0) != '>') {
-                    throw ParseException(wxString::Format("Expected [>] after self close mark [/], but found [%c]", stringParser->peek(0)), stringParser->getLine());
+                    throw createException(wxString::Format("Expected [>] after self close mark [/], but found [%c]", stringParser->peek(0)), stringParser->getCurrentIndex());
                 }
                 stringParser->getChar();
                 break;
@@ -229,8 +452,20 @@ Token TagsTokenizer::readTag() {
                 break;
             }
             if (isTokenStartChar(c)) {
-                auto[name, tagAttribute] = readAttribute();
-                attributes[name] = tagAttribute;
+                TokenAttribute attribute = readAttribute();
+                bool replaced = false;
+                for (int i = 0; i < attributes.size(); i++) {
+                    if (attributes[i].name == attribute.name) {
+                        attributes[i] = std::move(attribute);
+                        replaced = true;
+                        break;
+                    }
+                }
+                if (!replaced) {
+                    attributes.push_back(std::move(attribute));
+                }
+            } else {
+                throw createException(wxString::Format("Unexpected symbol [%c] while parsing tag [%s]", c, spanToWxString(tagName)), stringParser->getCurrentIndex());
             }
         }
 
@@ -238,172 +473,185 @@ Token TagsTokenizer::readTag() {
             tagsStack.push_back(tagName);
         }
         
-        return Token::createTagToken(line, tagName, attributes, selfClosing);
+        return Token::createTagToken(offset, tagName, std::move(attributes), selfClosing);
     } else {
-        throw ParseException(wxString::Format("Unexpected symbol [%c] while parsing tag", c), stringParser->getLine());
+        throw createException(wxString::Format("Unexpected symbol [%c] while parsing tag", c), stringParser->getCurrentIndex());
     }
 }
 
 Token TagsTokenizer::readComment() {
-    int line = stringParser->getLine();
-    wxString text;
+    int offset = stringParser->getCurrentIndex();
+    int startIndex = stringParser->getCurrentIndex();
+    int endIndex;
     while (true) {
-        if (stringParser->eof()) {
+        bool found = stringParser->skipUntilAnyOf("-");
+        endIndex = stringParser->getCurrentIndex();
+        if (!found) {
             break;
         }
         if (stringParser->match("-->")) {
             break;
         }
-        wchar_t c = stringParser->peek(0);
-        text.append(c);
         stringParser->getChar();
     }
-    return Token::createCommentToken(line, text);
+    return Token::createCommentToken(offset, stringParser->span(startIndex, endIndex));
 }
 
-std::tuple<wxString,TagAttribute> TagsTokenizer::readAttribute() {
-    wxString attributeName = readToken();
+TokenAttribute TagsTokenizer::readAttribute() {
+    TokenAttribute attribute;
+    attribute.name = readToken();
     stringParser->skipBlank();
-    wchar_t equalSign = stringParser->getChar();
+    int equalSign = stringParser->getChar();
     if (equalSign != '=') {
-        throw ParseException("Expected [=] after attribute name", stringParser->getLine());
+        throw createException("Expected [=] after attribute name", stringParser->getCurrentIndex());
     }
     stringParser->skipBlank();
-    wchar_t c = stringParser->peek(0);
+    int c = stringParser->peek(0);
     if (c == '"' || c == '\'') {
-        wxString str=readQuotedString();
-        return {attributeName, TagAttribute().setString(str)};
+        attribute.type = TA_STRING;
+        attribute.value = readQuotedString();
     } else if (isNumberChar(c)) {
-        wxString value = readNumber();
-        if(value.Contains('.')) {
-            double resultDouble;
-            value.ToDouble(&resultDouble);
-            return {attributeName, TagAttribute().setDouble(resultDouble)};
-        } else {
-            int resultInt;
-            value.ToInt(&resultInt);
-            return {attributeName, TagAttribute().setInt(resultInt)};
-        }
+        attribute.value = readNumber();
+        attribute.type = attribute.value.get().find('.') != std::string_view::npos ? TA_DOUBLE : TA_INT;
     } else {
-        if (stringParser->match("true")) {
-            return {attributeName, TagAttribute().setBool(true)};
-        } else if (stringParser->match("false")) {
-            return {attributeName, TagAttribute().setBool(false)};
+        int startIndex = stringParser->getCurrentIndex();
+        if (stringParser->match("true") || stringParser->match("false")) {
+            attribute.type = TA_BOOL;
+            attribute.value = TokenString(stringParser->span(startIndex, stringParser->getCurrentIndex()));
         } else {
-            throw ParseException(wxString::Format("Cannot parse attribute value of attribute [%s]", attributeName), stringParser->getLine());
+            throw createException(wxString::Format("Cannot parse attribute value of attribute [%s]", spanToWxString(attribute.name)), stringParser->getCurrentIndex());
         }
     }
+    return attribute;
 }
 
 Token TagsTokenizer::readClosingTag() {
-    int line = stringParser->getLine();
-    wxString tagName = readToken();
+    int offset = stringParser->getCurrentIndex();
+    std::string_view tagName = readToken();
     if (tagName.empty()) {
-        throw ParseException("Expected tag name", line);
+        throw createException("Expected tag name", offset);
     }
-    wxString openingTagName = lastTagInStack();
+    if (tagsStack.empty()) {
+        throw createException(wxString::Format("Found close tag [%s] that does not related to any opened tag", spanToWxString(tagName)), offset);
+    }
+    std::string_view openingTagName = lastTagInStack();
     tagsStack.pop_back();
     if (openingTagName!=tagName) {
-        throw ParseException(wxString::Format("Closing tag [%s] is not related to opening tag [%s]",tagName,openingTagName), line);
+        throw createException(wxString::Format("Closing tag [%s] is not related to opening tag [%s]",spanToWxString(tagName),spanToWxString(openingTagName)), offset);
     }
     stringParser->skipBlank();
-    wchar_t closeMark = stringParser->getChar();
+    int closeMark = stringParser->getChar();
     if (closeMark != '>') {
-        throw ParseException(wxString::Format("Closing tag should end with [>] found [%c]",closeMark), stringParser->getLine());
+        throw createException(wxString::Format("Closing tag should end with [>] found [%c]",closeMark), stringParser->getCurrentIndex());
     }
-    return Token::createClosingTagToken(line, tagName);
+    return Token::createClosingTagToken(offset, tagName);
 }
 
-wxString TagsTokenizer::readToken() {
+std::string_view TagsTokenizer::readToken() {
     stringParser->skipBlank();
-    wxString sb;
-    while (true) {
-        wchar_t peekedChar = stringParser->peek(0);
-        if (isTokenChar(peekedChar)) {
-            sb.append(peekedChar);
-            stringParser->getChar();
-        } else {
-            break;
-        }
+    int startIndex = stringParser->getCurrentIndex();
+    while (isTokenChar(stringParser->peek(0))) {
+        stringParser->getChar();
     }
-    return sb;
+    return stringParser->span(startIndex, stringParser->getCurrentIndex());
 }
 
-wxString TagsTokenizer::readQuotedString() {
-    int line=stringParser->getLine();
-    wchar_t quote = stringParser->getChar();
-    wxString sb;
+TokenString TagsTokenizer::readQuotedString() {
+    int offset = stringParser->getCurrentIndex();
+    int quote = stringParser->getChar();
+    const char delimiters[] = {(char)quote, '\\', 0};
+    int startIndex = stringParser->getCurrentIndex();
+    //fast path: string without escape sequences is returned as a view into the source
+    if (!stringParser->skipUntilAnyOf(delimiters)) {
+        throw createException("Found EOF while parsing string", offset);
+    }
+    if (stringParser->peek(0) == quote) {
+        std::string_view value = stringParser->span(startIndex, stringParser->getCurrentIndex());
+        stringParser->getChar();
+        return TokenString(value);
+    }
+
+    std::string sb(stringParser->span(startIndex, stringParser->getCurrentIndex()));
     while (true) {
-        wchar_t c = stringParser->getChar();
-        if (c == (wchar_t) -1) {
-            throw ParseException("Found EOF while parsing string", line);
+        int chunkStart = stringParser->getCurrentIndex();
+        if (!stringParser->skipUntilAnyOf(delimiters)) {
+            throw createException("Found EOF while parsing string", offset);
         }
+        sb.append(stringParser->span(chunkStart, stringParser->getCurrentIndex()));
+        int c = stringParser->getChar();
         if (c == quote) {
             break;
         }
-        if (c == '\\') {
-            wchar_t nc = stringParser->getChar();
-            switch (nc) {
-                case 'n':
-                    sb.append("\n");break;
-                case 'r':
-                    sb.append("\r");break;
-                case 't':
-                    sb.append("\t");break;
-                case '\\':
-                    sb.append("\\");break;
-                case '\'':
-                    sb.append("'");break;
-                case '"':
-                    sb.append("\"");break;
-                default:
-                    sb.append(nc);break;
-            }
-            continue;
+        int nc = stringParser->getChar();
+        switch (nc) {
+            case -1:
+                throw createException("Found EOF while parsing string", offset);
+            case 'n':
+                sb.push_back('\n');break;
+            case 'r':
+                sb.push_back('\r');break;
+            case 't':
+                sb.push_back('\t');break;
+            default:
+                //covers \\, \' and \" as well as unknown escapes
+                sb.push_back((char)nc);break;
         }
-        sb.append(c);
     }
-    return sb;
+    return TokenString(std::move(sb));
 }
 
-wxString TagsTokenizer::readNumber() {
-    wxString sb;
+TokenString TagsTokenizer::readNumber() {
+    int startIndex = stringParser->getCurrentIndex();
+    bool hasDot = false;
+    bool blankAfterMinus = false;
     if (stringParser->peek(0) == '-') {
-        sb.Append("-");
         stringParser->getChar();
+        int minusEnd = stringParser->getCurrentIndex();
         stringParser->skipBlank();
+        if (stringParser->getCurrentIndex() != minusEnd) {
+            blankAfterMinus = true;
+            startIndex = stringParser->getCurrentIndex();
+        }
     }
     while (true) {
-        wchar_t c = stringParser->peek(0);
+        int c = stringParser->peek(0);
         if (isNumberChar(c)) {
-            sb.append(c);
             stringParser->getChar();
         } else if (c == '.') {
-            if (sb.Contains(".")) {
-                throw ParseException(wxString::Format("Cannot parse number because it has 2 dots [.]: %s", sb), stringParser->getLine());
+            if (hasDot) {
+                throw createException(wxString::Format("Cannot parse number because it has 2 dots [.]: %s", spanToWxString(stringParser->span(startIndex, stringParser->getCurrentIndex()))), stringParser->getCurrentIndex());
             }
-            sb.append(".");
+            hasDot = true;
             stringParser->getChar();
         } else {
             break;
         }
     }
-    return sb;
+    std::string_view digits = stringParser->span(startIndex, stringParser->getCurrentIndex());
+    //`- 5` is allowed, the literal is not contiguous in source so it is copied without blanks
+    if (blankAfterMinus) {
+        return TokenString("-" + std::string(digits));
+    }
+    return TokenString(digits);
 }
 
-bool TagsTokenizer::isNumberChar(wchar_t c) {
+bool TagsTokenizer::isNumberChar(int c) {
     return c == '-' || (c>='0' && c<='9');
 }
 
-bool TagsTokenizer::isTokenStartChar(wchar_t c) {
+bool TagsTokenizer::isTokenStartChar(int c) {
     return (c>='a'&&c<='z')||(c>='A'&&c<='Z')||c=='_';
 }
 
-bool TagsTokenizer::isTokenChar(wchar_t c) {
+bool TagsTokenizer::isTokenChar(int c) {
     return isTokenStartChar(c) || isNumberChar(c) || c == ':' || c == '-';
 }
 
-wxString TagsTokenizer::lastTagInStack(){
+ParseException TagsTokenizer::createException(const wxString&message, int offset) {
+    return ParseException(message, getLine(offset), getColumn(offset));
+}
+
+std::string_view TagsTokenizer::lastTagInStack(){
     return tagsStack[tagsStack.size()-1];
 }
 
@@ -413,6 +661,11 @@ TagsParser::TagsParser(wxString source, wxString fileName) {
    tokenizer = new TagsTokenizer(source);
 }
 
+TagsParser::TagsParser(const char*source, size_t sourceLength, wxString fileName) {
+   this->fileName = fileName;
+   tokenizer = new TagsTokenizer(source, sourceLength);
+}
+
 TagsParser::~TagsParser() {
     delete tokenizer;
 }
@@ -423,63 +676,359 @@ void TagsParser::addTagWithRawTextContent(wxString tag) {
 }
 
 
-Tag*TagsParser::internalParseTag() {
-    Token token = tokenizer->nextToken();
-    if (token.getType() == TokenType_EOF) {
-        return NULL;
+void TagsParser::parse(TagsHandler*handler) {
+    bool lineNumbersRequired = handler->isLineNumbersRequired();
+    std::vector<std::pair<std::string_view, int>>openedTags;
+    while (true) {
+        Token token = tokenizer->nextToken();
+        int line = lineNumbersRequired ? tokenizer->getLine(token.getOffset()) : -1;
+        switch (token.getType()) {
+            case TokenType_EOF:
+                if (!openedTags.empty()) {
+                    throw tokenizer->createException(wxString::Format("Found end of input while search for </%s>", spanToWxString(openedTags.back().first)), openedTags.back().second);
+                }
+                return;
+            case TokenType_COMMENT:
+                handler->onComment(token.getText().get(), line);
+                break;
+            case TokenType_RAW_TEXT:
+                handler->onText(token.getText().get(), line);
+                break;
+            case TokenType_TAG:
+                handler->onOpenTag(token.getTagName(), line);
+                for (TokenAttribute&attribute:token.getAttributes()) {
+                    handler->onAttribute(attribute, line);
+                }
+                if (token.isSelfClosed()) {
+                    handler->onCloseTag(token.getTagName(), line);
+                } else {
+                    openedTags.push_back({token.getTagName(), token.getOffset()});
+                }
+                break;
+            case TokenType_TAG_CLOSING:
+                if (openedTags.empty()) {
+                    throw tokenizer->createException(wxString::Format("Found close tag [%s] that does not related to any opened tag", spanToWxString(token.getTagName())), token.getOffset());
+                }
+                if (openedTags.back().first != token.getTagName()) {
+                    throw tokenizer->createException(wxString::Format("Opened tag [%s] but found closing tag [%s]", spanToWxString(openedTags.back().first), spanToWxString(token.getTagName())), token.getOffset());
+                }
+                openedTags.pop_back();
+                handler->onCloseTag(token.getTagName(), line);
+                break;
+            default:
+                throw tokenizer->createException(wxString::Format("Unprocessed token type %d",token.getType()), token.getOffset());
+        }
     }
-    
-    if (token.getType() == TokenType_COMMENT) {
-        Tag*tag=new Tag(token.getLine());
-        tag->initAsComment(token.getText());
-        return tag;
-    }
-    if (token.getType() == TokenType_RAW_TEXT) {
-        Tag*tag=new Tag(token.getLine());
-        tag->initAsRawText(token.getText());
-        return tag;
-    }
-    if (token.getType() == TokenType_TAG_CLOSING) {
-        throw ParseException(wxString("").Format("Found close tag [%s] that does not related to any opened tag",token.getTagName()), token.getLine());
-    }
-    if (token.getType() == TokenType_TAG) {
-        Tag*tag=new Tag(token.getLine());
-        tag->initAsTag(token.getTagName(),token.getAttributes());
-        if (token.isSelfClosed()) {
-            return tag;
+}
+
+/**
+ Collects parse() events into tree of Tag objects allocated in document arena. Top level comments are skipped
+ */
+class TagsTreeBuilder: public TagsHandler {
+private:
+    TagsDocument*document;
+    MonotonicArena&arena;
+    std::vector<Tag*>openedTags;
+public:
+    TagsTreeBuilder(TagsDocument*document):document(document), arena(document->getArena()) {}
+
+    void addTag(Tag*tag) {
+        if (openedTags.empty()) {
+            document->getTags().push_back(tag);
+        } else {
+            openedTags.back()->addChild(tag);
         }
-        
-        while (true) {
-            Token nextToken = tokenizer->nextToken();
-            if (nextToken.getType() == TokenType_EOF) {
-                throw ParseException(wxString("").Format("Found end of input while search for </%s>", token.getTagName()), token.getLine());
-            }
-            if (nextToken.getType() == TokenType_TAG_CLOSING) {
-                if (nextToken.getTagName()!=token.getTagName()) {
-                    throw ParseException(wxString("").Format("Opened tag [%s] but found closing tag [%s]", token.getTagName(), nextToken.getTagName()), nextToken.getLine());
-                }
-                return tag;
+    }
+    void onOpenTag(std::string_view tagName, int line)override {
+        Tag*tag = arena.create<Tag>(TagType_TAG, line, arena.copyString(tagName));
+        addTag(tag);
+        openedTags.push_back(tag);
+    }
+    void onAttribute(const TokenAttribute&attribute, int line)override {
+        TagAttributeEntry*entry = arena.create<TagAttributeEntry>();
+        entry->name = arena.copyString(attribute.name);
+        entry->type = attribute.type;
+        entry->value = arena.copyString(attribute.value.get());
+        openedTags.back()->addAttribute(entry);
+    }
+    void onText(std::string_view text, int line)override {
+        addTag(arena.create<Tag>(TagType_RAW_TEXT, line, arena.copyString(text)));
+    }
+    void onCloseTag(std::string_view tagName, int line)override {
+        openedTags.pop_back();
+    }
+    void onComment(std::string_view text, int line)override {
+        if (openedTags.empty()) {
+            return;
+        }
+        addTag(arena.create<Tag>(TagType_COMMENT, line, arena.copyString(text)));
+    }
+};
+
+void TagsDocument::replayTag(Tag*tag, TagsHandler*handler) {
+    switch (tag->getType()) {
+        case TagType_TAG: {
+            handler->onOpenTag(tag->getTagNameView(), tag->getLine());
+            for (TagAttributeEntry*entry = tag->getFirstAttribute(); entry != NULL; entry = entry->next) {
+                TokenAttribute attribute;
+                attribute.name = entry->name;
+                attribute.type = entry->type;
+                attribute.value = TokenString(entry->value);
+                handler->onAttribute(attribute, tag->getLine());
             }
-            tokenizer->ungetToken(nextToken);
-            Tag*childTag = internalParseTag();
-            if(childTag!=NULL) {
-                tag->addChild(childTag);
+            for (Tag*child = tag->getFirstChild(); child != NULL; child = child->getNextSibling()) {
+                replayTag(child, handler);
             }
+            handler->onCloseTag(tag->getTagNameView(), tag->getLine());
+            break;
         }
+        case TagType_RAW_TEXT:
+            handler->onText(tag->getTextView(), tag->getLine());
+            break;
+        case TagType_COMMENT:
+            handler->onComment(tag->getTextView(), tag->getLine());
+            break;
     }
-    throw ParseException(wxString::Format("Unprocessed token type %d",token.getType()), token.getLine());
 }
 
-std::vector<Tag*>TagsParser::parseTags() {
-    std::vector<Tag*>result;
-    while (true) {
-        Tag*entity = internalParseTag();
-        if (entity == NULL) {
-            return result;
+void TagsDocument::replay(TagsHandler*handler) {
+    for (Tag*tag:tags) {
+        replayTag(tag, handler);
+    }
+}
+
+TagsDocument*TagsParser::parseTags() {
+    TagsDocument*document = new TagsDocument();
+    TagsTreeBuilder builder(document);
+    try {
+        parse(&builder);
+    } catch (ParseException&ex) {
+        delete document;
+        throw;
+    }
+    return document;
+}
+
+static const char CompiledLxmlMagic[4] = {'L', 'X', 'M', 'C'};
+static const uint32_t CompiledLxmlVersion = 1;
+
+CompiledLxmlWriter::CompiledLxmlWriter(ScriptCompiler scriptCompiler) {
+    this->scriptCompiler = scriptCompiler;
+}
+
+void CompiledLxmlWriter::addScriptTag(wxString tagName) {
+    wxScopedCharBuffer utf8Tag = tagName.ToUTF8();
+    scriptTags.push_back(std::string(utf8Tag.data(), utf8Tag.length()));
+}
+
+void CompiledLxmlWriter::writeUint32(std::string&buffer, uint32_t value) {
+    char bytes[4] = {(char)(value & 0xFF), (char)((value >> 8) & 0xFF), (char)((value >> 16) & 0xFF), (char)((value >> 24) & 0xFF)};
+    buffer.append(bytes, 4);
+}
+
+uint32_t CompiledLxmlWriter::internString(std::string_view str) {
+    std::string key(str);
+    auto it = stringIndexes.find(key);
+    if (it != stringIndexes.end()) {
+        return it->second;
+    }
+    uint32_t index = (uint32_t)strings.size();
+    strings.push_back(key);
+    stringIndexes[key] = index;
+    return index;
+}
+
+void CompiledLxmlWriter::writeNodeHeader(CompiledLxmlNodeKind kind, int line) {
+    nodes.push_back((char)kind);
+    writeUint32(nodes, (uint32_t)line);
+    nodesCount++;
+}
+
+void CompiledLxmlWriter::onOpenTag(std::string_view tagName, int line) {
+    writeNodeHeader(CompiledLxmlNode_OPEN_TAG, line);
+    writeUint32(nodes, internString(tagName));
+    openedTags.push_back(tagName);
+}
+
+void CompiledLxmlWriter::onAttribute(const TokenAttribute&attribute, int line) {
+    writeNodeHeader(CompiledLxmlNode_ATTRIBUTE, line);
+    writeUint32(nodes, internString(attribute.name));
+    nodes.push_back((char)attribute.type);
+    TagAttribute value = attribute.toTagAttribute();
+    switch (attribute.type) {
+        case TA_INT:
+            writeUint32(nodes, (uint32_t)value.getInt());
+            break;
+        case TA_DOUBLE: {
+            double doubleValue = value.getDouble();
+            uint64_t bits;
+            memcpy(&bits, &doubleValue, sizeof(bits));
+            writeUint32(nodes, (uint32_t)(bits & 0xFFFFFFFF));
+            writeUint32(nodes, (uint32_t)(bits >> 32));
+            break;
         }
-        if (entity->getType() == TagType_COMMENT) {
-            continue;
+        case TA_BOOL:
+            nodes.push_back(value.getBool() ? 1 : 0);
+            break;
+        case TA_STRING:
+            writeUint32(nodes, internString(attribute.value.get()));
+            break;
+        default:
+            throw ParseException(wxString::Format("Attribute [%s] has type that cannot be compiled", spanToWxString(attribute.name)), line);
+    }
+}
+
+void CompiledLxmlWriter::onText(std::string_view text, int line) {
+    bool isScript = false;
+    if (!openedTags.empty() && scriptCompiler) {
+        for (std::string&scriptTag:scriptTags) {
+            if (scriptTag == openedTags.back()) {
+                isScript = true;
+                break;
+            }
         }
-        result.push_back(entity);
+    }
+    if (!isScript) {
+        writeNodeHeader(CompiledLxmlNode_TEXT, line);
+        writeUint32(nodes, internString(text));
+        return;
+    }
+    std::string bytecode;
+    wxString errorMessage;
+    if (!scriptCompiler(text, line, bytecode, errorMessage)) {
+        throw ParseException(wxString::Format("Cannot compile script: %s", errorMessage), line);
+    }
+    writeNodeHeader(CompiledLxmlNode_PRECOMPILED_TEXT, line);
+    writeUint32(nodes, internString(bytecode));
+}
+
+void CompiledLxmlWriter::onCloseTag(std::string_view tagName, int line) {
+    writeNodeHeader(CompiledLxmlNode_CLOSE_TAG, line);
+    openedTags.pop_back();
+}
+
+std::string CompiledLxmlWriter::getResult() {
+    std::string result(CompiledLxmlMagic, sizeof(CompiledLxmlMagic));
+    writeUint32(result, CompiledLxmlVersion);
+    writeUint32(result, (uint32_t)strings.size());
+    for (std::string&str:strings) {
+        writeUint32(result, (uint32_t)str.size());
+        result.append(str);
+    }
+    writeUint32(result, nodesCount);
+    result.append(nodes);
+    return result;
+}
+
+CompiledLxmlReader::CompiledLxmlReader(const char*data, size_t dataLength) {
+    this->data = data;
+    this->dataLength = dataLength;
+}
+
+bool CompiledLxmlReader::isCompiledLxml(const char*data, size_t dataLength) {
+    return dataLength >= sizeof(CompiledLxmlMagic) && memcmp(data, CompiledLxmlMagic, sizeof(CompiledLxmlMagic)) == 0;
+}
+
+void CompiledLxmlReader::ensureAvailable(size_t count) {
+    if (dataLength - position < count) {
+        throw ParseException("Unexpected end of compiled lxml", 0);
+    }
+}
+
+uint32_t CompiledLxmlReader::readUint32() {
+    ensureAvailable(4);
+    const unsigned char*bytes = (const unsigned char*)data + position;
+    position += 4;
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+uint8_t CompiledLxmlReader::readByte() {
+    ensureAvailable(1);
+    return (uint8_t)data[position++];
+}
+
+std::string_view CompiledLxmlReader::readStringRef() {
+    uint32_t index = readUint32();
+    if (index >= strings.size()) {
+        throw ParseException(wxString::Format("Wrong string index %d in compiled lxml", (int)index), 0);
+    }
+    return strings[index];
+}
+
+void CompiledLxmlReader::read(TagsHandler*handler) {
+    position = 0;
+    strings.clear();
+    if (!isCompiledLxml(data, dataLength)) {
+        throw ParseException("Data is not compiled lxml", 0);
+    }
+    position = sizeof(CompiledLxmlMagic);
+    uint32_t version = readUint32();
+    if (version != CompiledLxmlVersion) {
+        throw ParseException(wxString::Format("Unsupported compiled lxml version %d", (int)version), 0);
+    }
+    uint32_t stringsCount = readUint32();
+    strings.reserve(stringsCount);
+    for (uint32_t i = 0; i < stringsCount; i++) {
+        uint32_t length = readUint32();
+        ensureAvailable(length);
+        strings.push_back(std::string_view(data + position, length));
+        position += length;
+    }
+
+    std::vector<std::string_view>openedTags;
+    uint32_t nodesCount = readUint32();
+    for (uint32_t i = 0; i < nodesCount; i++) {
+        uint8_t kind = readByte();
+        int line = (int)readUint32();
+        switch (kind) {
+            case CompiledLxmlNode_OPEN_TAG: {
+                std::string_view tagName = readStringRef();
+                openedTags.push_back(tagName);
+                handler->onOpenTag(tagName, line);
+                break;
+            }
+            case CompiledLxmlNode_ATTRIBUTE: {
+                std::string_view name = readStringRef();
+                uint8_t type = readByte();
+                TagAttribute value;
+                if (type == TA_INT) {
+                    value.setInt((int)readUint32());
+                } else if (type == TA_DOUBLE) {
+                    uint64_t bits = readUint32();
+                    bits |= (uint64_t)readUint32() << 32;
+                    double doubleValue;
+                    memcpy(&doubleValue, &bits, sizeof(doubleValue));
+                    value.setDouble(doubleValue);
+                } else if (type == TA_BOOL) {
+                    value.setBool(readByte() != 0);
+                } else if (type == TA_STRING) {
+                    value.setString(spanToWxString(readStringRef()));
+                } else {
+                    throw ParseException(wxString::Format("Unknown attribute type %d in compiled lxml", (int)type), line);
+                }
+                handler->onTypedAttribute(name, value, line);
+                break;
+            }
+            case CompiledLxmlNode_TEXT:
+                handler->onText(readStringRef(), line);
+                break;
+            case CompiledLxmlNode_PRECOMPILED_TEXT:
+                handler->onPrecompiledText(readStringRef(), line);
+                break;
+            case CompiledLxmlNode_CLOSE_TAG: {
+                if (openedTags.empty()) {
+                    throw ParseException("Unbalanced close tag in compiled lxml", line);
+                }
+                std::string_view tagName = openedTags.back();
+                openedTags.pop_back();
+                handler->onCloseTag(tagName, line);
+                break;
+            }
+            default:
+                throw ParseException(wxString::Format("Unknown node kind %d in compiled lxml", (int)kind), line);
+        }
+    }
+    if (!openedTags.empty()) {
+        throw ParseException("Compiled lxml has unclosed tags", 0);
     }
 }
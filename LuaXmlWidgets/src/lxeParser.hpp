@@ -19,140 +19,252 @@ class ParseException {
 private:
     wxString errorMessage;
     int line;
+    int column;
 public:
-    ParseException(wxString errorMessage, int line) {
+    ParseException(wxString errorMessage, int line, int column=-1) {
         this->errorMessage=errorMessage;
         this->line=line;
+        this->column=column;
     }
     wxString&getErrorMessage() {return errorMessage;}
     int getLine(){return line;}
+    ///column in bytes from the line start, -1 if unknown
+    int getColumn(){return column;}
 };
 
 class StringParser{
 private:
-    wxString string;
-    int stringLength;
+    const char*data;
+    int dataLength;
     int currentIndex;
-    int line;
+    ///offsets of all '\n', built on the first request of line number, so the happy path does not track lines at all
+    std::vector<int>newLineOffsets;
+    bool newLineIndexBuilt=false;
+    void buildNewLineIndex();
 public:
-    StringParser(wxString&string);
+    StringParser(const char*data, int dataLength);
     bool eof();
     void skip(int count);
 
-    wchar_t getChar();
-    wchar_t peek(int offset);
+    int getChar();
+    int peek(int offset);
     void rewind();
     void skipBlank();
     int getCurrentIndex();
     int getLine();
+    int getLineAt(int offset);
+    int getColumnAt(int offset);
     void setCurrentIndex(int currentIndex);
-    bool match(wxString token);
+    bool match(const char*token);
+    ///Moves to the first occurrence of any of delimiters(max 4). Returns false if eof reached
+    bool skipUntilAnyOf(const char*delimiters);
+    std::string_view span(int startIndex, int endIndex) {return std::string_view(data+startIndex, endIndex-startIndex);}
+};
+
+wxString spanToWxString(std::string_view span);
+
+/**
+ Returns pointer to the first byte in [begin, end) that equals one of delimiters(zero terminated), or end if nothing found.
+ Uses SSE2/AVX2 if available for up to 4 delimiters
+ */
+const char*scanDelimiters(const char*begin, const char*end, const char*delimiters);
+///Portable byte by byte version of scanDelimiters
+const char*scanDelimitersScalar(const char*begin, const char*end, const char*delimiters);
+
+/**
+ Text produced by tokenizer. Usually it is just a view into the source buffer, and only strings that have escape sequences own unescaped copy.
+ */
+class TokenString {
+private:
+    std::string_view view;
+    std::string ownedValue;
+    bool owned=false;
+public:
+    TokenString(){}
+    TokenString(std::string_view view) {this->view=view;}
+    TokenString(std::string&&ownedValue):ownedValue(std::move(ownedValue)) {owned=true;}
+    std::string_view get()const {return owned?std::string_view(ownedValue):view;}
+    bool isOwned()const {return owned;}
+    wxString toWxString()const {return spanToWxString(get());}
+};
+
+///Converts attribute literal from source(or unescaped string) to TagAttribute
+TagAttribute literalToTagAttribute(TagAttributeType type, std::string_view literal);
+
+class TokenAttribute {
+public:
+    std::string_view name;
+    TagAttributeType type;
+    ///for numbers and booleans it is the literal from source, for strings it is unescaped value
+    TokenString value;
+    TagAttribute toTagAttribute()const;
 };
 
+///Tokens are move-only, so attributes of a tag are never copied between tokenizer, unget buffer and consumer
 class Token {
 protected:
-    TokenType type;
-    int line;
+    TokenType type=TokenType_EOF;
+    ///byte offset of the token start, line is computed from it only when needed
+    int offset=0;
     //for tags
-    wxString tagName;
-    bool selfClosed;
-    AttributesMap attributes;
+    std::string_view tagName;
+    bool selfClosed=false;
+    std::vector<TokenAttribute> attributes;
     //for comments and for rawtext
-    wxString text;
+    TokenString text;
 public:
+    Token(){}
+    Token(const Token&)=delete;
+    Token&operator=(const Token&)=delete;
+    Token(Token&&)=default;
+    Token&operator=(Token&&)=default;
     TokenType getType() { return type; }
-    int getLine(){return line;}
-    wxString&getTagName(){return tagName;}
+    int getOffset(){return offset;}
+    std::string_view getTagName(){return tagName;}
     bool isSelfClosed() {return selfClosed;}
-    AttributesMap& getAttributes(){return attributes;}
-    wxString& getText(){return text;}
+    std::vector<TokenAttribute>& getAttributes(){return attributes;}
+    TokenString& getText(){return text;}
     
-    static Token createEOF(int line);
-    static Token createTagToken(int line, wxString&tagName, AttributesMap&attributes, bool selfClosed);
-    static Token createClosingTagToken(int line, wxString&tagName);
-    static Token createCommentToken(int line, wxString&text);
-    static Token createRawTextToken(int line, wxString&text);
+    static Token createEOF(int offset);
+    static Token createTagToken(int offset, std::string_view tagName, std::vector<TokenAttribute>&&attributes, bool selfClosed);
+    static Token createClosingTagToken(int offset, std::string_view tagName);
+    static Token createCommentToken(int offset, std::string_view text);
+    static Token createRawTextToken(int offset, std::string_view text);
+};
+
+class TagsHandler;
+
+///Attribute of Tag as it is written in the source, converted to TagAttribute on request
+struct TagAttributeEntry {
+    std::string_view name;
+    TagAttributeType type;
+    std::string_view value;
+    TagAttributeEntry*next;
 };
 
+/**
+ Node of tags tree built by TagsParser::parseTags. Tags, attributes and strings live in the arena of TagsDocument
+ and are freed together with it, so Tag is never deleted separately
+ */
 class Tag {
 private:
     TagType type;
-    std::vector<Tag*> children;
-    wxString tagName;
-    AttributesMap attributes;
     int line;
-    wxString text;
+    std::string_view tagName;
+    std::string_view text;
+    TagAttributeEntry*firstAttribute=NULL;
+    TagAttributeEntry*lastAttribute=NULL;
+    Tag*firstChild=NULL;
+    Tag*lastChild=NULL;
+    Tag*nextSibling=NULL;
+    int childrenCount=0;
 public:
-    Tag(int line) {
+    Tag(TagType type, int line, std::string_view nameOrText) {
+        this->type = type;
         this->line = line;
-    }
-    ~Tag(){
-        for(int i=0;i<children.size();i++){
-            delete children[i];
+        if (type == TagType_TAG) {
+            tagName = nameOrText;
+        } else {
+            text = nameOrText;
         }
     }
-    wxArrayString getAttributeNames(){
-        wxArrayString list;
-        AttributesMap::iterator it;
-        for( it = attributes.begin(); it != attributes.end(); ++it )
-        {
-            wxString key = it->first;
-            list.Add(key);
-        }
-        return list;
-    }
-    Tag& initAsTag(wxString tagName, AttributesMap&attributes){
-        this->type=TagType_TAG;
-        this->tagName=tagName;
-        this->attributes=attributes;
-        return *this;
-    }
-    Tag& initAsRawText(wxString&text){
-        this->type=TagType_RAW_TEXT;
-        this->text=text;
-        return *this;
-    }
-    Tag& initAsComment(wxString&text){
-        this->type=TagType_COMMENT;
-        this->text=text;
-        return *this;
-    }
     TagType getType(){return type;}
-    std::vector<Tag*>&getChildren(){return children;}
-    void addChild(Tag*child){children.push_back(child);}
-    wxString&getTagName(){return tagName;}
-    AttributesMap&getAttributes(){return attributes;}
     int getLine(){return line;}
-    wxString&getText(){return text;}
+    wxString getTagName(){return spanToWxString(tagName);}
+    std::string_view getTagNameView(){return tagName;}
+    wxString getText(){return spanToWxString(text);}
+    std::string_view getTextView(){return text;}
+
+    void addAttribute(TagAttributeEntry*attribute);
+    TagAttributeEntry*getFirstAttribute(){return firstAttribute;}
+    TagAttributeEntry*findAttribute(std::string_view name);
+    bool hasAttribute(const wxString&name);
+    ///returns null attribute if tag does not have it
+    TagAttribute getAttribute(const wxString&name);
+    wxArrayString getAttributeNames();
+
+    void addChild(Tag*child);
+    Tag*getFirstChild(){return firstChild;}
+    Tag*getNextSibling(){return nextSibling;}
+    int getChildrenCount(){return childrenCount;}
+    Tag*getChild(int index);
+};
+
+/**
+ Result of TagsParser::parseTags. Owns all tags of the document and releases them in one go
+ */
+class TagsDocument {
+private:
+    MonotonicArena arena;
+    std::vector<Tag*>tags;
+    void replayTag(Tag*tag, TagsHandler*handler);
+public:
+    TagsDocument():arena(32*1024){}
+    MonotonicArena&getArena(){return arena;}
+    std::vector<Tag*>&getTags(){return tags;}
+    ///Reports the document to handler as if it was parsed again. Document is not modified, so it can be replayed many times
+    void replay(TagsHandler*handler);
 };
 
 class TagsTokenizer {
 private:
+    ///holds UTF-8 copy of the source if tokenizer was created from wxString, in other case the tokenizer works directly over the caller buffer
+    std::string ownedSource;
     StringParser*stringParser;
-    std::vector<wxString>tagsStack;
-    wxArrayString tagsWithRawTextContent;
+    std::vector<std::string_view>tagsStack;
+    std::vector<std::string>tagsWithRawTextContent;
     bool rawTextFinished;
     Token _ungetToken;
     bool hasUngetToken=false;
 public:
     TagsTokenizer(wxString source);
+    ///Zero-copy mode. Source is UTF-8 buffer that should outlive the tokenizer and all tokens produced by it
+    TagsTokenizer(const char*source, size_t sourceLength);
     ~TagsTokenizer();
 
     void addTagWithRawTextContent(wxString tag);
-    void ungetToken(Token ungetToken);
+    bool isTagWithRawTextContent(std::string_view tag);
+    void ungetToken(Token&&ungetToken);
     Token nextToken();
     Token readRawText();
     Token readTag();
     Token readComment();
-    std::tuple<wxString,TagAttribute> readAttribute();
+    TokenAttribute readAttribute();
     Token readClosingTag();
-    wxString readToken();
-    wxString readQuotedString();
-    wxString readNumber();
-    bool isNumberChar(wchar_t c);
-    bool isTokenStartChar(wchar_t c);
-    bool isTokenChar(wchar_t c);
-    wxString lastTagInStack();
+    std::string_view readToken();
+    TokenString readQuotedString();
+    TokenString readNumber();
+    bool isNumberChar(int c);
+    bool isTokenStartChar(int c);
+    bool isTokenChar(int c);
+    std::string_view lastTagInStack();
+    int getLine(int offset){return stringParser->getLineAt(offset);}
+    int getColumn(int offset){return stringParser->getColumnAt(offset);}
+    ParseException createException(const wxString&message, int offset);
+};
+
+/**
+ Receives events from TagsParser::parse. Attributes of the tag are reported right after onOpenTag, self closed tags get onCloseTag immediately.
+ All string views point to the parser source or to the token and valid only during the call
+ */
+class TagsHandler {
+public:
+    virtual ~TagsHandler(){}
+    virtual void onOpenTag(std::string_view tagName, int line)=0;
+    virtual void onAttribute(const TokenAttribute&attribute, int line)=0;
+    virtual void onText(std::string_view text, int line)=0;
+    virtual void onCloseTag(std::string_view tagName, int line)=0;
+    virtual void onComment(std::string_view text, int line){}
+    ///If false, parser does not compute line numbers and passes -1 as line
+    virtual bool isLineNumbersRequired(){return true;}
+    ///Attribute with already typed value, reported by CompiledLxmlReader instead of onAttribute
+    virtual void onTypedAttribute(std::string_view name, const TagAttribute&value, int line) {
+        throw ParseException("Precompiled attributes are not supported by this handler", line);
+    }
+    ///Lua bytecode compiled from raw text content, reported by CompiledLxmlReader instead of onText
+    virtual void onPrecompiledText(std::string_view bytecode, int line) {
+        throw ParseException("Precompiled text is not supported by this handler", line);
+    }
 };
 
 class TagsParser {
@@ -160,12 +272,69 @@ private:
     TagsTokenizer*tokenizer;
     wxString fileName;
     wxArrayString tagWithRawTextContent;
-    Tag*internalParseTag();
 public:
     TagsParser(wxString source, wxString fileName);
+    ///Parses UTF-8 buffer without copying it. Buffer should be alive while parser is alive
+    TagsParser(const char*source, size_t sourceLength, wxString fileName);
     ~TagsParser();
     void addTagWithRawTextContent(wxString tag);
-    std::vector<Tag*>parseTags();
+    ///Streaming parse, tags are reported to handler as soon as they are read
+    void parse(TagsHandler*handler);
+    ///Builds tree of tags on top of parse(). Caller owns returned document
+    TagsDocument*parseTags();
+};
+
+enum CompiledLxmlNodeKind {
+    CompiledLxmlNode_OPEN_TAG=1, CompiledLxmlNode_ATTRIBUTE, CompiledLxmlNode_TEXT, CompiledLxmlNode_PRECOMPILED_TEXT, CompiledLxmlNode_CLOSE_TAG
+};
+
+/**
+ Writes parse events to binary .lxmlc form. All integers are little endian uint32.
+ Layout: "LXMC", version, strings count, strings(length + bytes), nodes count, nodes.
+ Node is kind byte, line and payload: string index for tag name and text, for attribute name index, type byte and
+ value(int32, 8 bytes double, bool byte or string index). Raw text of script tags is replaced by Lua bytecode
+ */
+class CompiledLxmlWriter: public TagsHandler {
+public:
+    typedef std::function<bool(std::string_view source, int line, std::string&bytecode, wxString&errorMessage)> ScriptCompiler;
+private:
+    std::vector<std::string>strings;
+    std::unordered_map<std::string, uint32_t>stringIndexes;
+    std::string nodes;
+    uint32_t nodesCount=0;
+    std::vector<std::string_view>openedTags;
+    std::vector<std::string>scriptTags;
+    ScriptCompiler scriptCompiler;
+    uint32_t internString(std::string_view str);
+    void writeNodeHeader(CompiledLxmlNodeKind kind, int line);
+    void writeUint32(std::string&buffer, uint32_t value);
+public:
+    CompiledLxmlWriter(ScriptCompiler scriptCompiler);
+    void addScriptTag(wxString tagName);
+    void onOpenTag(std::string_view tagName, int line)override;
+    void onAttribute(const TokenAttribute&attribute, int line)override;
+    void onText(std::string_view text, int line)override;
+    void onCloseTag(std::string_view tagName, int line)override;
+    std::string getResult();
+};
+
+/**
+ Replays .lxmlc file to TagsHandler. Strings passed to handler point directly into the data, so it can be memory mapped file
+ */
+class CompiledLxmlReader {
+private:
+    const char*data;
+    size_t dataLength;
+    size_t position=0;
+    std::vector<std::string_view>strings;
+    uint32_t readUint32();
+    uint8_t readByte();
+    std::string_view readStringRef();
+    void ensureAvailable(size_t count);
+public:
+    CompiledLxmlReader(const char*data, size_t dataLength);
+    static bool isCompiledLxml(const char*data, size_t dataLength);
+    void read(TagsHandler*handler);
 };
 
 }
@@ -0,0 +1,317 @@
+//
+//  lxeQuery.cpp
+//  LuaXmlWidgets
+//
+
+#include "lxe.hpp"
+
+using namespace lxe;
+
+static const Atom ID_ATOM=internAtom(wxString("id"));
+static const Atom CLASS_ATOM=internAtom(wxString("class"));
+
+//----------------- Selector
+static bool isSelectorSpace(char c) {
+    return c==' ' || c=='\t' || c=='\n' || c=='\r';
+}
+
+static bool isSelectorNameChar(char c) {
+    return isalnum((unsigned char)c) || c=='_' || c=='-' || (unsigned char)c>=0x80;
+}
+
+static std::string_view readSelectorName(std::string_view text, size_t&pos, const wxString&selector) {
+    size_t start=pos;
+    while(pos<text.size() && isSelectorNameChar(text[pos])) pos++;
+    if(pos==start) {
+        throw RuntimeException(wxString::Format("Wrong selector '%s': name expected at position %d", selector, (int)start));
+    }
+    return text.substr(start, pos-start);
+}
+
+///names that were never interned cannot be set on any element
+static Atom findSelectorAtom(std::string_view name, SelectorCompound&compound) {
+    Atom atom=AtomTable::instance().find(name);
+    if(atom==NO_ATOM) compound.unmatchable=true;
+    return atom;
+}
+
+Selector Selector::parse(const wxString&selector) {
+    std::string utf8(selector.ToUTF8().data());
+    std::string_view text(utf8);
+    Selector result;
+    std::vector<SelectorCompound>compounds;
+    size_t pos=0;
+    while(true) {
+        while(pos<text.size() && isSelectorSpace(text[pos])) pos++;
+        if(pos>=text.size() || text[pos]==',') {
+            if(compounds.empty()) {
+                throw RuntimeException(wxString::Format("Wrong selector '%s': empty selector", selector));
+            }
+            result.alternatives.push_back(std::move(compounds));
+            compounds.clear();
+            if(pos>=text.size()) break;
+            pos++;
+            continue;
+        }
+        SelectorCompound compound;
+        if(text[pos]=='*') {
+            pos++;
+        } else if(isSelectorNameChar(text[pos])) {
+            compound.tagName=findSelectorAtom(readSelectorName(text, pos, selector), compound);
+        }
+        while(pos<text.size() && !isSelectorSpace(text[pos]) && text[pos]!=',') {
+            char c=text[pos++];
+            if(c=='#') {
+                std::string_view id=readSelectorName(text, pos, selector);
+                compound.id=wxString::FromUTF8(id.data(), id.size());
+            } else if(c=='.') {
+                std::string_view className=readSelectorName(text, pos, selector);
+                compound.classes.push_back(wxString::FromUTF8(className.data(), className.size()));
+            } else if(c=='[') {
+                compound.attributes.push_back(findSelectorAtom(readSelectorName(text, pos, selector), compound));
+                if(pos>=text.size() || text[pos]!=']') {
+                    throw RuntimeException(wxString::Format("Wrong selector '%s': ']' expected at position %d", selector, (int)pos));
+                }
+                pos++;
+            } else {
+                throw RuntimeException(wxString::Format("Wrong selector '%s': unexpected '%c' at position %d", selector, c, (int)pos-1));
+            }
+        }
+        compounds.push_back(std::move(compound));
+    }
+    return result;
+}
+
+//----------------- ElementsIndex
+static void splitClasses(const wxString&value, std::vector<wxString>&classes) {
+    std::string utf8(value.ToUTF8().data());
+    size_t pos=0;
+    while(pos<utf8.size()) {
+        while(pos<utf8.size() && isSelectorSpace(utf8[pos])) pos++;
+        size_t start=pos;
+        while(pos<utf8.size() && !isSelectorSpace(utf8[pos])) pos++;
+        if(pos==start) continue;
+        wxString className=wxString::FromUTF8(utf8.data()+start, pos-start);
+        if(std::find(classes.begin(), classes.end(), className)==classes.end()) {
+            classes.push_back(className);
+        }
+    }
+}
+
+void ElementsIndex::add(DomElement*element) {
+    if(contains(element)) return;
+    Entry&entry=entries[element];
+    entry.order=++orderGenerator;
+    all.emplace_hint(all.end(), entry.order, element);
+    Bucket&tagBucket=byTag[element->getTagNameAtom()];
+    tagBucket.emplace_hint(tagBucket.end(), entry.order, element);
+    updateId(element, entry);
+    updateClasses(element, entry);
+    for(auto&attributeBucket: byAttribute) {
+        if(element->hasSettedAttribute(attributeBucket.first)) {
+            attributeBucket.second.emplace_hint(attributeBucket.second.end(), entry.order, element);
+        }
+    }
+}
+
+void ElementsIndex::remove(DomElement*element) {
+    removeElement(element);
+    for(int i=0;i<element->getChildrenCount();i++) {
+        remove(element->getChild(i));
+    }
+}
+
+void ElementsIndex::removeElement(DomElement*element) {
+    auto it=entries.find(element);
+    if(it==entries.end()) return;
+    Entry&entry=it->second;
+    long long order=entry.order;
+    all.erase(order);
+    auto tagBucket=byTag.find(element->getTagNameAtom());
+    if(tagBucket!=byTag.end()) {
+        tagBucket->second.erase(order);
+        if(tagBucket->second.empty()) byTag.erase(tagBucket);
+    }
+    for(auto&attributeBucket: byAttribute) {
+        attributeBucket.second.erase(order);
+    }
+    if(!entry.id.IsEmpty()) {
+        auto idIt=byId.find(entry.id);
+        if(idIt!=byId.end() && idIt->second==element) {
+            byId.erase(idIt);
+            engine->fireElementIdChangedEvent(entry.id, NULL);
+        }
+    }
+    for(auto&className: entry.classes) {
+        auto classBucket=byClass.find(className);
+        if(classBucket==byClass.end()) continue;
+        classBucket->second.erase(order);
+        if(classBucket->second.empty()) byClass.erase(classBucket);
+    }
+    entries.erase(it);
+}
+
+void ElementsIndex::updateId(DomElement*element, Entry&entry) {
+    wxString id=element->hasSettedAttribute(ID_ATOM)?element->getAttribute("id"):wxString("");
+    if(id==entry.id) return;
+    if(!entry.id.IsEmpty()) {
+        auto it=byId.find(entry.id);
+        //other element may have taken the id since
+        if(it!=byId.end() && it->second==element) {
+            byId.erase(it);
+            engine->fireElementIdChangedEvent(entry.id, NULL);
+        }
+    }
+    entry.id=id;
+    if(!id.IsEmpty()) {
+        byId[id]=element;
+        engine->fireElementIdChangedEvent(id, element);
+    }
+}
+
+void ElementsIndex::updateClasses(DomElement*element, Entry&entry) {
+    std::vector<wxString>classes;
+    if(element->hasSettedAttribute(CLASS_ATOM)) {
+        splitClasses(element->getAttribute("class"), classes);
+    }
+    if(classes==entry.classes) return;
+    for(auto&className: entry.classes) {
+        auto classBucket=byClass.find(className);
+        if(classBucket==byClass.end()) continue;
+        classBucket->second.erase(entry.order);
+        if(classBucket->second.empty()) byClass.erase(classBucket);
+    }
+    for(auto&className: classes) {
+        byClass[className][entry.order]=element;
+    }
+    entry.classes.swap(classes);
+}
+
+void ElementsIndex::onAttributeSet(DomElement*element, Atom attributeName) {
+    bool isId=attributeName==ID_ATOM;
+    bool isClass=attributeName==CLASS_ATOM;
+    auto attributeBucket=byAttribute.empty()?byAttribute.end():byAttribute.find(attributeName);
+    if(!isId && !isClass && attributeBucket==byAttribute.end()) return;
+    auto it=entries.find(element);
+    if(it==entries.end()) return;
+    Entry&entry=it->second;
+    if(isId) updateId(element, entry);
+    if(isClass) updateClasses(element, entry);
+    if(attributeBucket!=byAttribute.end() && element->hasSettedAttribute(attributeName)) {
+        attributeBucket->second[entry.order]=element;
+    }
+}
+
+ElementsIndex::Bucket*ElementsIndex::findAttributeBucket(Atom attributeName) {
+    auto it=byAttribute.find(attributeName);
+    if(it!=byAttribute.end()) return &it->second;
+    Bucket&bucket=byAttribute[attributeName];
+    for(auto&element: all) {
+        if(element.second->hasSettedAttribute(attributeName)) {
+            bucket.emplace_hint(bucket.end(), element.first, element.second);
+        }
+    }
+    return &bucket;
+}
+
+DomElement*ElementsIndex::findById(const wxString&id) {
+    auto it=byId.find(id);
+    return it==byId.end()?NULL:it->second;
+}
+
+bool ElementsIndex::matches(DomElement*element, const SelectorCompound&compound) {
+    if(compound.unmatchable) return false;
+    if(compound.tagName!=NO_ATOM && element->getTagNameAtom()!=compound.tagName) return false;
+    if(!compound.id.IsEmpty() || !compound.classes.empty()) {
+        auto it=entries.find(element);
+        if(it==entries.end()) return false;
+        if(!compound.id.IsEmpty() && it->second.id!=compound.id) return false;
+        std::vector<wxString>&classes=it->second.classes;
+        for(auto&className: compound.classes) {
+            if(std::find(classes.begin(), classes.end(), className)==classes.end()) return false;
+        }
+    }
+    for(Atom attributeName: compound.attributes) {
+        if(!element->hasSettedAttribute(attributeName)) return false;
+    }
+    return true;
+}
+
+bool ElementsIndex::matches(DomElement*element, const std::vector<SelectorCompound>&compounds) {
+    if(!matches(element, compounds.back())) return false;
+    //only descendant combinator exists, so matching the nearest ancestor for every compound is enough
+    DomElement*ancestor=element->getParent();
+    for(int i=(int)compounds.size()-2;i>=0;i--) {
+        while(ancestor!=NULL && !matches(ancestor, compounds[i])) ancestor=ancestor->getParent();
+        if(ancestor==NULL) return false;
+        ancestor=ancestor->getParent();
+    }
+    return true;
+}
+
+void ElementsIndex::query(const std::vector<SelectorCompound>&compounds, std::function<bool(long long order, DomElement*element)>visitor) {
+    const SelectorCompound&subject=compounds.back();
+    if(subject.unmatchable) return;
+    if(!subject.id.IsEmpty()) {
+        DomElement*element=findById(subject.id);
+        if(element!=NULL && matches(element, compounds)) {
+            visitor(entries[element].order, element);
+        }
+        return;
+    }
+    //scans the smallest index bucket of the subject, other conditions are checked per element
+    const Bucket*candidates=&all;
+    if(subject.tagName!=NO_ATOM) {
+        auto it=byTag.find(subject.tagName);
+        if(it==byTag.end()) return;
+        if(it->second.size()<candidates->size()) candidates=&it->second;
+    }
+    for(auto&className: subject.classes) {
+        auto it=byClass.find(className);
+        if(it==byClass.end()) return;
+        if(it->second.size()<candidates->size()) candidates=&it->second;
+    }
+    for(Atom attributeName: subject.attributes) {
+        Bucket*bucket=findAttributeBucket(attributeName);
+        if(bucket->size()<candidates->size()) candidates=bucket;
+    }
+    for(auto&candidate: *candidates) {
+        if(matches(candidate.second, compounds) && !visitor(candidate.first, candidate.second)) return;
+    }
+}
+
+DomElement*ElementsIndex::querySelector(const Selector&selector) {
+    DomElement*result=NULL;
+    long long resultOrder=0;
+    for(auto&compounds: selector.alternatives) {
+        query(compounds, [&result, &resultOrder](long long order, DomElement*element) {
+            if(result==NULL || order<resultOrder) {
+                result=element;
+                resultOrder=order;
+            }
+            return false;
+        });
+    }
+    return result;
+}
+
+void ElementsIndex::querySelectorAll(const Selector&selector, std::vector<DomElement*>&result) {
+    if(selector.alternatives.size()==1) {
+        query(selector.alternatives[0], [&result](long long order, DomElement*element) {
+            result.push_back(element);
+            return true;
+        });
+        return;
+    }
+    //element matching several alternatives is returned once
+    std::map<long long, DomElement*>matched;
+    for(auto&compounds: selector.alternatives) {
+        query(compounds, [&matched](long long order, DomElement*element) {
+            matched[order]=element;
+            return true;
+        });
+    }
+    for(auto&element: matched) {
+        result.push_back(element.second);
+    }
+}
@@ -0,0 +1,84 @@
+//
+//  lxeQuery.hpp
+//  LuaXmlWidgets
+//
+
+#ifndef lxeQuery_hpp
+#define lxeQuery_hpp
+
+namespace lxe {
+class DomElement;
+class Engine;
+
+/**
+ Part of selector matched against single element, like Button#ok.primary[onClick]
+ */
+struct SelectorCompound {
+    Atom tagName=NO_ATOM;//NO_ATOM matches any tag
+    wxString id;
+    std::vector<wxString>classes;
+    std::vector<Atom>attributes;
+    ///name in selector was never interned, so no element can match
+    bool unmatchable=false;
+};
+
+/**
+ Selectors list supporting tag names, #id, .class and [attribute] presence. Compounds separated by whitespace
+ match descendants, selectors separated by comma are alternatives
+ */
+class Selector {
+public:
+    ///every alternative is chain of compounds, the last one matches element itself
+    std::vector<std::vector<SelectorCompound>>alternatives;
+    ///throws RuntimeException on syntax error
+    static Selector parse(const wxString&selector);
+};
+
+/**
+ Indexes of document elements by id, tag name, class and presence of attribute, maintained incrementally when elements
+ are added, removed or their attributes set. Attribute presence index is built on first query of attribute.
+ Query results are in order elements were added to the document
+ */
+class ElementsIndex {
+private:
+    typedef std::map<long long, DomElement*> Bucket;
+    struct Entry {
+        long long order;
+        wxString id;
+        std::vector<wxString>classes;
+    };
+    Engine*engine;
+    long long orderGenerator=0;
+    std::unordered_map<DomElement*, Entry>entries;
+    Bucket all;
+    std::unordered_map<wxString, DomElement*>byId;
+    std::unordered_map<Atom, Bucket>byTag;
+    std::unordered_map<wxString, Bucket>byClass;
+    std::unordered_map<Atom, Bucket>byAttribute;
+    void removeElement(DomElement*element);
+    void updateId(DomElement*element, Entry&entry);
+    void updateClasses(DomElement*element, Entry&entry);
+    Bucket*findAttributeBucket(Atom attributeName);
+    bool matches(DomElement*element, const SelectorCompound&compound);
+    bool matches(DomElement*element, const std::vector<SelectorCompound>&compounds);
+    ///calls visitor for matching elements in order until it returns false
+    void query(const std::vector<SelectorCompound>&compounds, std::function<bool(long long order, DomElement*element)>visitor);
+public:
+    explicit ElementsIndex(Engine*engine) {this->engine=engine;}
+    ///indexes element with its current attributes, does nothing if it is already indexed
+    void add(DomElement*element);
+    ///removes element and all its descendants
+    void remove(DomElement*element);
+    bool contains(DomElement*element) {return entries.find(element)!=entries.end();}
+    ///called after attribute of element is set, cheap for attributes that are not indexed
+    void onAttributeSet(DomElement*element, Atom attributeName);
+    ///returns NULL if no element has id
+    DomElement*findById(const wxString&id);
+    ///returns NULL if no element matches
+    DomElement*querySelector(const Selector&selector);
+    void querySelectorAll(const Selector&selector, std::vector<DomElement*>&result);
+    int getSize() {return (int)entries.size();}
+};
+}
+
+#endif /* lxeQuery_hpp */
@@ -7,6 +7,15 @@
 
 #include <wx/tokenzr.h>
 
+#ifdef _WIN32
+#include <wx/msw/wrapwin.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 double random_double_bound(double max) {
     return ((double)rand() / RAND_MAX)*max;
 }
@@ -45,13 +54,50 @@ wxString eraseFromLeft(wxString str, int count) {
     return str.Right(str.size()-count);
 };
 
-String2BoolHashMap*createAndFillStringsMap(std::vector<wxString>names) {
-    String2BoolHashMap*m = new String2BoolHashMap();
-    for (int i=0; i<names.size(); i++) {
-        wxString&attrName = names[i];
-        (*m)[attrName] = true;
+uint64_t hashBytes(const char*data, size_t length) {
+    uint64_t hash=14695981039346656037ULL;
+    for(size_t i=0;i<length;i++) {
+        hash^=(unsigned char)data[i];
+        hash*=1099511628211ULL;
     }
-    return m;
+    return hash;
+}
+
+AtomTable&AtomTable::instance() {
+    static AtomTable table;
+    return table;
+}
+
+Atom AtomTable::addName(const wxString&name, std::string utf8Name) {
+    Atom atom=(Atom)names.size();
+    names.push_back(name);
+    utf8Names.push_back(std::move(utf8Name));
+    atomsByName[name]=atom;
+    //deque does not move its elements, so view stays valid
+    atomsByUtf8Name[std::string_view(utf8Names.back())]=atom;
+    return atom;
+}
+
+Atom AtomTable::intern(std::string_view utf8Name) {
+    auto found=atomsByUtf8Name.find(utf8Name);
+    if(found!=atomsByUtf8Name.end()) return found->second;
+    return addName(wxString::FromUTF8(utf8Name.data(), utf8Name.size()), std::string(utf8Name));
+}
+
+Atom AtomTable::intern(const wxString&name) {
+    auto found=atomsByName.find(name);
+    if(found!=atomsByName.end()) return found->second;
+    return addName(name, std::string(name.ToUTF8().data()));
+}
+
+Atom AtomTable::find(std::string_view utf8Name) {
+    auto found=atomsByUtf8Name.find(utf8Name);
+    return found==atomsByUtf8Name.end()?NO_ATOM:found->second;
+}
+
+Atom AtomTable::find(const wxString&name) {
+    auto found=atomsByName.find(name);
+    return found==atomsByName.end()?NO_ATOM:found->second;
 }
 
 wxString SerializedFolderReader::readString(const char*data, unsigned int&dataIndex){
@@ -166,3 +212,130 @@ void SerializedFolderReader::load(const char*data, std::function<void()> onUnloa
         }
     }
 }
+
+void*MonotonicArena::allocate(size_t size, size_t alignment) {
+    size_t padding = (alignment - ((size_t)current & (alignment - 1))) & (alignment - 1);
+    if (current == NULL || padding + size > remaining) {
+        //big objects get own block, so the rest of current block is not wasted
+        if (size + alignment > blockSize) {
+            char*block = new char[size + alignment];
+            blocks.push_back(block);
+            allocatedBytes += size;
+            size_t blockPadding = (alignment - ((size_t)block & (alignment - 1))) & (alignment - 1);
+            return block + blockPadding;
+        }
+        current = new char[blockSize];
+        blocks.push_back(current);
+        remaining = blockSize;
+        padding = (alignment - ((size_t)current & (alignment - 1))) & (alignment - 1);
+    }
+    char*result = current + padding;
+    current += padding + size;
+    remaining -= padding + size;
+    allocatedBytes += size;
+    return result;
+}
+
+std::string_view MonotonicArena::copyString(std::string_view str) {
+    if (str.empty()) {
+        return std::string_view();
+    }
+    char*copy = (char*)allocate(str.size(), 1);
+    memcpy(copy, str.data(), str.size());
+    return std::string_view(copy, str.size());
+}
+
+void MonotonicArena::release() {
+    for (char*block:blocks) {
+        delete[] block;
+    }
+    blocks.clear();
+    current = NULL;
+    remaining = 0;
+    allocatedBytes = 0;
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const wxString&path) {
+    close();
+    HANDLE file = CreateFileW(path.wc_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    length = (size_t)fileSize.QuadPart;
+    if (length == 0) {
+        //empty files cannot be mapped
+        data = "";
+        return true;
+    }
+    mappingHandle = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mappingHandle == NULL) {
+        close();
+        return false;
+    }
+    data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (data != NULL && length > 0) {
+        UnmapViewOfFile(data);
+    }
+    if (mappingHandle != NULL) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != NULL) {
+        CloseHandle(fileHandle);
+    }
+    data = NULL;
+    length = 0;
+    mappingHandle = NULL;
+    fileHandle = NULL;
+}
+#else
+bool MappedFile::open(const wxString&path) {
+    close();
+    int fd = ::open(path.ToUTF8().data(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        ::close(fd);
+        return false;
+    }
+    length = (size_t)fileStat.st_size;
+    if (length == 0) {
+        //empty files cannot be mapped
+        ::close(fd);
+        data = "";
+        return true;
+    }
+    void*mapped = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        length = 0;
+        return false;
+    }
+    data = (const char*)mapped;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data != NULL && length > 0) {
+        munmap((void*)data, length);
+    }
+    data = NULL;
+    length = 0;
+}
+#endif
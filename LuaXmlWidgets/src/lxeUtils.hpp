@@ -11,6 +11,10 @@
 typedef std::unordered_map<wxString, bool> String2BoolHashMap;
 typedef std::unordered_map<wxString, int> String2IntHashMap;
 
+///Interned tag or attribute name, see AtomTable
+typedef int Atom;
+const Atom NO_ATOM=-1;
+
 class RuntimeException {
 private:
     wxString errorMessage;
@@ -32,8 +36,64 @@ int selector(const wxString&valueToFind, std::vector<wxString>stringValues, std:
 int selector(bool flag, int valTrue, int valFalse);
 void removeFromStringArray(wxArrayString*stringArray, wxString str);
 wxString eraseFromLeft(wxString str, int count);
+///64-bit FNV-1a, unlike std::hash it is the same between runs and platforms, so it can be stored in files
+uint64_t hashBytes(const char*data, size_t length);
+
 
 
+/**
+ Map limited by count of entries, the least recently used entry is evicted when a new one does not fit.
+ Values are returned by copy, so eviction never invalidates what callers hold
+ */
+template<class Key, class Value>
+class LruCache {
+private:
+    typedef std::pair<Key, Value> Entry;
+    std::list<Entry>entries;//most recently used first
+    std::unordered_map<Key, typename std::list<Entry>::iterator>entriesByKey;
+    size_t limit;
+    long long hits=0;
+    long long misses=0;
+    long long evictions=0;
+public:
+    LruCache(size_t limit){this->limit=limit;}
+    ///create builds value on miss. If it throws, nothing is cached
+    template<class Create>
+    Value get(const Key&key, Create create) {
+        auto found=entriesByKey.find(key);
+        if(found!=entriesByKey.end()) {
+            hits++;
+            entries.splice(entries.begin(), entries, found->second);
+            return found->second->second;
+        }
+        misses++;
+        Value value=create();
+        entries.emplace_front(key, value);
+        entriesByKey[key]=entries.begin();
+        while(entries.size()>limit) {
+            entriesByKey.erase(entries.back().first);
+            entries.pop_back();
+            evictions++;
+        }
+        return value;
+    }
+    void setLimit(size_t limit) {
+        this->limit=limit;
+        while(entries.size()>limit) {
+            entriesByKey.erase(entries.back().first);
+            entries.pop_back();
+            evictions++;
+        }
+    }
+    void clear() {
+        entries.clear();
+        entriesByKey.clear();
+    }
+    size_t getSize(){return entries.size();}
+    long long getHits(){return hits;}
+    long long getMisses(){return misses;}
+    long long getEvictions(){return evictions;}
+};
 
 template<typename T, typename... U>
 size_t getFunctionAddress(std::function<T(U...)> f) {
@@ -73,5 +133,86 @@ public:
     std::vector<SerializedFileChunk*> listChildren(SerializedFileChunk*chunk);
 };
 
-String2BoolHashMap*createAndFillStringsMap(std::vector<wxString>names);
+/**
+ Monotonic allocator. Memory is cut from big blocks and returned only all at once by release() or destructor.
+ Destructors of created objects are never called, so only trivially destructible types can be placed here
+ */
+class MonotonicArena {
+private:
+    std::vector<char*>blocks;
+    size_t blockSize;
+    char*current=NULL;
+    size_t remaining=0;
+    size_t allocatedBytes=0;
+public:
+    MonotonicArena(size_t blockSize=16*1024) {this->blockSize=blockSize;}
+    MonotonicArena(const MonotonicArena&)=delete;
+    MonotonicArena&operator=(const MonotonicArena&)=delete;
+    ~MonotonicArena() {release();}
+    void*allocate(size_t size, size_t alignment);
+    template<typename T, typename... Args>
+    T*create(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena does not call destructors");
+        return new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+    std::string_view copyString(std::string_view str);
+    void release();
+    int getBlocksCount() {return (int)blocks.size();}
+    size_t getAllocatedBytes() {return allocatedBytes;}
+};
+
+/**
+ Read only memory mapped file. Data is valid until close() or destructor
+ */
+class MappedFile {
+private:
+    const char*data=NULL;
+    size_t length=0;
+#ifdef _WIN32
+    void*fileHandle=NULL;
+    void*mappingHandle=NULL;
+#endif
+public:
+    MappedFile(){}
+    MappedFile(const MappedFile&)=delete;
+    MappedFile&operator=(const MappedFile&)=delete;
+    ~MappedFile() {close();}
+    bool open(const wxString&path);
+    void close();
+    const char*getData() {return data;}
+    size_t getLength() {return length;}
+};
+
+/**
+ Global table of interned tag and attribute names. Every distinct name gets small integer once,
+ after that names are compared and hashed as integers. Atoms are never released.
+ Table is not synchronized, it is used only from GUI thread
+ */
+class AtomTable {
+private:
+    std::deque<wxString>names;
+    std::deque<std::string>utf8Names;
+    std::unordered_map<wxString, Atom>atomsByName;
+    std::unordered_map<std::string_view, Atom>atomsByUtf8Name;
+    Atom addName(const wxString&name, std::string utf8Name);
+    AtomTable(){}
+public:
+    AtomTable(const AtomTable&)=delete;
+    AtomTable&operator=(const AtomTable&)=delete;
+    static AtomTable&instance();
+    Atom intern(std::string_view utf8Name);
+    Atom intern(const wxString&name);
+    ///does not add name, returns NO_ATOM if name was never interned
+    Atom find(std::string_view utf8Name);
+    Atom find(const wxString&name);
+    const wxString&getName(Atom atom) {return names[atom];}
+    std::string_view getUtf8Name(Atom atom) {return utf8Names[atom];}
+    int getSize() {return (int)names.size();}
+};
+
+inline Atom internAtom(const wxString&name) {return AtomTable::instance().intern(name);}
+inline Atom internAtom(std::string_view utf8Name) {return AtomTable::instance().intern(utf8Name);}
+inline Atom findAtom(const wxString&name) {return AtomTable::instance().find(name);}
+inline const wxString&atomName(Atom atom) {return AtomTable::instance().getName(atom);}
+
 #endif
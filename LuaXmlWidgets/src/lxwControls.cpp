@@ -13,46 +13,9 @@
 
 using namespace lxe;
 
-String2BoolHashMap*App::allowedAttributes=NULL;
-String2BoolHashMap*App::recreationRequiredAttributes=NULL;
-String2BoolHashMap*AbstractWindow::allowedAttributes=NULL;
-String2BoolHashMap*AbstractWindow::recreationRequiredAttributes=NULL;
-String2BoolHashMap*Control::allowedAttributes=NULL;
-String2BoolHashMap*Control::recreationRequiredAttributes=NULL;
-String2BoolHashMap*Window::allowedAttributes=NULL;
-String2BoolHashMap*Window::recreationRequiredAttributes=NULL;
-String2BoolHashMap*Button::allowedAttributes=NULL;
-String2BoolHashMap*Button::recreationRequiredAttributes=NULL;
-String2BoolHashMap*CheckBox::allowedAttributes=NULL;
-String2BoolHashMap*CheckBox::recreationRequiredAttributes=NULL;
-String2BoolHashMap*Label::allowedAttributes=NULL;
-String2BoolHashMap*Label::recreationRequiredAttributes=NULL;
-String2BoolHashMap*TextInput::allowedAttributes=NULL;
-String2BoolHashMap*TextInput::recreationRequiredAttributes=NULL;
-String2BoolHashMap*DropDown::allowedAttributes=NULL;
-String2BoolHashMap*DropDown::recreationRequiredAttributes=NULL;
-String2BoolHashMap*Option::allowedAttributes=NULL;
-String2BoolHashMap*Option::recreationRequiredAttributes=NULL;
-String2BoolHashMap*Progress::allowedAttributes=NULL;
-String2BoolHashMap*Progress::recreationRequiredAttributes=NULL;
-String2BoolHashMap*Hyperlink::allowedAttributes=NULL;
-String2BoolHashMap*Hyperlink::recreationRequiredAttributes=NULL;
-String2BoolHashMap*GlobalHotkey::allowedAttributes=NULL;
-String2BoolHashMap*GlobalHotkey::recreationRequiredAttributes=NULL;
-String2BoolHashMap*Tree::allowedAttributes=NULL;
-String2BoolHashMap*Tree::recreationRequiredAttributes=NULL;
-String2BoolHashMap*TreeNode::allowedAttributes=NULL;
-String2BoolHashMap*TreeNode::recreationRequiredAttributes=NULL;
-String2BoolHashMap*Panel::allowedAttributes=NULL;
-String2BoolHashMap*Panel::recreationRequiredAttributes=NULL;
-
-wxColour parseAttributeColor(wxString colorString, wxString attributeName) {
-    wxColor color;
-    color.Set(colorString);
-    if(!color.IsOk()){
-        throw RuntimeException(wxString::Format("Wrong color value in %s attribute '%s'", attributeName, colorString));
-    }
-    return color;
+
+wxColour parseAttributeColor(const wxString&colorString, const wxString&attributeName) {
+    return ResourcesCache::instance().getColor(colorString, attributeName);
 }
 
 wxWindow*getParentWindow(DomElement*parent) {
@@ -64,15 +27,54 @@ wxWindow*getParentWindow(DomElement*parent) {
 
 
 //------------- App
+const AttributesSchema*App::getAttributesSchema() {
+    static AttributesSchema schema(LxwDomElement::getAttributesSchema(), NULL, 0);
+    return &schema;
+}
+
 App::App() {
-    if(allowedAttributes==NULL){
-        addAllowedAttributeNamesMap((allowedAttributes=createAndFillStringsMap({})));
-        recreationRequiredAttributes=createAndFillStringsMap({});
-    }
+    setAttributesSchema(getAttributesSchema());
     setChildrenAllowed(true);
 }
 
 //------------- AbstractWindow
+static constexpr AttributeDeclaration abstractWindowAttributes[]={
+    {"cursor", false, ABSTRACT_WINDOW_CURSOR},
+    {"border", true, 0},
+    {"visible", false, ABSTRACT_WINDOW_VISIBLE},
+    {"tabtraversal", true, 0},
+    {"receiveTabEnter", true, 0},
+    {"repaintOnResize", false, 0},
+    {"vscroll", true, 0},
+    {"hscroll", true, 0},
+    {"focusable", false, ABSTRACT_WINDOW_FOCUSABLE},
+    {"width", false, ABSTRACT_WINDOW_WIDTH},
+    {"height", false, ABSTRACT_WINDOW_HEIGHT},
+    {"x", false, ABSTRACT_WINDOW_X},
+    {"y", false, ABSTRACT_WINDOW_Y},
+    {"freeze", false, ABSTRACT_WINDOW_FREEZE},
+    {"label", false, ABSTRACT_WINDOW_LABEL},
+    {"tooltip", false, ABSTRACT_WINDOW_TOOLTIP},
+    {"enable", false, ABSTRACT_WINDOW_ENABLE},
+    {"bgcolor", false, ABSTRACT_WINDOW_BGCOLOR},
+    {"fgcolor", false, ABSTRACT_WINDOW_FGCOLOR},
+    {"allowDropFiles", false, ABSTRACT_WINDOW_ALLOW_DROP_FILES},
+    {"helptext", false, ABSTRACT_WINDOW_HELPTEXT},
+    {"caretx", false, ABSTRACT_WINDOW_CARETX},
+    {"carety", false, ABSTRACT_WINDOW_CARETY},
+    {"caretw", false, ABSTRACT_WINDOW_CARETW},
+    {"careth", false, ABSTRACT_WINDOW_CARETH},
+    {"caretvisible", false, ABSTRACT_WINDOW_CARETVISIBLE},
+    {"font", false, ABSTRACT_WINDOW_FONT},
+    {"layoutContainer", false, ABSTRACT_WINDOW_LAYOUT_CONTAINER},
+    {"layout", false, ABSTRACT_WINDOW_LAYOUT},
+};
+
+const AttributesSchema*AbstractWindow::getAttributesSchema() {
+    static AttributesSchema schema(LxwDomElement::getAttributesSchema(), abstractWindowAttributes);
+    return &schema;
+}
+
 AbstractWindow::AbstractWindow() {
     window=NULL;
     
@@ -83,12 +85,7 @@ AbstractWindow::AbstractWindow() {
     isLayoutContainer = false;
     layoutDirty = false;
     
-    if(allowedAttributes==NULL) {
-        allowedAttributes=createAndFillStringsMap({"cursor","border","visible","tabtraversal","receiveTabEnter","repaintOnResize","vscroll","hscroll","focusable","width","height","x","y","freeze","label","tooltip","enable","bgcolor","fgcolor","allowDropFiles","helptext","caretx","carety","caretw","careth","caretvisible","font","layoutContainer","layout"});
-        recreationRequiredAttributes=createAndFillStringsMap({"border", "tabtraversal", "receiveTabEnter","vscroll","hscroll"});
-    }
-    addAllowedAttributeNamesMap(allowedAttributes);
-    addRecreationAttributeNamesMap(recreationRequiredAttributes);
+    setAttributesSchema(getAttributesSchema());
     
     // Initialize layout entity - will be called later when window is created
     // initLayoutEntity(); // Moved to after window creation
@@ -147,6 +144,9 @@ void AbstractWindow::onFinishedInitialisation() {
 void AbstractWindow::destroyElement() {
     // Cleanup layout resources
     destroyLayoutResources();
+    // Calls queued for destroyed window are dropped
+    layoutScheduled = false;
+    pendingGeometry = 0;
     
     if(window!=NULL) {
         delete window;
@@ -154,184 +154,182 @@ void AbstractWindow::destroyElement() {
     }
 }
 
-bool AbstractWindow::handleChangedAttribute(const wxString&attributeName, TagAttribute&oldValue, TagAttribute&newValue) {
-    if(attributeName=="cursor") {
-        wxString cursorString=getComputedAttribute(attributeName).defaultIfNull(wxString("default"));
-        int cursorIndex=selector(cursorString,
-                                             {"default",        "wait",       "arrow",       "rightarrow",        "cross",       "hand",       "question",              "sizenesw",        "sizens",       "sizenwse",       "sizewe",       "sizing",       "ibeam"},
-                                             { wxCURSOR_DEFAULT, wxCURSOR_WAIT,wxCURSOR_ARROW,wxCURSOR_RIGHT_ARROW,wxCURSOR_CROSS,wxCURSOR_HAND,wxCURSOR_QUESTION_ARROW, wxCURSOR_SIZENESW, wxCURSOR_SIZENS,wxCURSOR_SIZENWSE,wxCURSOR_SIZEWE,wxCURSOR_SIZING,wxCURSOR_IBEAM});
-        if(cursorIndex==-1) {
-            throw RuntimeException(wxString::Format("Unknown cursor '%s'", cursorString));
+bool AbstractWindow::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    const wxString&attributeName=atomName(attribute.name);
+    switch(attribute.handlerId) {
+        case ABSTRACT_WINDOW_CURSOR: {
+            wxString cursorString=getComputedAttribute(attributeName).defaultIfNull(wxString("default"));
+            wxCursor cursor=ResourcesCache::instance().getCursor(cursorString);
+            if (window) {
+                window->SetCursor(cursor);
+            }
+            return true;
         }
-        if (window) {
-            window->SetCursor(wxCursor((wxStockCursor)cursorIndex));
+        case ABSTRACT_WINDOW_BGCOLOR: {
+            wxColour c=parseAttributeColor(getComputedAttribute(attributeName).defaultIfNull(wxString("")), attributeName);
+            if (window) {
+                window->SetBackgroundColour(c);
+            }
+            return true;
         }
-        return true;
-    }
-    if(attributeName=="bgcolor") {
-        wxColour c=parseAttributeColor(getComputedAttribute(attributeName).defaultIfNull(wxString("")), attributeName);
-        if (window) {
-            window->SetBackgroundColour(c);
+        case ABSTRACT_WINDOW_FGCOLOR: {
+            wxColour color=parseAttributeColor(getComputedAttribute(attributeName).getString(), attributeName);
+            if (window) {
+                window->SetOwnForegroundColour(color);
+            }
+            return true;
         }
-        return true;
-    }
-    if(attributeName=="fgcolor") {
-        wxString colorString=getComputedAttribute(attributeName).getString();
-        wxColor color;
-        color.Set(colorString);
-        if(!color.IsOk()){
-            throw RuntimeException(wxString::Format("Wrong color value in fgcolor attribute '%s'", colorString));
+        case ABSTRACT_WINDOW_VISIBLE: {
+            bool visible=getComputedAttribute(attributeName).defaultIfNull(false);
+            if(visible)
+                window->Show();
+            else
+                window->Hide();
+            return true;
         }
-        if (window) {
-            window->SetOwnForegroundColour(color);
+        case ABSTRACT_WINDOW_FOCUSABLE: {
+            window->SetCanFocus(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(false));
+            return true;
         }
-        return true;
-    }
-    if(attributeName=="visible") {
-        bool visible=getComputedAttribute(attributeName).defaultIfNull(false);
-        if(visible)
-            window->Show();
-        else
-            window->Hide();
-        return true;
-    }
-    if(attributeName=="focusable") {
-        window->SetCanFocus(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(false));
-        return true;
-    }
-    if(attributeName=="width") {
-        wxSize size=window->GetSize();
-        window->SetSize(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(10), size.GetHeight());
-        return true;
-    }
-    if(attributeName=="height") {
-        wxSize size=window->GetSize();
-        window->SetSize(size.GetWidth(), getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(10));
-        return true;
-    }
-    if(attributeName=="x") {
-        wxPoint pos=window->GetPosition();
-        pos.x=getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(0);
-        window->SetPosition(pos);
-        return true;
-    }
-    if(attributeName=="y") {
-        wxPoint pos=window->GetPosition();
-        pos.y=getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(0);
-        window->SetPosition(pos);
-        return true;
-    }
-    if(attributeName=="freeze") {
-        bool freeze = getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(false);
-        if (freeze) { window->Freeze(); } else { window->Thaw();}
-        return true;
-    }
-    if(attributeName=="label") {
-        window->SetLabel(getComputedAttributeWithoutDynamic(attributeName).getString());
-        return true;
-    }
-    if(attributeName=="tooltip") {
-        window->SetToolTip(getComputedAttributeWithoutDynamic(attributeName).getString());
-        return true;
-    }
-    if(attributeName=="enable") {
-        bool enabled=getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(true);
-        if (window) {
-            if(enabled){
-                window->Enable();
-            }else{
-                window->Disable();
-            }
+        case ABSTRACT_WINDOW_WIDTH:
+            pendingGeometry|=GEOMETRY_WIDTH;
+            if(!isAttributeBatchActive()) applyPendingGeometry();
+            return true;
+        case ABSTRACT_WINDOW_HEIGHT:
+            pendingGeometry|=GEOMETRY_HEIGHT;
+            if(!isAttributeBatchActive()) applyPendingGeometry();
+            return true;
+        case ABSTRACT_WINDOW_X:
+            pendingGeometry|=GEOMETRY_X;
+            if(!isAttributeBatchActive()) applyPendingGeometry();
+            return true;
+        case ABSTRACT_WINDOW_Y:
+            pendingGeometry|=GEOMETRY_Y;
+            if(!isAttributeBatchActive()) applyPendingGeometry();
+            return true;
+        case ABSTRACT_WINDOW_FREEZE: {
+            bool freeze = getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(false);
+            if (freeze) { window->Freeze(); } else { window->Thaw();}
+            return true;
         }
-        return true;
-    }
-    if(attributeName=="allowDropFiles") {
-        bool enabled=getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(true);
-        if (window) {
-            window->DragAcceptFiles(enabled);
+        case ABSTRACT_WINDOW_LABEL: {
+            window->SetLabel(getComputedAttributeWithoutDynamic(attributeName).getString());
+            return true;
         }
-        return true;
-    }
-    if(attributeName=="helptext") {
-        if (window) {
-            window->SetHelpText(getComputedAttributeWithoutDynamic(attributeName).getString());
+        case ABSTRACT_WINDOW_TOOLTIP: {
+            window->SetToolTip(getComputedAttributeWithoutDynamic(attributeName).getString());
+            return true;
         }
-        return true;
-    }
-    if(attributeName=="caretx") {
-        ensureCaretPresent();
-        if (window && window->GetCaret()) {
-            wxPoint pos=window->GetCaret()->GetPosition();
-            window->GetCaret()->Move(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(0), pos.y);
+        case ABSTRACT_WINDOW_ENABLE: {
+            bool enabled=getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(true);
+            if (window) {
+                if(enabled){
+                    window->Enable();
+                }else{
+                    window->Disable();
+                }
+            }
+            return true;
         }
-        return true;
-    }
-    if(attributeName=="carety") {
-        ensureCaretPresent();
-        if (window && window->GetCaret()) {
-            wxPoint pos=window->GetCaret()->GetPosition();
-            window->GetCaret()->Move(pos.x,getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(0));
+        case ABSTRACT_WINDOW_ALLOW_DROP_FILES: {
+            bool enabled=getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(true);
+            if (window) {
+                window->DragAcceptFiles(enabled);
+            }
+            return true;
         }
-        return true;
-    }
-    if(attributeName=="caretw") {
-        ensureCaretPresent();
-        if (window && window->GetCaret()) {
-            wxSize size=window->GetCaret()->GetSize();
-            window->GetCaret()->SetSize(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(0), size.y);
+        case ABSTRACT_WINDOW_HELPTEXT: {
+            if (window) {
+                window->SetHelpText(getComputedAttributeWithoutDynamic(attributeName).getString());
+            }
+            return true;
         }
-        return true;
-    }
-    if(attributeName=="careth") {
-        ensureCaretPresent();
-        if (window && window->GetCaret()) {
-            wxSize size=window->GetCaret()->GetSize();
-            window->GetCaret()->SetSize(size.x, getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(0));
+        case ABSTRACT_WINDOW_CARETX: {
+            ensureCaretPresent();
+            if (window && window->GetCaret()) {
+                wxPoint pos=window->GetCaret()->GetPosition();
+                window->GetCaret()->Move(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(0), pos.y);
+            }
+            return true;
         }
-        return true;
-    }
-    if(attributeName=="caretvisible") {
-        ensureCaretPresent();
-        bool enabled=getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(true);
-        if (window && window->GetCaret()) {
-            if(enabled)
-                window->GetCaret()->Show();
-            else
-                window->GetCaret()->Hide();
+        case ABSTRACT_WINDOW_CARETY: {
+            ensureCaretPresent();
+            if (window && window->GetCaret()) {
+                wxPoint pos=window->GetCaret()->GetPosition();
+                window->GetCaret()->Move(pos.x,getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(0));
+            }
+            return true;
         }
-        return true;
-    }
-    if(attributeName=="font") {
-        wxFont font;
-        wxString fontString = getComputedAttributeWithoutDynamic(attributeName).getString();
-        if (!font.SetNativeFontInfoUserDesc(fontString)) {
-            throw RuntimeException(wxString::Format("Cannot parse font string '%s'", fontString));
+        case ABSTRACT_WINDOW_CARETW: {
+            ensureCaretPresent();
+            if (window && window->GetCaret()) {
+                wxSize size=window->GetCaret()->GetSize();
+                window->GetCaret()->SetSize(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(0), size.y);
+            }
+            return true;
         }
-        if (window) {
-            window->SetFont(font);
+        case ABSTRACT_WINDOW_CARETH: {
+            ensureCaretPresent();
+            if (window && window->GetCaret()) {
+                wxSize size=window->GetCaret()->GetSize();
+                window->GetCaret()->SetSize(size.x, getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(0));
+            }
+            return true;
+        }
+        case ABSTRACT_WINDOW_CARETVISIBLE: {
+            ensureCaretPresent();
+            bool enabled=getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(true);
+            if (window && window->GetCaret()) {
+                if(enabled)
+                    window->GetCaret()->Show();
+                else
+                    window->GetCaret()->Hide();
+            }
+            return true;
+        }
+        case ABSTRACT_WINDOW_FONT: {
+            wxFont font=ResourcesCache::instance().getFont(getComputedAttributeWithoutDynamic(attributeName).getString());
+            if (window) {
+                window->SetFont(font);
+            }
+            return true;
         }
-        return true;
-    }
     
-    // Handle layout-specific attributes
-    if (attributeName == "layoutContainer") {
-        wxString layoutContainerString = getComputedAttributeWithoutDynamic(attributeName).getString();
-        setLayoutContainer(layoutContainerString);
-        return true;
-    }
-    if (attributeName == "layout") {
-        wxString layoutString = getComputedAttributeWithoutDynamic(attributeName).getString();
-        setLayoutConstraints(layoutString);
-        // Notify parent that layout needs rebuilding
-        if (auto parent = dynamic_cast<AbstractWindow*>(getParent())) {
-            if (parent->isLayoutContainer) {
-                parent->invalidateLayout();
+        // Handle layout-specific attributes
+        case ABSTRACT_WINDOW_LAYOUT_CONTAINER: {
+            wxString layoutContainerString = getComputedAttributeWithoutDynamic(attributeName).getString();
+            setLayoutContainer(layoutContainerString);
+            return true;
+        }
+        case ABSTRACT_WINDOW_LAYOUT: {
+            wxString layoutString = getComputedAttributeWithoutDynamic(attributeName).getString();
+            setLayoutConstraints(layoutString);
+            // Notify parent that layout needs rebuilding
+            if (auto parent = dynamic_cast<AbstractWindow*>(getParent())) {
+                if (parent->isLayoutContainer) {
+                    parent->invalidateLayout();
+                }
             }
+            return true;
         }
-        return true;
     }
-    
-    return DomElement::handleChangedAttribute(attributeName, oldValue, newValue);
+    return DomElement::handleChangedAttribute(attribute, oldValue, newValue);
+}
+
+void AbstractWindow::applyPendingGeometry() {
+    if(pendingGeometry==0 || !window) return;
+    wxRect rect=window->GetRect();
+    if(pendingGeometry&GEOMETRY_X) rect.x=getComputedAttributeWithoutDynamic("x").defaultIfNull(0);
+    if(pendingGeometry&GEOMETRY_Y) rect.y=getComputedAttributeWithoutDynamic("y").defaultIfNull(0);
+    if(pendingGeometry&GEOMETRY_WIDTH) rect.width=getComputedAttributeWithoutDynamic("width").defaultIfNull(10);
+    if(pendingGeometry&GEOMETRY_HEIGHT) rect.height=getComputedAttributeWithoutDynamic("height").defaultIfNull(10);
+    pendingGeometry=0;
+    window->SetSize(rect);
+}
+
+void AbstractWindow::onAttributeBatchApplied() {
+    applyPendingGeometry();
+    LxwDomElement::onAttributeBatchApplied();
 }
 
 bool AbstractWindow::getDynamicAttributeValue(const wxString&attributeName, TagAttribute&tagAttribute) {
@@ -500,8 +498,10 @@ void AbstractWindow::invalidateLayout() {
     
     // Use deferred layout for better performance (Phase 2 enhancement)
     // Schedule layout recalculation on next idle event instead of immediate
-    if (window) {
+    if (window && !layoutScheduled) {
+        layoutScheduled = true;
         window->CallAfter([this]() {
+            layoutScheduled = false;
             if (layoutDirty) { // Check if still dirty when the idle event fires
                 performLayout();
             }
@@ -715,15 +715,17 @@ void AbstractWindow::clearLayoutCache() {
 
 //--------- Control
 
+const AttributesSchema*Control::getAttributesSchema() {
+    static AttributesSchema schema(AbstractWindow::getAttributesSchema(), NULL, 0);
+    return &schema;
+}
+
 Control::Control() {
-    if(allowedAttributes==NULL) {
-        allowedAttributes=createAndFillStringsMap({});
-    }
-    addAllowedAttributeNamesMap(allowedAttributes);
+    setAttributesSchema(getAttributesSchema());
 }
 
-bool Control::handleChangedAttribute(const wxString&attributeName, TagAttribute&oldValue, TagAttribute&newValue) {
-    return AbstractWindow::handleChangedAttribute(attributeName, oldValue, newValue);
+bool Control::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    return AbstractWindow::handleChangedAttribute(attribute, oldValue, newValue);
 }
 
 bool Control::getDynamicAttributeValue(const wxString&attributeName, TagAttribute&tagAttribute){
@@ -732,13 +734,28 @@ bool Control::getDynamicAttributeValue(const wxString&attributeName, TagAttribut
 
 //---------------- Window
 
+static constexpr AttributeDeclaration windowAttributes[]={
+    {"text", false, 0},
+    {"transparent", false, WINDOW_TRANSPARENT},
+    {"decoration", true, 0},
+    {"enableMinimizeButton", true, 0},
+    {"enableMaximizeButton", true, 0},
+    {"enableCloseButton", true, 0},
+    {"enableSystemMenu", true, 0},
+    {"resizeable", true, 0},
+    {"stayOnTop", true, 0},
+    {"stayOnTopOfParent", true, 0},
+    {"smallFrame", true, 0},
+    {"showInTaskBar", true, 0},
+};
+
+const AttributesSchema*Window::getAttributesSchema() {
+    static AttributesSchema schema(AbstractWindow::getAttributesSchema(), windowAttributes);
+    return &schema;
+}
+
 Window::Window() {
-    if(allowedAttributes==NULL) {
-        allowedAttributes=createAndFillStringsMap({"text", "transparent", "decoration","enableMinimizeButton","enableMaximizeButton","enableCloseButton","enableSystemMenu","resizeable","stayOnTop","stayOnTopOfParent","smallFrame","showInTaskBar"});
-        recreationRequiredAttributes=createAndFillStringsMap({"decoration","enableMinimizeButton","enableMaximizeButton","enableCloseButton","enableSystemMenu","resizeable","stayOnTop","stayOnTopOfParent","smallFrame","showInTaskBar"});
-    }
-    addAllowedAttributeNamesMap(allowedAttributes);
-    addRecreationAttributeNamesMap(recreationRequiredAttributes);
+    setAttributesSchema(getAttributesSchema());
     setChildrenAllowed(true);
 }
 
@@ -779,15 +796,18 @@ void Window::initElement(DomElement*parent,wxArrayString*attributesNames) {
     setWindow(frame);
 }
 
-bool Window::handleChangedAttribute(const wxString&attributeName, TagAttribute&oldValue, TagAttribute&newValue) {
-    if(attributeName=="transparent") {
-        double transparency=getAttribute(attributeName, 1.0);
-        if(transparency>1 ||transparency<0)
-            throw RuntimeException(wxString::Format("Transparency should be in interval [0..1], but found %lf", transparency));
-        getWindow()->SetTransparent((int)(transparency*255));
-        return true;
+bool Window::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    const wxString&attributeName=atomName(attribute.name);
+    switch(attribute.handlerId) {
+        case WINDOW_TRANSPARENT: {
+            double transparency=getAttribute(attributeName, 1.0);
+            if(transparency>1 ||transparency<0)
+                throw RuntimeException(wxString::Format("Transparency should be in interval [0..1], but found %lf", transparency));
+            getWindow()->SetTransparent((int)(transparency*255));
+            return true;
+        }
     }
-    return AbstractWindow::handleChangedAttribute(attributeName, oldValue, newValue);
+    return AbstractWindow::handleChangedAttribute(attribute, oldValue, newValue);
 }
 
 bool Window::getDynamicAttributeValue(const wxString&attributeName, TagAttribute&tagAttribute){
@@ -806,13 +826,25 @@ void Window::onWillAddToParent(DomElement*parentElement) {
 
 
 //------------ Button
+static constexpr AttributeDeclaration buttonAttributes[]={
+    {"onClick", false, BUTTON_ON_CLICK},
+    {"text", false, BUTTON_TEXT},
+    {"icon", false, BUTTON_ICON},
+    {"iconHover", false, BUTTON_ICON_HOVER},
+    {"iconPressed", false, BUTTON_ICON_PRESSED},
+    {"iconDisabled", false, BUTTON_ICON_DISABLED},
+    {"type", true, 0},
+    {"note", false, BUTTON_NOTE},
+    {"toggled", false, BUTTON_TOGGLED},
+};
+
+const AttributesSchema*Button::getAttributesSchema() {
+    static AttributesSchema schema(Control::getAttributesSchema(), buttonAttributes);
+    return &schema;
+}
+
 Button::Button() {
-    if(allowedAttributes==NULL) {
-        allowedAttributes=createAndFillStringsMap({"onClick", "text", "icon", "iconHover", "iconPressed","iconDisabled","type", "note", "toggled"});
-        recreationRequiredAttributes=createAndFillStringsMap({"type"});
-    }
-    addAllowedAttributeNamesMap(allowedAttributes);
-    addRecreationAttributeNamesMap(recreationRequiredAttributes);
+    setAttributesSchema(getAttributesSchema());
 
     imageHolder.init([this](wxBitmap*loaded){
         ((wxButton*)getWindow())->SetBitmap(wxBitmapBundle::FromBitmap(*loaded));
@@ -867,63 +899,68 @@ void Button::initElement(DomElement*parent,wxArrayString*attributesNames) {
     }
 }
 
-bool Button::handleChangedAttribute(const wxString&attributeName, TagAttribute&oldValue, TagAttribute&newValue) {
-    wxString typeStr = getComputedAttributeWithoutDynamic("type").defaultIfNull(wxString("default"));
-    if(attributeName=="onClick") {
-        if(typeStr!="toggle"){
-            getWindow()->Unbind(wxEVT_TOGGLEBUTTON, &Button::onClickEventHandler, this);
-            registerEvent(wxEVT_BUTTON, attributeName, [this]() {
-                getWindow()->Bind(wxEVT_BUTTON, &Button::onClickEventHandler, this);
-            }, [this](){
-                getWindow()->Unbind(wxEVT_BUTTON, &Button::onClickEventHandler, this);
-            });
-        }else{
-            getWindow()->Unbind(wxEVT_BUTTON, &Button::onClickEventHandler, this);
-            registerEvent(wxEVT_TOGGLEBUTTON, attributeName, [this]() {
-                getWindow()->Bind(wxEVT_TOGGLEBUTTON, &Button::onClickEventHandler, this);
-            }, [this](){
+bool Button::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    const wxString&attributeName=atomName(attribute.name);
+    switch(attribute.handlerId) {
+        case BUTTON_ON_CLICK: {
+            wxString typeStr = getComputedAttributeWithoutDynamic("type").defaultIfNull(wxString("default"));
+            if(typeStr!="toggle"){
                 getWindow()->Unbind(wxEVT_TOGGLEBUTTON, &Button::onClickEventHandler, this);
-            });
+                registerEvent(wxEVT_BUTTON, attributeName, [this]() {
+                    getWindow()->Bind(wxEVT_BUTTON, &Button::onClickEventHandler, this);
+                }, [this](){
+                    getWindow()->Unbind(wxEVT_BUTTON, &Button::onClickEventHandler, this);
+                });
+            }else{
+                getWindow()->Unbind(wxEVT_BUTTON, &Button::onClickEventHandler, this);
+                registerEvent(wxEVT_TOGGLEBUTTON, attributeName, [this]() {
+                    getWindow()->Bind(wxEVT_TOGGLEBUTTON, &Button::onClickEventHandler, this);
+                }, [this](){
+                    getWindow()->Unbind(wxEVT_TOGGLEBUTTON, &Button::onClickEventHandler, this);
+                });
+            }
+            return true;
         }
-        return true;
-    }
-    if(attributeName=="text") {
-        ((wxButton*)getWindow())->SetLabel(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(wxString("")));
-        return true;
-    }
-    if(attributeName=="note") {
-        if(typeStr=="commandlink") {
-            ((wxCommandLinkButton*)getWindow())->SetNote(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(wxString("")));
+        case BUTTON_TEXT: {
+            ((wxButton*)getWindow())->SetLabel(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(wxString("")));
+            return true;
         }
-        return true;
-    }
-    if(attributeName=="icon") {
-        wxString iconPath = getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(wxString(""));
-        imageHolder.load(iconPath);
-        return true;
-    }
-    if(attributeName=="iconHover") {
-        wxString iconPath = getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(wxString(""));
-        hoverImageHolder.load(iconPath);
-        return true;
-    }
-    if(attributeName=="iconDisabled") {
-        wxString iconPath = getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(wxString(""));
-        disabledImageHolder.load(iconPath);
-        return true;
-    }
-    if(attributeName=="iconPressed") {
-        wxString iconPath = getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(wxString(""));
-        pressedImageHolder.load(iconPath);
-        return true;
-    }
-    if(attributeName=="toggled") {
-        if(typeStr=="toggle") {
-            ((wxToggleButton*)getWindow())->SetValue(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(false));
+        case BUTTON_NOTE: {
+            wxString typeStr = getComputedAttributeWithoutDynamic("type").defaultIfNull(wxString("default"));
+            if(typeStr=="commandlink") {
+                ((wxCommandLinkButton*)getWindow())->SetNote(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(wxString("")));
+            }
+            return true;
+        }
+        case BUTTON_ICON: {
+            wxString iconPath = getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(wxString(""));
+            imageHolder.load(iconPath);
+            return true;
+        }
+        case BUTTON_ICON_HOVER: {
+            wxString iconPath = getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(wxString(""));
+            hoverImageHolder.load(iconPath);
+            return true;
+        }
+        case BUTTON_ICON_DISABLED: {
+            wxString iconPath = getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(wxString(""));
+            disabledImageHolder.load(iconPath);
+            return true;
+        }
+        case BUTTON_ICON_PRESSED: {
+            wxString iconPath = getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(wxString(""));
+            pressedImageHolder.load(iconPath);
+            return true;
+        }
+        case BUTTON_TOGGLED: {
+            wxString typeStr = getComputedAttributeWithoutDynamic("type").defaultIfNull(wxString("default"));
+            if(typeStr=="toggle") {
+                ((wxToggleButton*)getWindow())->SetValue(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(false));
+            }
+            return true;
         }
-        return true;
     }
-    return Control::AbstractWindow::handleChangedAttribute(attributeName, oldValue, newValue);
+    return Control::AbstractWindow::handleChangedAttribute(attribute, oldValue, newValue);
 }
 
 bool Button::getDynamicAttributeValue(const wxString&attributeName, TagAttribute&tagAttribute) {
@@ -940,18 +977,26 @@ bool Button::getDynamicAttributeValue(const wxString&attributeName, TagAttribute
 }
 
 void Button::onClickEventHandler(wxCommandEvent&e) {
-    getEngine()->execFunctionFromAttributeBuilder(getComputedAttributeWithoutDynamic("onClick")).exec(0, [](bool status, ValuesListReader *results, wxString &errorMessage){});
+    getEngine()->runEventHandler(this, getComputedAttributeWithoutDynamic("onClick"));
 }
 
 //------------ CheckBox
-CheckBox::CheckBox() {
-    if(allowedAttributes == NULL) {
-        allowedAttributes = createAndFillStringsMap({"type", "rightAlign", "onChange", "checked", "value", "text"});
-        recreationRequiredAttributes = createAndFillStringsMap({"type", "rightAlign"});
-    }
+static constexpr AttributeDeclaration checkBoxAttributes[]={
+    {"type", true, 0},
+    {"rightAlign", true, 0},
+    {"onChange", false, CHECK_BOX_ON_CHANGE},
+    {"checked", false, CHECK_BOX_CHECKED},
+    {"value", false, CHECK_BOX_VALUE},
+    {"text", false, CHECK_BOX_TEXT},
+};
 
-    addAllowedAttributeNamesMap(allowedAttributes);
-    addRecreationAttributeNamesMap(recreationRequiredAttributes);
+const AttributesSchema*CheckBox::getAttributesSchema() {
+    static AttributesSchema schema(Control::getAttributesSchema(), checkBoxAttributes);
+    return &schema;
+}
+
+CheckBox::CheckBox() {
+    setAttributesSchema(getAttributesSchema());
 }
 
 void CheckBox::initElement(DomElement*parent,wxArrayString*attributesNames) {
@@ -967,41 +1012,44 @@ void CheckBox::initElement(DomElement*parent,wxArrayString*attributesNames) {
     setWindow(chkBox);
 }
 
-bool CheckBox::handleChangedAttribute(const wxString&attributeName, TagAttribute&oldValue, TagAttribute&newValue) {
-    if(attributeName=="onChange") {
-        registerEvent(wxEVT_CHECKBOX, attributeName, [this]() {
-            getWindow()->Bind(wxEVT_CHECKBOX, &CheckBox::onChangeEventHandler, this);
-        }, [this](){
-            getWindow()->Unbind(wxEVT_CHECKBOX, &CheckBox::onChangeEventHandler, this);
-        });
-        return true;
-    }
-    if(attributeName=="text") {
-        ((wxCheckBox*)getWindow())->SetLabel(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(wxString("")));
-        return true;
-    }
-    if(attributeName=="checked") {
-        ((wxCheckBox*)getWindow())->SetValue(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(true));
-        return true;
-    }
-    if(attributeName=="value") {
-        int value=getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(0);
-        wxCheckBoxState state;
-        switch(value){
-            case 0: state=wxCheckBoxState::wxCHK_UNCHECKED;break;
-            case 1: state=wxCheckBoxState::wxCHK_CHECKED;break;
-            case 2:
-                if(getComputedAttributeWithoutDynamic("type").getString()=="2state") {
-                    throw RuntimeException("Cannot set value 2 to field 'value' in checkbox with type '2state'");
-                }
-                state=wxCheckBoxState::wxCHK_UNDETERMINED;
-                break;
-            default:throw RuntimeException("Cannot set %d value to 'value' field of checkbox. Allowed only [0,1,2]");
+bool CheckBox::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    const wxString&attributeName=atomName(attribute.name);
+    switch(attribute.handlerId) {
+        case CHECK_BOX_ON_CHANGE: {
+            registerEvent(wxEVT_CHECKBOX, attributeName, [this]() {
+                getWindow()->Bind(wxEVT_CHECKBOX, &CheckBox::onChangeEventHandler, this);
+            }, [this](){
+                getWindow()->Unbind(wxEVT_CHECKBOX, &CheckBox::onChangeEventHandler, this);
+            });
+            return true;
+        }
+        case CHECK_BOX_TEXT: {
+            ((wxCheckBox*)getWindow())->SetLabel(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(wxString("")));
+            return true;
+        }
+        case CHECK_BOX_CHECKED: {
+            ((wxCheckBox*)getWindow())->SetValue(getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(true));
+            return true;
+        }
+        case CHECK_BOX_VALUE: {
+            int value=getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(0);
+            wxCheckBoxState state;
+            switch(value){
+                case 0: state=wxCheckBoxState::wxCHK_UNCHECKED;break;
+                case 1: state=wxCheckBoxState::wxCHK_CHECKED;break;
+                case 2:
+                    if(getComputedAttributeWithoutDynamic("type").getString()=="2state") {
+                        throw RuntimeException("Cannot set value 2 to field 'value' in checkbox with type '2state'");
+                    }
+                    state=wxCheckBoxState::wxCHK_UNDETERMINED;
+                    break;
+                default:throw RuntimeException("Cannot set %d value to 'value' field of checkbox. Allowed only [0,1,2]");
+            }
+            ((wxCheckBox*)getWindow())->Set3StateValue(state);
+            return true;
         }
-        ((wxCheckBox*)getWindow())->Set3StateValue(state);
-        return true;
     }
-    return Control::AbstractWindow::handleChangedAttribute(attributeName, oldValue, newValue);
+    return Control::AbstractWindow::handleChangedAttribute(attribute, oldValue, newValue);
 }
 
 bool CheckBox::getDynamicAttributeValue(const wxString&attributeName, TagAttribute&tagAttribute) {
@@ -1028,7 +1076,7 @@ bool CheckBox::getDynamicAttributeValue(const wxString&attributeName, TagAttribu
 }
 
 void CheckBox::onChangeEventHandler(wxCommandEvent&e) {
-    getEngine()->execFunctionFromAttributeBuilder(getComputedAttributeWithoutDynamic("onChange")).exec(0, [](bool status, ValuesListReader *results, wxString &errorMessage){});
+    getEngine()->runEventHandler(this, getComputedAttributeWithoutDynamic("onChange"));
 }
 
 
@@ -1036,13 +1084,21 @@ void CheckBox::onChangeEventHandler(wxCommandEvent&e) {
 
 
 //------------ Label
+static constexpr AttributeDeclaration labelAttributes[]={
+    {"text", false, LABEL_TEXT},
+    {"htmlmarkup", false, LABEL_HTMLMARKUP},
+    {"textalign", true, 0},
+    {"ellipsis", true, 0},
+    {"autoresize", true, 0},
+};
+
+const AttributesSchema*Label::getAttributesSchema() {
+    static AttributesSchema schema(Control::getAttributesSchema(), labelAttributes);
+    return &schema;
+}
+
 Label::Label() {
-    if(allowedAttributes==NULL) {
-        allowedAttributes=createAndFillStringsMap({"text","htmlmarkup", "textalign","ellipsis", "autoresize"});
-        recreationRequiredAttributes=createAndFillStringsMap({"textalign","ellipsis", "autoresize"});
-    }
-    addAllowedAttributeNamesMap(allowedAttributes);;
-    addRecreationAttributeNamesMap(recreationRequiredAttributes);
+    setAttributesSchema(getAttributesSchema());
 }
 
 void Label::initElement(DomElement*parent,wxArrayString*attributesNames) {
@@ -1062,32 +1118,36 @@ void Label::initElement(DomElement*parent,wxArrayString*attributesNames) {
     setWindow(staticText);
 }
 
-bool Label::handleChangedAttribute(const wxString&attributeName, TagAttribute&oldValue, TagAttribute&newValue){
-    if(attributeName=="text") {
-        wxString text=getComputedAttribute(attributeName).defaultIfNull(wxString(""));
-        if(htmlMarkup) {
-            ((wxStaticText*)getWindow())->SetLabelMarkup(text);
-        } else {
-            ((wxStaticText*)getWindow())->SetLabel(text);
-        }
+bool Label::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    const wxString&attributeName=atomName(attribute.name);
+    switch(attribute.handlerId) {
+        case LABEL_TEXT: {
+            wxString text=getComputedAttribute(attributeName).defaultIfNull(wxString(""));
+            if(htmlMarkup) {
+                ((wxStaticText*)getWindow())->SetLabelMarkup(text);
+            } else {
+                ((wxStaticText*)getWindow())->SetLabel(text);
+            }
         
-        wxBorder border=getWindow()->GetBorder();
-        if(border!=wxBORDER_NONE&&border!=wxBORDER_DEFAULT) {
-            //for some reason if text changed and the border is set, the border may not be updated(at least on Mac), updating component directly not helps, that is
-            //why let's update whole parent
-            if(getParent()!=NULL)getParent()->repaint();
-        }
+            wxBorder border=getWindow()->GetBorder();
+            if(border!=wxBORDER_NONE&&border!=wxBORDER_DEFAULT) {
+                //for some reason if text changed and the border is set, the border may not be updated(at least on Mac), updating component directly not helps, that is
+                //why let's update whole parent
+                if(getParent()!=NULL)getParent()->repaint();
+            }
         
-        return true;
-    }
-    if(attributeName=="htmlmarkup") {
-        htmlMarkup=getComputedAttribute(attributeName).defaultIfNull(false);
-        if(hasSettedAttribute("text")){
-            handleChangedAttribute("text", TagAttribute().setNull(), TagAttribute().setNull());
+            return true;
+        }
+        case LABEL_HTMLMARKUP: {
+            htmlMarkup=getComputedAttribute(attributeName).defaultIfNull(false);
+            Atom text=findAtom(wxString("text"));
+            if(hasSettedAttribute(text)){
+                handleChangedAttribute(*findAttributeSchemaEntry(text), TagAttribute().setNull(), TagAttribute().setNull());
+            }
+            return true;
         }
-        return true;
     }
-    return Control::handleChangedAttribute(attributeName,oldValue, newValue);
+    return Control::handleChangedAttribute(attribute,oldValue, newValue);
 }
 
 bool Label::getDynamicAttributeValue(const wxString&attributeName, TagAttribute&tagAttribute){
@@ -1096,11 +1156,17 @@ bool Label::getDynamicAttributeValue(const wxString&attributeName, TagAttribute&
 
 
 //----------------- TextInput
+static constexpr AttributeDeclaration textInputAttributes[]={
+    {"text", false, TEXT_INPUT_TEXT},
+};
+
+const AttributesSchema*TextInput::getAttributesSchema() {
+    static AttributesSchema schema(Control::getAttributesSchema(), textInputAttributes);
+    return &schema;
+}
+
 TextInput::TextInput() {
-    if(allowedAttributes==NULL) {
-        allowedAttributes=createAndFillStringsMap({"text"});
-    }
-    addAllowedAttributeNamesMap(allowedAttributes);
+    setAttributesSchema(getAttributesSchema());
 }
 
 void TextInput::initElement(DomElement*parent,wxArrayString*attributesNames) {
@@ -1109,14 +1175,17 @@ void TextInput::initElement(DomElement*parent,wxArrayString*attributesNames) {
     setWindow(text);
 }
 
-bool TextInput::handleChangedAttribute(const wxString&name, TagAttribute&oldValue, TagAttribute&newValue) {
-    if(name=="text") {
-        wxString value=getAttribute(name);
-        ((wxTextCtrl*)getWindow())->Clear();
-        ((wxTextCtrl*)getWindow())->AppendText(value);
-        return true;
+bool TextInput::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    const wxString&name=atomName(attribute.name);
+    switch(attribute.handlerId) {
+        case TEXT_INPUT_TEXT: {
+            wxString value=getAttribute(name);
+            ((wxTextCtrl*)getWindow())->Clear();
+            ((wxTextCtrl*)getWindow())->AppendText(value);
+            return true;
+        }
     }
-    return Control::AbstractWindow::handleChangedAttribute(name, oldValue, newValue);
+    return Control::AbstractWindow::handleChangedAttribute(attribute, oldValue, newValue);
 }
 
 bool TextInput::getDynamicAttributeValue(const wxString&attributeName, TagAttribute&tagAttribute) {
@@ -1125,13 +1194,18 @@ bool TextInput::getDynamicAttributeValue(const wxString&attributeName, TagAttrib
 
 
 //----------------- DropDown
+static constexpr AttributeDeclaration dropDownAttributes[]={
+    {"onChange", false, DROP_DOWN_ON_CHANGE},
+    {"selectedIndex", false, DROP_DOWN_SELECTED_INDEX},
+};
+
+const AttributesSchema*DropDown::getAttributesSchema() {
+    static AttributesSchema schema(Control::getAttributesSchema(), dropDownAttributes);
+    return &schema;
+}
+
 DropDown::DropDown() {
-    if(allowedAttributes==NULL) {
-        allowedAttributes=createAndFillStringsMap({"onChange", "selectedIndex"});
-        recreationRequiredAttributes = createAndFillStringsMap({});
-    }
-    addAllowedAttributeNamesMap(allowedAttributes);
-    addRecreationAttributeNamesMap(recreationRequiredAttributes);
+    setAttributesSchema(getAttributesSchema());
     setChildrenAllowed(true);
 }
 
@@ -1142,27 +1216,25 @@ void DropDown::initElement(DomElement*parent,wxArrayString*attributesNames) {
     setWindow(choice);
 }
 
-bool DropDown::handleChangedAttribute(const wxString&attributeName, TagAttribute&oldValue, TagAttribute&newValue) {
-    if (attributeName=="onChange") {
-        registerEvent(wxEVT_CHOICE, attributeName, [this]() {
-            getWindow()->Bind(wxEVT_CHOICE, &DropDown::onChangeEventHandler, this);
-        }, [this](){
-            getWindow()->Unbind(wxEVT_CHOICE, &DropDown::onChangeEventHandler, this);
-        });
-        return true;
-    }
+bool DropDown::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    const wxString&attributeName=atomName(attribute.name);
+    switch(attribute.handlerId) {
+        case DROP_DOWN_ON_CHANGE: {
+            registerEvent(wxEVT_CHOICE, attributeName, [this]() {
+                getWindow()->Bind(wxEVT_CHOICE, &DropDown::onChangeEventHandler, this);
+            }, [this](){
+                getWindow()->Unbind(wxEVT_CHOICE, &DropDown::onChangeEventHandler, this);
+            });
+            return true;
+        }
     
-    if (attributeName == "selectedIndex") {
-        int newIndex = getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(-1);
-        ((wxChoice*)getWindow())->SetSelection(newIndex);
-        return true;
-    }
-
-    if (attributeName == "selectedValue") {
-        return true;
+        case DROP_DOWN_SELECTED_INDEX: {
+            int newIndex = getComputedAttributeWithoutDynamic(attributeName).defaultIfNull(-1);
+            ((wxChoice*)getWindow())->SetSelection(newIndex);
+            return true;
+        }
     }
-    
-    return Control::AbstractWindow::handleChangedAttribute(attributeName, oldValue, newValue);
+    return Control::AbstractWindow::handleChangedAttribute(attribute, oldValue, newValue);
 }
 
 bool DropDown::getDynamicAttributeValue(const wxString&attributeName, TagAttribute&tagAttribute) {
@@ -1207,30 +1279,35 @@ void DropDown::onChildChanged(DomElement*child, wxString changeType) {
 }
 
 void DropDown::onChangeEventHandler(wxCommandEvent&e) {
-    getEngine()->execFunctionFromAttributeBuilder(getComputedAttributeWithoutDynamic("onChange")).exec(0, [](bool status, ValuesListReader *results, wxString &errorMessage){});
+    getEngine()->runEventHandler(this, getComputedAttributeWithoutDynamic("onChange"));
 }
 
 //----------------- Option
+static constexpr AttributeDeclaration optionAttributes[]={
+    {"text", false, OPTION_CONTENT},
+    {"value", false, OPTION_CONTENT},
+};
+
+const AttributesSchema*Option::getAttributesSchema() {
+    static AttributesSchema schema(LxwDomElement::getAttributesSchema(), optionAttributes);
+    return &schema;
+}
+
 Option::Option() {
-    if (allowedAttributes == NULL) {
-        allowedAttributes=createAndFillStringsMap({"text", "value"});
-        recreationRequiredAttributes = createAndFillStringsMap({});
-    }
-    addAllowedAttributeNamesMap(allowedAttributes);
-    addRecreationAttributeNamesMap(recreationRequiredAttributes);
+    setAttributesSchema(getAttributesSchema());
 }
 
 void Option::initElement(DomElement*parent,wxArrayString*attributesNames) {
 }
 
-bool Option::handleChangedAttribute(const wxString&name, TagAttribute&oldValue, TagAttribute&newValue) {
-    if(name=="text" || name=="value") {
+bool Option::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    if(attribute.handlerId==OPTION_CONTENT) {
         if(!isInitPhase()) {
             notifyParentAboutChange();
         }
         return true;
     }
-    return DomElement::handleChangedAttribute(name, oldValue, newValue);
+    return DomElement::handleChangedAttribute(attribute, oldValue, newValue);
 }
 
 bool Option::getDynamicAttributeValue(const wxString&attributeName, TagAttribute&tagAttribute) {
@@ -1239,13 +1316,21 @@ bool Option::getDynamicAttributeValue(const wxString&attributeName, TagAttribute
 
 //----------------- Progress
 
+static constexpr AttributeDeclaration progressAttributes[]={
+    {"value", false, PROGRESS_VALUE},
+    {"max", false, PROGRESS_MAX},
+    {"smooth", true, 0},
+    {"vertical", true, 0},
+    {"indeterminate", false, PROGRESS_INDETERMINATE},
+};
+
+const AttributesSchema*Progress::getAttributesSchema() {
+    static AttributesSchema schema(Control::getAttributesSchema(), progressAttributes);
+    return &schema;
+}
+
 Progress::Progress() {
-    if(allowedAttributes==NULL) {
-        allowedAttributes=createAndFillStringsMap({"value", "max", "smooth", "vertical", "indeterminate"});
-        recreationRequiredAttributes = createAndFillStringsMap({"smooth", "vertical"});
-    }
-    addAllowedAttributeNamesMap(allowedAttributes);
-    addRecreationAttributeNamesMap(recreationRequiredAttributes);
+    setAttributesSchema(getAttributesSchema());
     value=0;
     indeterminate=false;
 }
@@ -1270,27 +1355,30 @@ void Progress::initElement(DomElement*parent,wxArrayString*attributesNames) {
     setWindow(gauge);
 };
 
-bool Progress::handleChangedAttribute(const wxString&name, TagAttribute&oldValue, TagAttribute&newValue){
-    if(name=="value") {
-        setAttribute("indeterminate", TagAttribute().setBool(false));
-        value = getComputedAttributeWithoutDynamic(name).defaultIfNull(0);
-        ((wxGauge*)getWindow())->SetValue(value);
-        return true;
-    }
-    if(name=="max") {
-        ((wxGauge*)getWindow())->SetRange(getComputedAttributeWithoutDynamic(name).defaultIfNull(100));
-        return true;
-    }
-    if(name=="indeterminate") {
-        indeterminate=getComputedAttributeWithoutDynamic(name).defaultIfNull(false);
-        if (indeterminate) {
-            ((wxGauge*)getWindow())->Pulse();
-        } else {
+bool Progress::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    const wxString&name=atomName(attribute.name);
+    switch(attribute.handlerId) {
+        case PROGRESS_VALUE: {
+            setAttribute("indeterminate", TagAttribute().setBool(false));
+            value = getComputedAttributeWithoutDynamic(name).defaultIfNull(0);
             ((wxGauge*)getWindow())->SetValue(value);
+            return true;
+        }
+        case PROGRESS_MAX: {
+            ((wxGauge*)getWindow())->SetRange(getComputedAttributeWithoutDynamic(name).defaultIfNull(100));
+            return true;
+        }
+        case PROGRESS_INDETERMINATE: {
+            indeterminate=getComputedAttributeWithoutDynamic(name).defaultIfNull(false);
+            if (indeterminate) {
+                ((wxGauge*)getWindow())->Pulse();
+            } else {
+                ((wxGauge*)getWindow())->SetValue(value);
+            }
+            return true;
         }
-        return true;
     }
-    return Control::handleChangedAttribute(name, oldValue, newValue);
+    return Control::handleChangedAttribute(attribute, oldValue, newValue);
 }
 
 bool Progress::getDynamicAttributeValue(const wxString&attributeName, TagAttribute&tagAttribute){
@@ -1308,13 +1396,24 @@ bool Progress::getDynamicAttributeValue(const wxString&attributeName, TagAttribu
 
 //----------------- Hyperlink
 
+static constexpr AttributeDeclaration hyperlinkAttributes[]={
+    {"href", false, HYPERLINK_HREF},
+    {"visited", false, HYPERLINK_VISITED},
+    {"normalColor", false, HYPERLINK_NORMAL_COLOR},
+    {"visitedColor", false, HYPERLINK_VISITED_COLOR},
+    {"hoverColor", false, HYPERLINK_HOVER_COLOR},
+    {"onLink", false, HYPERLINK_ON_LINK},
+    {"align", true, 0},
+    {"contextMenu", true, 0},
+};
+
+const AttributesSchema*Hyperlink::getAttributesSchema() {
+    static AttributesSchema schema(Control::getAttributesSchema(), hyperlinkAttributes);
+    return &schema;
+}
+
 Hyperlink::Hyperlink() {
-    if(allowedAttributes==NULL) {
-        allowedAttributes=createAndFillStringsMap({"href", "visited", "normalColor", "visitedColor", "hoverColor", "onLink", "align", "contextMenu"});
-        recreationRequiredAttributes = createAndFillStringsMap({"align", "contextMenu"});
-    }
-    addAllowedAttributeNamesMap(allowedAttributes);
-    addRecreationAttributeNamesMap(recreationRequiredAttributes);
+    setAttributesSchema(getAttributesSchema());
 }
 
 void Hyperlink::initElement(DomElement*parent,wxArrayString*attributesNames) {
@@ -1333,42 +1432,45 @@ void Hyperlink::initElement(DomElement*parent,wxArrayString*attributesNames) {
     setWindow(link);
 };
 
-bool Hyperlink::handleChangedAttribute(const wxString&attributeName, TagAttribute&oldValue, TagAttribute&newValue){
-    if(attributeName=="href") {
-        ((wxHyperlinkCtrl*)getWindow())->SetURL(getComputedAttribute(attributeName).defaultIfNull(wxString("")));
-        return true;
-    }
-    if(attributeName=="visited") {
-        bool visited=getComputedAttribute("visited").defaultIfNull(false);
-        ((wxHyperlinkCtrl*)getWindow())->SetVisited(visited); // TODO: not updated until user will hover the mouse
-        //visited color actually changed only after user will hover mouse over the component. Simulate mouse moving over the component
-        wxMouseEvent event(wxEVT_MOTION);
-        ((wxHyperlinkCtrl*)getWindow())->GetEventHandler()->ProcessEvent(event);
-        wxMouseEvent event2(wxEVT_LEAVE_WINDOW);
-        ((wxHyperlinkCtrl*)getWindow())->GetEventHandler()->ProcessEvent(event2);
-        return true;
-    }
-    if(attributeName=="visitedColor") {
-        ((wxHyperlinkCtrl*)getWindow())->SetVisitedColour(parseAttributeColor(getComputedAttribute("visitedColor").defaultIfNull(wxString("green")), attributeName));
-        return true;
-    }
-    if(attributeName=="normalColor") {
-        ((wxHyperlinkCtrl*)getWindow())->SetNormalColour(parseAttributeColor(getComputedAttribute("normalColor").defaultIfNull(wxString("blue")), attributeName));
-        return true;
-    }
-    if(attributeName=="hoverColor") {
-        ((wxHyperlinkCtrl*)getWindow())->SetHoverColour(parseAttributeColor(getComputedAttribute("hoverColor").defaultIfNull(wxString("red")), attributeName));
-        return true;
-    }
-    if (attributeName=="onLink") {
-        registerEvent(wxEVT_HYPERLINK, attributeName, [this]() {
-            getWindow()->Bind(wxEVT_HYPERLINK, &Hyperlink::onHyperLinkEventHandler, this);
-        }, [this](){
-            getWindow()->Unbind(wxEVT_HYPERLINK, &Hyperlink::onHyperLinkEventHandler, this);
-        });
-        return true;
+bool Hyperlink::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    const wxString&attributeName=atomName(attribute.name);
+    switch(attribute.handlerId) {
+        case HYPERLINK_HREF: {
+            ((wxHyperlinkCtrl*)getWindow())->SetURL(getComputedAttribute(attributeName).defaultIfNull(wxString("")));
+            return true;
+        }
+        case HYPERLINK_VISITED: {
+            bool visited=getComputedAttribute("visited").defaultIfNull(false);
+            ((wxHyperlinkCtrl*)getWindow())->SetVisited(visited); // TODO: not updated until user will hover the mouse
+            //visited color actually changed only after user will hover mouse over the component. Simulate mouse moving over the component
+            wxMouseEvent event(wxEVT_MOTION);
+            ((wxHyperlinkCtrl*)getWindow())->GetEventHandler()->ProcessEvent(event);
+            wxMouseEvent event2(wxEVT_LEAVE_WINDOW);
+            ((wxHyperlinkCtrl*)getWindow())->GetEventHandler()->ProcessEvent(event2);
+            return true;
+        }
+        case HYPERLINK_VISITED_COLOR: {
+            ((wxHyperlinkCtrl*)getWindow())->SetVisitedColour(parseAttributeColor(getComputedAttribute("visitedColor").defaultIfNull(wxString("green")), attributeName));
+            return true;
+        }
+        case HYPERLINK_NORMAL_COLOR: {
+            ((wxHyperlinkCtrl*)getWindow())->SetNormalColour(parseAttributeColor(getComputedAttribute("normalColor").defaultIfNull(wxString("blue")), attributeName));
+            return true;
+        }
+        case HYPERLINK_HOVER_COLOR: {
+            ((wxHyperlinkCtrl*)getWindow())->SetHoverColour(parseAttributeColor(getComputedAttribute("hoverColor").defaultIfNull(wxString("red")), attributeName));
+            return true;
+        }
+        case HYPERLINK_ON_LINK: {
+            registerEvent(wxEVT_HYPERLINK, attributeName, [this]() {
+                getWindow()->Bind(wxEVT_HYPERLINK, &Hyperlink::onHyperLinkEventHandler, this);
+            }, [this](){
+                getWindow()->Unbind(wxEVT_HYPERLINK, &Hyperlink::onHyperLinkEventHandler, this);
+            });
+            return true;
+        }
     }
-    return Control::handleChangedAttribute(attributeName, oldValue, newValue);
+    return Control::handleChangedAttribute(attribute, oldValue, newValue);
 }
 
 bool Hyperlink::getDynamicAttributeValue(const wxString&attributeName, TagAttribute&tagAttribute) {
@@ -1376,17 +1478,23 @@ bool Hyperlink::getDynamicAttributeValue(const wxString&attributeName, TagAttrib
 }
 
 void Hyperlink::onHyperLinkEventHandler(wxHyperlinkEvent&e){
-    getEngine()->execFunctionFromAttributeBuilder(getComputedAttributeWithoutDynamic("onLink")).exec(0, [](bool status, ValuesListReader *results, wxString &errorMessage){});
+    getEngine()->runEventHandler(this, getComputedAttributeWithoutDynamic("onLink"));
 }
 
 //------------ GlobalHotkey
+static constexpr AttributeDeclaration globalHotkeyAttributes[]={
+    {"hotkey", true, 0},
+    {"onHotkey", false, GLOBAL_HOTKEY_ON_HOTKEY},
+    {"state", false, 0},
+};
+
+const AttributesSchema*GlobalHotkey::getAttributesSchema() {
+    static AttributesSchema schema(LxwDomElement::getAttributesSchema(), globalHotkeyAttributes);
+    return &schema;
+}
+
 GlobalHotkey::GlobalHotkey() {
-    if (allowedAttributes == NULL) {
-        allowedAttributes=createAndFillStringsMap({"hotkey", "onHotkey", "state"});
-        recreationRequiredAttributes = createAndFillStringsMap({"hotkey"});
-    }
-    addAllowedAttributeNamesMap(allowedAttributes);
-    addRecreationAttributeNamesMap(recreationRequiredAttributes);
+    setAttributesSchema(getAttributesSchema());
 }
 
 void GlobalHotkey::initElement(DomElement*parent, wxArrayString*attributesNames) {
@@ -1404,30 +1512,38 @@ void GlobalHotkey::destroyElement() {
     getGui()->getToolWindow()->UnregisterHotKey(hotkeyId);
 }
 
-bool GlobalHotkey::handleChangedAttribute(const wxString&attributeName, TagAttribute&oldValue, TagAttribute&newValue){
-    if (attributeName=="onHotkey") {
-        registerEvent(wxEVT_HOTKEY, attributeName, [this]() {
-            getGui()->getToolWindow()->Bind(wxEVT_HOTKEY, &GlobalHotkey::onHotkey, this, hotkeyId);
-        }, [this](){
-            getGui()->getToolWindow()->Unbind(wxEVT_HOTKEY, &GlobalHotkey::onHotkey, this, hotkeyId);
-        });
-        return true;
+bool GlobalHotkey::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    const wxString&attributeName=atomName(attribute.name);
+    switch(attribute.handlerId) {
+        case GLOBAL_HOTKEY_ON_HOTKEY: {
+            registerEvent(wxEVT_HOTKEY, attributeName, [this]() {
+                getGui()->getToolWindow()->Bind(wxEVT_HOTKEY, &GlobalHotkey::onHotkey, this, hotkeyId);
+            }, [this](){
+                getGui()->getToolWindow()->Unbind(wxEVT_HOTKEY, &GlobalHotkey::onHotkey, this, hotkeyId);
+            });
+            return true;
+        }
     }
-    return DomElement::handleChangedAttribute(attributeName, oldValue, newValue);
+    return DomElement::handleChangedAttribute(attribute, oldValue, newValue);
 }
 
 void GlobalHotkey::onHotkey(wxKeyEvent&e){
-    getEngine()->execFunctionFromAttributeBuilder(getComputedAttributeWithoutDynamic("onHotkey")).exec(0, [](bool status, ValuesListReader *results, wxString &errorMessage){});
+    getEngine()->runEventHandler(this, getComputedAttributeWithoutDynamic("onHotkey"));
 }
 
 //------------ Tree
+static constexpr AttributeDeclaration treeAttributes[]={
+    {"rowLines", true, 0},
+    {"multipleSelection", true, 0},
+};
+
+const AttributesSchema*Tree::getAttributesSchema() {
+    static AttributesSchema schema(Control::getAttributesSchema(), treeAttributes);
+    return &schema;
+}
+
 Tree::Tree() {
-    if(allowedAttributes==NULL) {
-        allowedAttributes=createAndFillStringsMap({"rowLines", "multipleSelection"});
-        recreationRequiredAttributes = createAndFillStringsMap({"rowLines", "multipleSelection"});
-    }
-    addAllowedAttributeNamesMap(allowedAttributes);
-    addRecreationAttributeNamesMap(recreationRequiredAttributes);
+    setAttributesSchema(getAttributesSchema());
     setChildrenAllowed(true);
     setInitChildrenBeforeTag(true);
 }
@@ -1457,8 +1573,8 @@ void Tree::initElement(DomElement*parent,wxArrayString*attributesNames) {
     }
 }
 
-bool Tree::handleChangedAttribute(const wxString&attributeName, TagAttribute&oldValue, TagAttribute&newValue) {
-    return Control::handleChangedAttribute(attributeName, oldValue, newValue);
+bool Tree::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+    return Control::handleChangedAttribute(attribute, oldValue, newValue);
 }
 
 void Tree::onChildAdded(DomElement*child) {
@@ -1531,13 +1647,20 @@ void Tree::onNodeRemoved(TreeNode*node) {
 // TreeNode Implementation
 //==============================================================================
 
+static constexpr AttributeDeclaration treeNodeAttributes[]={
+    {"text", false, TREE_NODE_TEXT},
+    {"bold", false, TREE_NODE_BOLD},
+    {"fgcolor", false, TREE_NODE_FGCOLOR},
+    {"bgcolor", false, TREE_NODE_BGCOLOR},
+};
+
+const AttributesSchema*TreeNode::getAttributesSchema() {
+    static AttributesSchema schema(LxwDomElement::getAttributesSchema(), treeNodeAttributes);
+    return &schema;
+}
+
 TreeNode::TreeNode() {
-    if (allowedAttributes == NULL) {
-        allowedAttributes=createAndFillStringsMap({"text", "bold", "fgcolor", "bgcolor"});
-        recreationRequiredAttributes = createAndFillStringsMap({});
-    }
-    addAllowedAttributeNamesMap(allowedAttributes);
-    addRecreationAttributeNamesMap(recreationRequiredAttributes);
+    setAttributesSchema(getAttributesSchema());
     setChildrenAllowed(true);
 }
 
@@ -1550,28 +1673,31 @@ void TreeNode::initElement(DomElement*parent, wxArrayString*attributesNames) {
     }
 }
 
-bool TreeNode::handleChangedAttribute(const wxString&name, TagAttribute&oldValue, TagAttribute&newValue) {
+bool TreeNode::handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
     if (owner) {
         wxTreeCtrl* tree = (wxTreeCtrl*)owner->getWindow();
         if (tree && itemId.IsOk()) {
-            if (name == "text") {
-                tree->SetItemText(itemId, newValue.defaultIfNull(wxString("")));
-                return true;
-            } else if (name == "bold") {
-                tree->SetItemBold(itemId, newValue.defaultIfNull(false));
-                return true;
-            } else if (name == "fgcolor") {
-                wxColour color = parseAttributeColor(newValue.defaultIfNull(wxString("black")), "fgcolor");
-                tree->SetItemTextColour(itemId, color);
-                return true;
-            } else if (name == "bgcolor") {
-                wxColour color = parseAttributeColor(newValue.defaultIfNull(wxString("white")), "bgcolor");
-                tree->SetItemBackgroundColour(itemId, color);
-                return true;
+            switch (attribute.handlerId) {
+                case TREE_NODE_TEXT:
+                    tree->SetItemText(itemId, newValue.defaultIfNull(wxString("")));
+                    return true;
+                case TREE_NODE_BOLD:
+                    tree->SetItemBold(itemId, newValue.defaultIfNull(false));
+                    return true;
+                case TREE_NODE_FGCOLOR: {
+                    wxColour color = parseAttributeColor(newValue.defaultIfNull(wxString("black")), "fgcolor");
+                    tree->SetItemTextColour(itemId, color);
+                    return true;
+                }
+                case TREE_NODE_BGCOLOR: {
+                    wxColour color = parseAttributeColor(newValue.defaultIfNull(wxString("white")), "bgcolor");
+                    tree->SetItemBackgroundColour(itemId, color);
+                    return true;
+                }
             }
         }
     }
-    return LxwDomElement::handleChangedAttribute(name, oldValue, newValue);
+    return LxwDomElement::handleChangedAttribute(attribute, oldValue, newValue);
 }
 
 void TreeNode::notifyOwnerAboutChange(wxString changeType) {
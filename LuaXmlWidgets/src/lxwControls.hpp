@@ -10,6 +10,66 @@
 #include <wx/hyperlink.h>
 #include <wx/treectrl.h>
 
+///ids of attribute handlers used in declaration tables of controls, see lxe::DomElementAttributeHandler
+enum LxwAttributeHandler {
+    ABSTRACT_WINDOW_CURSOR=lxe::DOM_ELEMENT_HANDLERS_END,
+    ABSTRACT_WINDOW_BGCOLOR,
+    ABSTRACT_WINDOW_FGCOLOR,
+    ABSTRACT_WINDOW_VISIBLE,
+    ABSTRACT_WINDOW_FOCUSABLE,
+    ABSTRACT_WINDOW_WIDTH,
+    ABSTRACT_WINDOW_HEIGHT,
+    ABSTRACT_WINDOW_X,
+    ABSTRACT_WINDOW_Y,
+    ABSTRACT_WINDOW_FREEZE,
+    ABSTRACT_WINDOW_LABEL,
+    ABSTRACT_WINDOW_TOOLTIP,
+    ABSTRACT_WINDOW_ENABLE,
+    ABSTRACT_WINDOW_ALLOW_DROP_FILES,
+    ABSTRACT_WINDOW_HELPTEXT,
+    ABSTRACT_WINDOW_CARETX,
+    ABSTRACT_WINDOW_CARETY,
+    ABSTRACT_WINDOW_CARETW,
+    ABSTRACT_WINDOW_CARETH,
+    ABSTRACT_WINDOW_CARETVISIBLE,
+    ABSTRACT_WINDOW_FONT,
+    ABSTRACT_WINDOW_LAYOUT_CONTAINER,
+    ABSTRACT_WINDOW_LAYOUT,
+    WINDOW_TRANSPARENT,
+    BUTTON_ON_CLICK,
+    BUTTON_TEXT,
+    BUTTON_NOTE,
+    BUTTON_ICON,
+    BUTTON_ICON_HOVER,
+    BUTTON_ICON_DISABLED,
+    BUTTON_ICON_PRESSED,
+    BUTTON_TOGGLED,
+    CHECK_BOX_ON_CHANGE,
+    CHECK_BOX_TEXT,
+    CHECK_BOX_CHECKED,
+    CHECK_BOX_VALUE,
+    LABEL_TEXT,
+    LABEL_HTMLMARKUP,
+    TEXT_INPUT_TEXT,
+    DROP_DOWN_ON_CHANGE,
+    DROP_DOWN_SELECTED_INDEX,
+    OPTION_CONTENT,
+    PROGRESS_VALUE,
+    PROGRESS_MAX,
+    PROGRESS_INDETERMINATE,
+    HYPERLINK_HREF,
+    HYPERLINK_VISITED,
+    HYPERLINK_VISITED_COLOR,
+    HYPERLINK_NORMAL_COLOR,
+    HYPERLINK_HOVER_COLOR,
+    HYPERLINK_ON_LINK,
+    GLOBAL_HOTKEY_ON_HOTKEY,
+    TREE_NODE_TEXT,
+    TREE_NODE_BOLD,
+    TREE_NODE_FGCOLOR,
+    TREE_NODE_BGCOLOR,
+};
+
 class LxwDomElement: public virtual lxe::DomElement {
     lxwGui*gui;
 public:
@@ -20,17 +80,17 @@ public:
 };
 
 class App: public virtual LxwDomElement {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
 public:
     App();
+    static const lxe::AttributesSchema*getAttributesSchema();
 };
 
 class AbstractWindow: public virtual LxwDomElement {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
+    enum {GEOMETRY_X=1, GEOMETRY_Y=2, GEOMETRY_WIDTH=4, GEOMETRY_HEIGHT=8};
     wxWindow *window;
     bool tabTraversal;
+    ///geometry attributes changed but not applied yet, inside attribute batch they are applied with single call
+    int pendingGeometry = 0;
     
     // Layout engine integration
     LayoutEngine::LayoutEntity* layoutEntity = nullptr;
@@ -38,11 +98,14 @@ class AbstractWindow: public virtual LxwDomElement {
     LayoutEngine::EntityConstraints* layoutConstraints = nullptr;  // Child's own constraints
     bool isLayoutContainer = false;
     bool layoutDirty = false;  // Flag to track when layout needs recalculation
+    bool layoutScheduled = false;  // Deferred layout is queued, further invalidations reuse it
     
 protected:
     wxBorder getBorder();
+    virtual void onAttributeBatchApplied() override;
 public:
     AbstractWindow();
+    static const lxe::AttributesSchema*getAttributesSchema();
     virtual int getComputedWindowStyle();
     virtual void repaint()override {this->window->Refresh();}
     virtual void onWillAddToParent(DomElement*parentElement) override;
@@ -54,7 +117,7 @@ public:
         initLayoutEntity();
     }
     wxWindow* getWindow()const{return window;}
-    virtual bool handleChangedAttribute(const wxString&name, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
+    virtual bool handleChangedAttribute(const lxe::AttributeSchemaEntry&attribute, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
     virtual bool getDynamicAttributeValue(const wxString&attributeName, lxe::TagAttribute&tagAttribute)override;
     void ensureCaretPresent();
     
@@ -89,89 +152,83 @@ public:
 private:
     void initLayoutEntity();
     void destroyLayoutResources();
+    void applyPendingGeometry();
     bool parseLayoutContainer(const wxString& config);
     void rebuildLayoutFromChildren();  // Rebuilds layout from current children
 };
 
 class Control: public virtual AbstractWindow {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
 protected:
 public:
     Control();
-    virtual bool handleChangedAttribute(const wxString&name, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
+    static const lxe::AttributesSchema*getAttributesSchema();
+    virtual bool handleChangedAttribute(const lxe::AttributeSchemaEntry&attribute, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
     virtual bool getDynamicAttributeValue(const wxString&attributeName, lxe::TagAttribute&tagAttribute)override;
 };
 
 
 class Window: public virtual AbstractWindow {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
 public:
     Window();
+    static const lxe::AttributesSchema*getAttributesSchema();
     virtual void initElement(DomElement*parent,wxArrayString*attributesNames)override;
-    virtual bool handleChangedAttribute(const wxString&name, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
+    virtual bool handleChangedAttribute(const lxe::AttributeSchemaEntry&attribute, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
     virtual bool getDynamicAttributeValue(const wxString&attributeName, lxe::TagAttribute&tagAttribute)override;
     virtual void onWillAddToParent(lxe::DomElement*parentElement) override;
 };
 
 
 class Button: public virtual Control {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
     ImageHolder imageHolder;
     ImageHolder disabledImageHolder;
     ImageHolder pressedImageHolder;
     ImageHolder hoverImageHolder;
 public:
     Button();
+    static const lxe::AttributesSchema*getAttributesSchema();
     virtual void initElement(DomElement*parent,wxArrayString*attributesNames)override;
-    virtual bool handleChangedAttribute(const wxString&name, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
+    virtual bool handleChangedAttribute(const lxe::AttributeSchemaEntry&attribute, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
     virtual bool getDynamicAttributeValue(const wxString&attributeName, lxe::TagAttribute&tagAttribute)override;
     void onClickEventHandler(wxCommandEvent&e);
 };
 
 class CheckBox: public virtual Control {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
 public:
     CheckBox();
+    static const lxe::AttributesSchema*getAttributesSchema();
     virtual void initElement(DomElement*parent,wxArrayString*attributesNames)override;
-    virtual bool handleChangedAttribute(const wxString&name, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
+    virtual bool handleChangedAttribute(const lxe::AttributeSchemaEntry&attribute, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
     virtual bool getDynamicAttributeValue(const wxString&attributeName, lxe::TagAttribute&tagAttribute)override;
     void onChangeEventHandler(wxCommandEvent&e);
 };
 
 
 class Label: public virtual Control {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
     bool htmlMarkup=false;
 public:
     Label();
+    static const lxe::AttributesSchema*getAttributesSchema();
     virtual void initElement(DomElement*parent,wxArrayString*attributesNames)override;
-    virtual bool handleChangedAttribute(const wxString&name, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
+    virtual bool handleChangedAttribute(const lxe::AttributeSchemaEntry&attribute, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
     virtual bool getDynamicAttributeValue(const wxString&attributeName, lxe::TagAttribute&tagAttribute)override;
 };
 
 
 class TextInput: public virtual Control {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
 public:
     TextInput();
+    static const lxe::AttributesSchema*getAttributesSchema();
     virtual void initElement(DomElement*parent,wxArrayString*attributesNames)override;
-    virtual bool handleChangedAttribute(const wxString&name, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
+    virtual bool handleChangedAttribute(const lxe::AttributeSchemaEntry&attribute, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
     virtual bool getDynamicAttributeValue(const wxString&attributeName, lxe::TagAttribute&tagAttribute)override;
 };
 
 class DropDown: public virtual Control {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
 public:
     DropDown();
+    static const lxe::AttributesSchema*getAttributesSchema();
     virtual void initElement(lxe::DomElement*parent,wxArrayString*attributesNames)override;
-    virtual bool handleChangedAttribute(const wxString&name, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
+    virtual bool handleChangedAttribute(const lxe::AttributeSchemaEntry&attribute, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
     virtual bool getDynamicAttributeValue(const wxString&attributeName, lxe::TagAttribute&tagAttribute)override;
     virtual void onChildAdded(lxe::DomElement*child) override;
     virtual void onChildRemoving(lxe::DomElement*child) override;
@@ -180,60 +237,55 @@ public:
 };
 
 class Option: public virtual LxwDomElement {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
 public:
     Option();
+    static const lxe::AttributesSchema*getAttributesSchema();
     virtual void initElement(lxe::DomElement*parent, wxArrayString*attributesNames)override;
-    virtual bool handleChangedAttribute(const wxString&name, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
+    virtual bool handleChangedAttribute(const lxe::AttributeSchemaEntry&attribute, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
     virtual bool getDynamicAttributeValue(const wxString&attributeName, lxe::TagAttribute&tagAttribute)override;
 };
 
 class Progress: public virtual Control {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
     int value;
     bool indeterminate;
 public:
     Progress();
+    static const lxe::AttributesSchema*getAttributesSchema();
     virtual void initElement(DomElement*parent,wxArrayString*attributesNames)override;
-    virtual bool handleChangedAttribute(const wxString&name, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
+    virtual bool handleChangedAttribute(const lxe::AttributeSchemaEntry&attribute, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
     virtual bool getDynamicAttributeValue(const wxString&attributeName, lxe::TagAttribute&tagAttribute)override;
 };
 
 class Hyperlink: public virtual Control {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
     
 public:
     Hyperlink();
+    static const lxe::AttributesSchema*getAttributesSchema();
     virtual void initElement(lxe::DomElement*parent, wxArrayString*attributesNames)override;
-    virtual bool handleChangedAttribute(const wxString&name, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
+    virtual bool handleChangedAttribute(const lxe::AttributeSchemaEntry&attribute, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
     virtual bool getDynamicAttributeValue(const wxString&attributeName, lxe::TagAttribute&tagAttribute)override;
     void onHyperLinkEventHandler(wxHyperlinkEvent&e);
 };
 
 class GlobalHotkey: public virtual LxwDomElement {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
     int hotkeyId;
 public:
     GlobalHotkey();
+    static const lxe::AttributesSchema*getAttributesSchema();
     virtual void initElement(lxe::DomElement*parent, wxArrayString*attributesNames) override;
     virtual void destroyElement() override;
-    virtual bool handleChangedAttribute(const wxString&name, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue) override;
+    virtual bool handleChangedAttribute(const lxe::AttributeSchemaEntry&attribute, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue) override;
     void onHotkey(wxKeyEvent&e);
 };
 
 class TreeNode;
 class Tree: public virtual Control {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
     wxTreeItemId rootItemId;
 public:
     Tree();
+    static const lxe::AttributesSchema*getAttributesSchema();
     virtual void initElement(lxe::DomElement*parent, wxArrayString*attributesNames)override;
-    virtual bool handleChangedAttribute(const wxString&name, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
+    virtual bool handleChangedAttribute(const lxe::AttributeSchemaEntry&attribute, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
     virtual void onChildAdded(lxe::DomElement*child) override;
     virtual void onChildRemoving(lxe::DomElement*child) override;
     virtual void onChildChanged(lxe::DomElement*child, wxString changeType) override;
@@ -242,14 +294,13 @@ public:
 };
 
 class TreeNode: public virtual LxwDomElement {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
     Tree*owner=NULL;
     wxTreeItemId itemId;
 public:
     TreeNode();
+    static const lxe::AttributesSchema*getAttributesSchema();
     virtual void initElement(lxe::DomElement*parent, wxArrayString*attributesNames)override;
-    virtual bool handleChangedAttribute(const wxString&name, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
+    virtual bool handleChangedAttribute(const lxe::AttributeSchemaEntry&attribute, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
     void setOwner(Tree*owner){this->owner=owner;}
     Tree*getOwner(){return owner;}
     void notifyOwnerAboutChange(wxString changeType);
@@ -260,12 +311,11 @@ public:
 };
 
 class Panel: public virtual AbstractWindow {
-    static String2BoolHashMap*allowedAttributes;
-    static String2BoolHashMap*recreationRequiredAttributes;
 public:
     Panel();
+    static const lxe::AttributesSchema*getAttributesSchema();
     virtual void initElement(lxe::DomElement*parent,wxArrayString*attributesNames)override;
-    virtual bool handleChangedAttribute(const wxString&name, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
+    virtual bool handleChangedAttribute(const lxe::AttributeSchemaEntry&attribute, lxe::TagAttribute&oldValue, lxe::TagAttribute&newValue)override;
     virtual bool getDynamicAttributeValue(const wxString&attributeName, lxe::TagAttribute&tagAttribute)override;
 };
 
@@ -10,6 +10,20 @@ lxwGui::lxwGui() {
     engine->getLua()->evalExpression("require \"resource://lxw/lxw.lua\"", [](bool state, wxString&result){
         if(!state)throw RuntimeException("Error while load lxw.lua module "+result);
     });
+    //recreations of widgets requested by scripts are coalesced until the event loop is idle
+    engine->setIdleScheduler([](std::function<void()>callback){
+        wxTheApp->CallAfter(callback);
+    });
+    //timers awaited by event handlers run on the event loop instead of sleeping worker threads
+    engine->getAsyncTasks().setTimerScheduler([](int milliseconds, std::function<void()>callback){
+        wxTimer*timer=new wxTimer();
+        timer->Bind(wxEVT_TIMER, [timer, callback](wxTimerEvent&event){
+            callback();
+            //timer must not be deleted inside its own event
+            wxTheApp->CallAfter([timer](){delete timer;});
+        });
+        timer->StartOnce(milliseconds);
+    });
     toolWindow = new wxDialog(NULL, -1, "", wxPoint(1,1), wxSize(1,1), 0);
     engine->registerTagFactory("App", [this](){return initDomElement(new App());});
     engine->registerTagFactory("Window", [this](){return initDomElement(new Window());});
@@ -37,11 +51,12 @@ void lxwGui::load(wxString filePath) {
         throw std::runtime_error(wxString::Format("File not found '%s'", filePath).ToUTF8().data());
     }
 
-    wxFile sourceFile=wxFile(fileName.GetAbsolutePath());
-    
-    wxString source;
-    sourceFile.ReadAll(&source);
-    load(source, fileName.GetAbsolutePath());
+    //file is mapped, tokenizer works directly over its UTF-8 bytes and compiled .lxmlc is read without any copy
+    MappedFile sourceFile;
+    if(!sourceFile.open(fileName.GetAbsolutePath())) {
+        throw std::runtime_error(wxString::Format("Cannot read file '%s'", filePath).ToUTF8().data());
+    }
+    engine->run(sourceFile.getData(), sourceFile.getLength(), fileName.GetAbsolutePath());
 }
 
 void lxwGui::load(wxString content, wxString filePath) {
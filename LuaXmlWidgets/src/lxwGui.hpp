@@ -18,5 +18,6 @@ public:
     void load(wxString filePath);
     void load(wxString content, wxString filePath);
     wxDialog*getToolWindow() { return toolWindow; };
+    lxe::Engine*getEngine() { return engine; };
 };
 #endif /* lxwGui_h */
@@ -29,6 +29,57 @@ void ImageHolder::load(wxString&path){
     }
 }
 
+ResourcesCache&ResourcesCache::instance() {
+    //never deleted, wx objects cannot be destroyed after wxWidgets shut down at exit
+    static ResourcesCache*cache=new ResourcesCache();
+    return *cache;
+}
+
+wxColour ResourcesCache::getColor(const wxString&colorString, const wxString&attributeName) {
+    return colors.get(colorString, [&colorString, &attributeName]() {
+        wxColour color;
+        color.Set(colorString);
+        if(!color.IsOk()){
+            throw RuntimeException(wxString::Format("Wrong color value in %s attribute '%s'", attributeName, colorString));
+        }
+        return color;
+    });
+}
+
+wxFont ResourcesCache::getFont(const wxString&fontString) {
+    return fonts.get(fontString, [&fontString]() {
+        wxFont font;
+        if (!font.SetNativeFontInfoUserDesc(fontString)) {
+            throw RuntimeException(wxString::Format("Cannot parse font string '%s'", fontString));
+        }
+        return font;
+    });
+}
+
+wxCursor ResourcesCache::getCursor(const wxString&cursorName) {
+    return cursors.get(cursorName, [&cursorName]() {
+        int cursorIndex=selector(cursorName,
+                                 {"default",        "wait",       "arrow",       "rightarrow",        "cross",       "hand",       "question",              "sizenesw",        "sizens",       "sizenwse",       "sizewe",       "sizing",       "ibeam"},
+                                 { wxCURSOR_DEFAULT, wxCURSOR_WAIT,wxCURSOR_ARROW,wxCURSOR_RIGHT_ARROW,wxCURSOR_CROSS,wxCURSOR_HAND,wxCURSOR_QUESTION_ARROW, wxCURSOR_SIZENESW, wxCURSOR_SIZENS,wxCURSOR_SIZENWSE,wxCURSOR_SIZEWE,wxCURSOR_SIZING,wxCURSOR_IBEAM});
+        if(cursorIndex==-1) {
+            throw RuntimeException(wxString::Format("Unknown cursor '%s'", cursorName));
+        }
+        return wxCursor((wxStockCursor)cursorIndex);
+    });
+}
+
+void ResourcesCache::setLimit(size_t limit) {
+    colors.setLimit(limit);
+    fonts.setLimit(limit);
+    cursors.setLimit(limit);
+}
+
+void ResourcesCache::clear() {
+    colors.clear();
+    fonts.clear();
+    cursors.clear();
+}
+
 std::map<std::string, int> StringToWxKeyMap = {
     {"esc", WXK_ESCAPE},
     {"f1", WXK_F1},
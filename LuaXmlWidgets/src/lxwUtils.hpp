@@ -29,6 +29,32 @@ public:
     void load(wxString&path);
 };
 
+/**
+ Process wide cache of GUI resources parsed from attribute strings, so elements styled with the same
+ string share one parsed object. Each kind is limited and evicts least recently used strings, so values
+ generated by scripts do not grow it. Results are copies, wx objects share their data by reference count
+ */
+class ResourcesCache {
+    LruCache<wxString, wxColour>colors;
+    LruCache<wxString, wxFont>fonts;
+    LruCache<wxString, wxCursor>cursors;
+public:
+    ResourcesCache():colors(256), fonts(64), cursors(32){}
+    static ResourcesCache&instance();
+    ///throws RuntimeException if string is not a color
+    wxColour getColor(const wxString&colorString, const wxString&attributeName);
+    ///throws RuntimeException if string is not a font description
+    wxFont getFont(const wxString&fontString);
+    ///throws RuntimeException if name is not one of stock cursors
+    wxCursor getCursor(const wxString&cursorName);
+    ///limit of entries for each kind of resource
+    void setLimit(size_t limit);
+    void clear();
+    long long getHits(){return colors.getHits()+fonts.getHits()+cursors.getHits();}
+    long long getMisses(){return colors.getMisses()+fonts.getMisses()+cursors.getMisses();}
+    int getSize(){return (int)(colors.getSize()+fonts.getSize()+cursors.getSize());}
+};
+
 class Hotkey {
 public:
     int key;
@@ -5,8 +5,16 @@
 #ifndef LUA_XML_TEST
 
 class LuaXmlWidgetsApp : public wxApp {
+private:
+    ///set by -c, application exits with result of compilation without running main loop
+    bool compileOnly=false;
+    int compileExitCode=0;
 public:
     virtual bool OnInit();
+    virtual int OnRun() {
+        if(compileOnly) return compileExitCode;
+        return wxApp::OnRun();
+    }
     void testCreateGui();
     virtual bool OnExceptionInMainLoop() {
         try {
@@ -44,6 +52,8 @@ class CommandLineArgs{
 public:
     wxString*sourceDirectory=NULL;
     wxString*mainFilePath=NULL;
+    wxString*compileOutputPath=NULL;
+    wxString*scriptCacheDirectory=NULL;
     bool printHelp=false;
 };
 
@@ -71,12 +81,48 @@ CommandLineArgs parseCommandLineArgs(wxArrayString args){
             result.mainFilePath=new wxString(args[i]);
             continue;
         }
+        if(args[i]=="-c" || args[i]=="--compile") {
+            expectArg(i+1, "-c/--compile expects path of the output .lxmlc file");
+            i++;
+            result.compileOutputPath=new wxString(normalizeFilePath(args[i]));
+            continue;
+        }
+        if(args[i]=="-s" || args[i]=="--script-cache") {
+            expectArg(i+1, "-s/--script-cache expects path to existing directory for compiled scripts");
+            i++;
+            result.scriptCacheDirectory=new wxString(normalizeFilePath(args[i]));
+            continue;
+        }
         throw wxString::Format("Unknown arg %s\n", args[i]);
     }
     return result;
 }
 
 
+bool compileMainFile(wxString sourcePath, wxString outputPath) {
+    MappedFile sourceFile;
+    if(!sourceFile.open(sourcePath)) {
+        wxPrintf("Cannot read file '%s'\n", sourcePath);
+        return false;
+    }
+    try {
+        std::string compiled = lxe::Engine::compileLxml(sourceFile.getData(), sourceFile.getLength(), sourcePath);
+        wxFile outputFile;
+        if(!outputFile.Create(outputPath, true) || !outputFile.Write(compiled.data(), compiled.size())) {
+            wxPrintf("Cannot write file '%s'\n", outputPath);
+            return false;
+        }
+        wxPrintf("Compiled '%s' to '%s'\n", sourcePath, outputPath);
+    } catch(lxe::ParseException&ex) {
+        wxPrintf("Compilation error line:%d column:%d message: %s\n", ex.getLine(), ex.getColumn(), ex.getErrorMessage());
+        return false;
+    } catch(RuntimeException&ex) {
+        wxPrintf("Compilation error message: %s\n", ex.getErrorMessage());
+        return false;
+    }
+    return true;
+}
+
 bool LuaXmlWidgetsApp::OnInit() {
     //testCreateGui();
     CommandLineArgs args;
@@ -96,6 +142,8 @@ Options:
     -h, --help          Print this help message.
     -d, --directory     Specify the source folder where the source LXML files are located. Default is "." - the current directory.
     -f, --main-file     Specify the main .lxml file relative path inside the working folder. Extension ".lxml" is optional. Default is "main".
+    -c, --compile       Compile the main file to the binary .lxmlc file with precompiled scripts and exit. Compiled file can be passed to -f instead of the source.
+    -s, --script-cache  Specify existing directory where compiled scripts are kept between launches. Scripts are compiled again only when their text changes.
 
 Description:
     LuaXmlWidgets reads LXML files, which are similar to HTML but in XML format, and creates windows, buttons, text fields, and other GUI widgets. The application supports the <script> tag with embedded Lua scripts, allowing dynamic and interactive interfaces using native components based on the WxWidgets library.
@@ -141,12 +189,18 @@ Description:
         wxPrintf("Main file '%s' does not exists in source directory '%s'\n", *args.mainFilePath, *args.sourceDirectory);
         return false;
     }
-    wxFile sourceFile = wxFile(mainFilePath.GetAbsolutePath());
-    wxString source;
-    sourceFile.ReadAll(&source);
+    if(args.compileOutputPath!=NULL) {
+        //false from OnInit always ends with error code, so status is returned from OnRun
+        compileOnly=true;
+        compileExitCode=compileMainFile(mainFilePath.GetAbsolutePath(), *args.compileOutputPath)?0:1;
+        return true;
+    }
     try {
         lxwGui*gui = new lxwGui();
-        gui->load(source, *args.mainFilePath);
+        if(args.scriptCacheDirectory!=NULL) {
+            gui->getEngine()->setScriptCacheDirectory(*args.scriptCacheDirectory);
+        }
+        gui->load(mainFilePath.GetAbsolutePath());
     } catch(std::runtime_error&err) {
         wxPrintf("Error running the application: %s\n", err.what());
         return false;
@@ -1928,7 +1928,8 @@ main(int argc, char** argv)
     }
 
     int total_test_set_size=main_test_set_size+tests_in_modules_size;
-    acutest_list_=(struct acutest_test_*)calloc(total_test_set_size,sizeof(acutest_test_));
+    //zeroed entry after the last test terminates the list
+    acutest_list_=(struct acutest_test_*)calloc(total_test_set_size+1,sizeof(acutest_test_));
     index=0;
     for(;index<main_test_set_size;index++){
         acutest_list_[index].name=acutest_list_main_test_set[index].name;
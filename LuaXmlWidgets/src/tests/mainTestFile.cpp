@@ -7,11 +7,24 @@
 IMPORT_ACUTEST_MODULE(lua_module);
 IMPORT_ACUTEST_MODULE(lxe_module);
 IMPORT_ACUTEST_MODULE(layout_engine_module);
+IMPORT_ACUTEST_MODULE(lxw_module);
+
+#ifdef LUA_XML_BENCHMARKS
+IMPORT_ACUTEST_MODULE(benchmark_module);
 
 ACUTEST_MODULES(ACUTEST_MODULE(lua_module),
                 ACUTEST_MODULE(lxe_module),
-                ACUTEST_MODULE(layout_engine_module)
+                ACUTEST_MODULE(layout_engine_module),
+                ACUTEST_MODULE(lxw_module),
+                ACUTEST_MODULE(benchmark_module)
 )
+#else
+ACUTEST_MODULES(ACUTEST_MODULE(lua_module),
+                ACUTEST_MODULE(lxe_module),
+                ACUTEST_MODULE(layout_engine_module),
+                ACUTEST_MODULE(lxw_module)
+)
+#endif
 
 TEST_LIST = {0};
 #endif
@@ -0,0 +1,245 @@
+//
+//  testBenchmarks.cpp
+//  LuaXmlWidgets
+//
+
+#include "lxw.hpp"
+
+//opt-in, benchmarks are slow and their timings are not checked
+#if defined(LUA_XML_TEST) && defined(LUA_XML_BENCHMARKS)
+
+#define TEST_NO_MAIN
+#include "accutestWrapper.hpp"
+#include <chrono>
+
+using namespace lxe;
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string createScriptBody(size_t size) {
+    std::string body;
+    const char*line = "    local value = someTable.field * 2 + other(\"text\", 'x') -- comment\n";
+    while (body.size() < size) {
+        body.append(line);
+    }
+    return body;
+}
+
+void benchmarkScanDelimiters() {
+    std::string body = createScriptBody(1024 * 1024);
+    const int iterations = 20;
+    const char*found = NULL;
+    const char*scalarFound = NULL;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        scalarFound = scanDelimitersScalar(body.data(), body.data() + body.size(), "<");
+    }
+    double scalarMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        found = scanDelimiters(body.data(), body.data() + body.size(), "<");
+    }
+    double vectorizedMs = elapsedMs(start);
+
+    TEST_EQUALS_BOOL(found == scalarFound, true);
+    printf("\n  1MB script scan: scalar %.3fms, vectorized %.3fms\n", scalarMs / iterations, vectorizedMs / iterations);
+}
+
+void benchmarkParseScriptTag() {
+    std::string source = "<Application><Script>\n" + createScriptBody(1024 * 1024) + "</Script></Application>";
+    auto start = std::chrono::steady_clock::now();
+    TagsParser parser(source.data(), source.size(), "benchmark");
+    parser.addTagWithRawTextContent("Script");
+    TagsDocument*document = parser.parseTags();
+    double parseMs = elapsedMs(start);
+    TEST_EQUALS_INT((int)document->getTags().size(), 1);
+    delete document;
+    printf("\n  1MB script tag parse: %.3fms\n", parseMs);
+}
+
+void benchmarkTagAttribute() {
+    const int iterations = 1000000;
+    AttributeDeclaration declarations[] = {{"width", false, 0}, {"text", false, 0}};
+    AttributesSchema schema(NULL, declarations);
+    Atom width = internAtom(wxString("width"));
+    Atom text = internAtom(wxString("text"));
+    AttributesStorage storage;
+    storage.setSchema(&schema);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        TagAttribute value;
+        value.setInt(i);
+        storage.setAttribute(width, value, false);
+        TagAttribute textValue;
+        textValue.setString("some label text");
+        storage.setAttribute(text, textValue, false);
+    }
+    double setMs = elapsedMs(start);
+
+    long long sum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sum += storage.getAttribute(width).getInt();
+        sum += storage.getAttribute(text).getType();
+    }
+    double getMs = elapsedMs(start);
+
+    int equalsCount = 0;
+    TagAttribute left = storage.getAttribute(text);
+    TagAttribute right = storage.getAttribute(text);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        if (left.equals(right)) equalsCount++;
+    }
+    double equalsMs = elapsedMs(start);
+
+    TEST_EQUALS_INT(equalsCount, iterations);
+    TEST_EQUALS_BOOL(sum > 0, true);
+    printf("\n  1M attribute ops: set %.3fms, get %.3fms, equals %.3fms\n", setMs, getMs, equalsMs);
+}
+
+static constexpr AttributeDeclaration benchmarkElementAttributes[]={
+    {"cursor", false, DOM_ELEMENT_HANDLERS_END + 0},
+    {"bgcolor", false, DOM_ELEMENT_HANDLERS_END + 1},
+    {"fgcolor", false, DOM_ELEMENT_HANDLERS_END + 2},
+    {"visible", false, DOM_ELEMENT_HANDLERS_END + 3},
+    {"focusable", false, DOM_ELEMENT_HANDLERS_END + 4},
+    {"width", false, DOM_ELEMENT_HANDLERS_END + 5},
+    {"height", false, DOM_ELEMENT_HANDLERS_END + 6},
+    {"x", false, DOM_ELEMENT_HANDLERS_END + 7},
+    {"y", false, DOM_ELEMENT_HANDLERS_END + 8},
+    {"freeze", false, DOM_ELEMENT_HANDLERS_END + 9},
+    {"label", false, DOM_ELEMENT_HANDLERS_END + 10},
+    {"tooltip", false, DOM_ELEMENT_HANDLERS_END + 11},
+    {"enable", false, DOM_ELEMENT_HANDLERS_END + 12},
+    {"allowDropFiles", false, DOM_ELEMENT_HANDLERS_END + 13},
+    {"helptext", false, DOM_ELEMENT_HANDLERS_END + 14},
+    {"caretx", false, DOM_ELEMENT_HANDLERS_END + 15},
+    {"carety", false, DOM_ELEMENT_HANDLERS_END + 16},
+    {"caretw", false, DOM_ELEMENT_HANDLERS_END + 17},
+    {"careth", false, DOM_ELEMENT_HANDLERS_END + 18},
+    {"caretvisible", false, DOM_ELEMENT_HANDLERS_END + 19},
+    {"font", false, DOM_ELEMENT_HANDLERS_END + 20},
+    {"layoutContainer", false, DOM_ELEMENT_HANDLERS_END + 21},
+    {"layout", false, DOM_ELEMENT_HANDLERS_END + 22},
+    {"value", false, DOM_ELEMENT_HANDLERS_END + 23},
+};
+
+///element with as many handled attributes as AbstractWindow, benchmark sets the last one
+class BenchmarkElement: public virtual DomElement {
+public:
+    long long handled=0;
+    static const AttributesSchema*getAttributesSchema() {
+        static AttributesSchema schema(DomElement::getAttributesSchema(), benchmarkElementAttributes);
+        return &schema;
+    }
+    BenchmarkElement() {
+        setAttributesSchema(getAttributesSchema());
+    }
+    bool handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue)override {
+        if(attribute.handlerId>=DOM_ELEMENT_HANDLERS_END) {
+            handled++;
+            return true;
+        }
+        return DomElement::handleChangedAttribute(attribute, oldValue, newValue);
+    }
+};
+
+void benchmarkSetAttributeFromLua() {
+    const int iterations = 200000;
+    Engine engine;
+    engine.registerTagFactory("Bench", [](){return new BenchmarkElement();});
+    const char*source = "<Bench id='bench' value='0'/>";
+    TagsParser parser(source, strlen(source), "benchmark");
+    DomElementsBuilder builder(&engine, NULL, true);
+    parser.parse(&builder);
+    BenchmarkElement*element = dynamic_cast<BenchmarkElement*>(builder.getCreatedElements()[0]);
+    element->handled = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    engine.getLua()->evalExpression(wxString::Format("local el=document:getElementById('bench') for i=1,%d do el:setAttribute('value', i) end", iterations));
+    double luaMs = elapsedMs(start);
+    TEST_EQUALS_INT((int)element->handled, iterations);
+
+    start = std::chrono::steady_clock::now();
+    engine.getLua()->evalExpression(wxString::Format("local el=document:getElementById('bench') for i=1,%d do el.value=-i end", iterations));
+    double fieldMs = elapsedMs(start);
+    TEST_EQUALS_INT((int)element->handled, iterations * 2);
+
+    Atom value = findAtom(wxString("value"));
+    start = std::chrono::steady_clock::now();
+    for (int i = 1; i <= iterations; i++) {
+        TagAttribute attribute;
+        attribute.setInt(i);
+        element->setAttribute(value, attribute);
+    }
+    double nativeMs = elapsedMs(start);
+    TEST_EQUALS_INT((int)element->handled, iterations * 3);
+    printf("\n  200K setAttribute: from Lua %.3fms, field from Lua %.3fms, native %.3fms\n", luaMs, fieldMs, nativeMs);
+}
+
+void benchmarkBuildDocument() {
+    const int elementsCount = 20000;
+    Engine engine;
+    engine.registerTagFactory("Bench", [](){return new BenchmarkElement();});
+    std::string source;
+    for (int i = 0; i < elementsCount; i++) {
+        source.append("<Bench value='1' x='2' tooltip='text'/>");
+    }
+    engine.getLua()->evalExpression("collectgarbage('collect') heapBefore=collectgarbage('count')");
+
+    auto start = std::chrono::steady_clock::now();
+    TagsParser parser(source.data(), source.size(), "benchmark");
+    DomElementsBuilder builder(&engine, NULL, false);
+    parser.parse(&builder);
+    double buildMs = elapsedMs(start);
+    TEST_EQUALS_INT((int)builder.getCreatedElements().size(), elementsCount);
+
+    engine.getLua()->evalExpression("collectgarbage('collect') heapGrowth=collectgarbage('count')-heapBefore");
+    //no script touched the elements, so none of them has Lua object
+    TEST_EQUALS_INT((int)engine.getLuaObjectsCreated(), 0);
+    printf("\n  20K elements build: %.3fms, Lua heap growth %.1fKB\n", buildMs, engine.getLua()->globalDouble("heapGrowth"));
+}
+
+static double runHandlerChurn(Lua&lua) {
+    //what event handlers typically do: small tables, closures and concatenated strings that die right away
+    const char*script=R"(
+        local sum=0
+        for i=1,300000 do
+            local event={x=i, y=i*2, name='click'..(i%100)}
+            local handler=function() return event.x+event.y end
+            sum=sum+handler()+#event.name
+        end
+        churnSum=sum
+    )";
+    auto start = std::chrono::steady_clock::now();
+    lua.evalExpression(script);
+    return elapsedMs(start);
+}
+
+void benchmarkLuaAllocator() {
+    Lua pooled(true);
+    Lua plain(true, new LuaAllocator());
+    double pooledMs = runHandlerChurn(pooled);
+    double plainMs = runHandlerChurn(plain);
+    TEST_EQUALS_INT(pooled.globalInt("churnSum"), plain.globalInt("churnSum"));
+    LuaAllocator*allocator = pooled.getAllocator();
+    printf("\n  300K handler calls: pooled allocator %.3fms, malloc %.3fms, %lld allocations, peak %.1fKB\n", pooledMs, plainMs,
+           allocator->getAllocations(), allocator->getPeakBytes()/1024.0);
+}
+
+ACUTEST_MODULE_INITIALIZER(benchmark_module) {
+    ACUTEST_ADD_TEST_(benchmarkScanDelimiters);
+    ACUTEST_ADD_TEST_(benchmarkParseScriptTag);
+    ACUTEST_ADD_TEST_(benchmarkTagAttribute);
+    ACUTEST_ADD_TEST_(benchmarkSetAttributeFromLua);
+    ACUTEST_ADD_TEST_(benchmarkBuildDocument);
+    ACUTEST_ADD_TEST_(benchmarkLuaAllocator);
+}
+
+#endif
@@ -561,10 +561,11 @@ void testLuaTableInheritance() {
 
 void testLuaRequiredCustomModule() {
     Lua lua=createLua(true);
-    lua.registerLuaModuleReader([](char*name) {
-        if(strcmp(name, "/s/file/module.lua")==0)
-            return (char*)"function utilsIncrement(x)return x+1 end";
-        return (char*)NULL;
+    lua.registerLuaModuleReader([](const char*name, std::string_view&content) {
+        if(strcmp(name, "/s/file/module.lua")!=0)
+            return false;
+        content="function utilsIncrement(x)return x+1 end";
+        return true;
     });
     lua.evalExpression(R"(
         require "/s/file/module.lua"
@@ -576,6 +577,140 @@ void testLuaRequiredCustomModule() {
     closeLua(lua, true);
 }
 
+void testLuaModuleChunksCache() {
+    CompiledChunksCache&cache=CompiledChunksCache::instance();
+    long long hits=cache.getHits();
+    long long misses=cache.getMisses();
+    for(int i=0;i<2;i++) {
+        Lua lua=createLua(true);
+        lua.registerLuaModuleReader([](const char*name, std::string_view&content) {
+            if(strcmp(name, "/s/cached/module.lua")!=0)
+                return false;
+            content="cachedModuleValue=(cachedModuleValue or 0)+10";
+            return true;
+        });
+        lua.evalExpression("require '/s/cached/module.lua'");
+        TEST_EQUALS_INT(lua.globalInt("cachedModuleValue"), 10);
+        closeLua(lua, true);
+    }
+    //the second state loaded bytecode compiled for the first one
+    TEST_EQUALS_INT((int)(cache.getMisses()-misses), 1);
+    TEST_EQUALS_INT((int)(cache.getHits()-hits), 1);
+}
+
+void testLuaPooledAllocator() {
+    Lua lua=createLua(true);
+    LuaAllocator*allocator=lua.getAllocator();
+    size_t liveBefore=allocator->getLiveBytes();
+    long long allocationsBefore=allocator->getAllocations();
+    lua.evalExpression(R"(
+       local items={}
+       for i=1,10000 do items[i]={value=i, name='item'..i, get=function() return i end} end
+       itemsCount=#items
+    )");
+    TEST_EQUALS_INT(lua.globalInt("itemsCount"), 10000);
+    TEST_ASSERT(allocator->getAllocations()-allocationsBefore>=30000);
+    TEST_ASSERT(allocator->getPeakBytes()>=allocator->getLiveBytes());
+    TEST_ASSERT(allocator->getPoolBytes()>0);
+    lua.evalExpression("heapKb=0 collectgarbage('collect') heapKb=collectgarbage('count')");
+    //live bytes are the same Lua counts itself
+    TEST_EQUALS_INT((int)allocator->getLiveBytes(), (int)(lua.globalDouble("heapKb")*1024));
+    TEST_ASSERT(allocator->getLiveBytes()<liveBefore+64*1024);
+    closeLua(lua, true);
+}
+
+class FailingPooledAllocator: public PooledLuaAllocator {
+public:
+    bool failing=false;
+protected:
+    void*allocateBlock(size_t size)override {
+        return failing?NULL:PooledLuaAllocator::allocateBlock(size);
+    }
+};
+
+void testLuaPooledAllocator_ShrinkNeverFails() {
+    FailingPooledAllocator allocator;
+    void*large=LuaAllocator::luaAlloc(&allocator, NULL, 0, 1000);
+    void*pooled=LuaAllocator::luaAlloc(&allocator, NULL, 0, 200);
+    allocator.failing=true;
+    //shrink to other size class keeps the old block when new one cannot be allocated
+    TEST_EQUALS_BOOL(LuaAllocator::luaAlloc(&allocator, large, 1000, 100)==large, true);
+    TEST_EQUALS_BOOL(LuaAllocator::luaAlloc(&allocator, pooled, 200, 20)==pooled, true);
+    TEST_EQUALS_INT((int)allocator.getLiveBytes(), 120);
+    TEST_EQUALS_BOOL(LuaAllocator::luaAlloc(&allocator, pooled, 20, 100)==NULL, true);
+    allocator.failing=false;
+    //kept malloc block grows and is freed as malloc block, not put to pool
+    large=LuaAllocator::luaAlloc(&allocator, large, 100, 2000);
+    TEST_ASSERT(large!=NULL);
+    LuaAllocator::luaAlloc(&allocator, large, 2000, 0);
+    LuaAllocator::luaAlloc(&allocator, pooled, 20, 0);
+    TEST_EQUALS_INT((int)allocator.getLiveBytes(), 0);
+}
+
+void testLuaAtomKeys() {
+    Lua lua=createLua(true);
+    Atom known=internAtom(wxString("luaAtomKeyTest"));
+    lua.registerNativeFunction("atomOf", [](ValuesListReader*args, ValuesListWriter*retValues) {
+        retValues->pushInt(args->getAtom(0));
+    });
+    lua.registerNativeFunction("tableWithAtomKey", [known](ValuesListReader*args, ValuesListWriter*retValues) {
+        retValues->pushTable([known](TableWriter*table) {
+            table->put(LuaKey(known), 7);
+            table->put("literalKey", 8);
+        });
+    });
+    lua.evalExpression(R"(
+       first=LuaWrapperFFI.atomOf('luaAtomKeyTest')
+       second=LuaWrapperFFI.atomOf('luaAtomKey'..'Test')
+       unknown=LuaWrapperFFI.atomOf('luaAtomKeyMissing')
+       number=LuaWrapperFFI.atomOf(5)
+       local t=LuaWrapperFFI.tableWithAtomKey()
+       fromTable=t.luaAtomKeyTest+t.literalKey
+    )");
+    TEST_EQUALS_INT(lua.globalInt("first"), known);
+    //string built at runtime is the same interned Lua string, resolved by its address
+    TEST_EQUALS_INT(lua.globalInt("second"), known);
+    TEST_EQUALS_INT(lua.globalInt("unknown"), NO_ATOM);
+    TEST_EQUALS_INT(lua.globalInt("number"), NO_ATOM);
+    TEST_EQUALS_INT(lua.globalInt(LuaKey(internAtom(wxString("fromTable")))), 15);
+    closeLua(lua, true);
+}
+
+struct BindingTestContext {
+    int calls=0;
+};
+
+static wxString bindingTestRepeat(BindingTestContext*context, wxString text, int count) {
+    context->calls++;
+    wxString result;
+    for(int i=0;i<count;i++) result+=text;
+    return result;
+}
+
+static void bindingTestFail(BindingTestContext*context, LuaAtom name) {
+    throw NativeError(wxString::Format("failed %s %d", wxString::FromUTF8(name.name.data(), name.name.size()), name.isString()?1:0));
+}
+
+void testLuaNativeBinding() {
+    Lua lua=createLua(true);
+    BindingTestContext context;
+    lua.bindNativeFunction<bindingTestRepeat>("repeatText", &context);
+    lua.bindNativeFunction<bindingTestFail>("fail", &context);
+    lua.evalExpression(R"(
+       repeated=LuaWrapperFFI.repeatText('ab', 3)
+       local ok, message=pcall(LuaWrapperFFI.repeatText, 'ab', 'x')
+       wrongArgument=not ok and string.find(message, 'bad argument #2')~=nil
+       ok, message=pcall(LuaWrapperFFI.fail, 'name')
+       failMessage=message
+    )");
+    TEST_EQUALS_WXSTR(lua.globalString("repeated"), "ababab");
+    TEST_ASSERT(lua.globalBool("wrongArgument"));
+    TEST_EQUALS_WXSTR(lua.globalString("failMessage"), "failed name 1");
+    //conversion failed before the call
+    TEST_EQUALS_INT(context.calls, 1);
+    closeLua(lua, true);
+}
+
 Lua createLua(bool addGuard) {
     Lua lua(true);
     if(addGuard) {
@@ -623,6 +758,11 @@ ACUTEST_MODULE_INITIALIZER(lua_module){
     ACUTEST_ADD_TEST_(testLuaFunctionRefExec);
     ACUTEST_ADD_TEST_(testLuaTableInheritance);
     ACUTEST_ADD_TEST_(testLuaRequiredCustomModule);
+    ACUTEST_ADD_TEST_(testLuaModuleChunksCache);
+    ACUTEST_ADD_TEST_(testLuaAtomKeys);
+    ACUTEST_ADD_TEST_(testLuaNativeBinding);
+    ACUTEST_ADD_TEST_(testLuaPooledAllocator);
+    ACUTEST_ADD_TEST_(testLuaPooledAllocator_ShrinkNeverFails);
 }
 
 #endif
@@ -9,6 +9,12 @@
 
 #define TEST_NO_MAIN
 #include "accutestWrapper.hpp"
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <condition_variable>
+
+using namespace lxe;
 /*
  root
   -folderA
@@ -52,9 +58,1178 @@ void testSerializedFolderReader_GetByPath() {
     
 }
 
+void testStdLibIsPrecompiled() {
+    Engine engine;
+    SerializedFileChunk*chunk=engine.getSerializedFolderReader().findChunk("/lxe/lxe.lua");
+    TEST_ASSERT(chunk!=NULL);
+    engine.getLua()->evalExpression("stdLibSource=debug.getinfo(lxe.indexOf, 'S').source");
+    if(chunk->dataLength==0 || chunk->data[0]!=LUA_SIGNATURE[0]) {
+        //prepareBuild.py --source embeds text, which is still loaded by require
+        TEST_ASSERT(engine.getLua()->globalString("stdLibSource")!="=?");
+        return;
+    }
+    //modules built by prepareBuild.py are stripped bytecode, so functions have no source name
+    TEST_EQUALS_WXSTR(engine.getLua()->globalString("stdLibSource"), "=?");
+}
+
+void testMemoryStats() {
+    Engine engine;
+    engine.getLua()->evalExpression("local stats=lxe.memoryStats() statsLive=stats.live statsPeak=stats.peak statsAllocations=stats.allocations");
+    LuaAllocator*allocator=engine.getLua()->getAllocator();
+    TEST_ASSERT(engine.getLua()->globalDouble("statsLive")>0);
+    TEST_ASSERT(engine.getLua()->globalDouble("statsPeak")>=engine.getLua()->globalDouble("statsLive"));
+    TEST_ASSERT(engine.getLua()->globalDouble("statsAllocations")<=(double)allocator->getAllocations());
+}
+
+void testIdleGarbageCollection() {
+    Engine engine;
+    std::vector<std::function<void()>>idleCallbacks;
+    engine.setIdleScheduler([&idleCallbacks](std::function<void()>callback) {
+        idleCallbacks.push_back(callback);
+    });
+    engine.getLua()->evalExpression(R"(
+       lxe.configureGc({deferDuringEvents=true, idleBudgetMs=1000})
+       function handler()
+           runningInHandler=collectgarbage('isrunning')
+           for i=1,10000 do local garbage={i} end
+       end
+       local ok, message=pcall(lxe.configureGc, {mode='compacting'})
+       wrongMode=not ok and string.find(message, 'compacting')~=nil
+    )");
+    TEST_ASSERT(engine.getLua()->globalBool("wrongMode"));
+    TEST_EQUALS_BOOL(engine.getGcScheduler().getSettings().deferDuringEvents, true);
+
+    TagAttribute handler;
+    handler.setString("handler");
+    engine.runEventHandler(NULL, handler);
+    TEST_EQUALS_BOOL(engine.getLua()->globalBool("runningInHandler"), false);
+    TEST_EQUALS_BOOL(engine.getLua()->isCollectorRunning(), true);
+    //one idle collection for events that come before idle
+    engine.runEventHandler(NULL, handler);
+    TEST_EQUALS_INT((int)idleCallbacks.size(), 1);
+    //budget is large enough to finish the cycle in one slice
+    idleCallbacks[0]();
+    TEST_EQUALS_INT((int)idleCallbacks.size(), 1);
+    TEST_EQUALS_INT((int)engine.getGcScheduler().getIdleCycles(), 1);
+
+    //collector stopped by application is not restarted and not stepped on idle
+    engine.getLua()->evalExpression("collectgarbage('stop')");
+    engine.runEventHandler(NULL, handler);
+    TEST_EQUALS_BOOL(engine.getLua()->isCollectorRunning(), false);
+    long long steps=engine.getGcScheduler().getIdleSteps();
+    idleCallbacks[1]();
+    TEST_EQUALS_INT((int)(engine.getGcScheduler().getIdleSteps()-steps), 0);
+
+    engine.getLua()->evalExpression(R"(
+       collectgarbage('restart')
+       lxe.configureGc({mode='generational'})
+       local stats=lxe.gcStats()
+       statsHandlers=stats.handlers
+       statsCycles=stats.idleCycles
+       statsOrdered=stats.handlerP50Ms<=stats.handlerMaxMs
+    )");
+    TEST_EQUALS_INT((int)engine.getLua()->globalDouble("statsHandlers"), 3);
+    TEST_EQUALS_INT((int)engine.getLua()->globalDouble("statsCycles"), 1);
+    TEST_ASSERT(engine.getLua()->globalBool("statsOrdered"));
+    engine.runEventHandler(NULL, handler);
+    idleCallbacks[2]();
+    //every generational step is a whole young collection
+    TEST_EQUALS_INT((int)idleCallbacks.size(), 3);
+    TEST_EQUALS_INT((int)engine.getGcScheduler().getIdleCycles(), 2);
+}
+
+void testIdleGarbageCollection_AfterEngineDestroyed() {
+    std::vector<std::function<void()>>idleCallbacks;
+    {
+        Engine engine;
+        engine.setIdleScheduler([&idleCallbacks](std::function<void()>callback) {
+            idleCallbacks.push_back(callback);
+        });
+        engine.getLua()->evalExpression("function handler() end");
+        TagAttribute handler;
+        handler.setString("handler");
+        engine.runEventHandler(NULL, handler);
+    }
+    TEST_EQUALS_INT((int)idleCallbacks.size(), 1);
+    //slice of destroyed engine is dropped
+    idleCallbacks[0]();
+}
+
+void testTokenizer_SpansPointToSource() {
+    const char*source="<Panel title='plain' escaped='a\\'b' width=10 scale=1.5 visible=true><!--note--></Panel>";
+    TagsTokenizer tokenizer(source, strlen(source));
+    Token token=tokenizer.nextToken();
+    TEST_EQUALS_INT(token.getType(), TokenType_TAG);
+    TEST_EQUALS_BOOL(token.getTagName().data()==source+1, true);
+    std::vector<TokenAttribute>&attributes=token.getAttributes();
+    TEST_EQUALS_INT((int)attributes.size(), 5);
+    TEST_EQUALS_BOOL(attributes[0].value.isOwned(), false);
+    TEST_EQUALS_WXSTR(attributes[0].value.toWxString(), "plain");
+    TEST_EQUALS_BOOL(attributes[1].value.isOwned(), true);
+    TEST_EQUALS_WXSTR(attributes[1].value.toWxString(), "a'b");
+    TEST_EQUALS_INT(attributes[2].toTagAttribute().getInt(), 10);
+    TEST_EQUALS_BOOL(attributes[3].toTagAttribute().getType()==TA_DOUBLE, true);
+    TEST_EQUALS_BOOL(attributes[4].toTagAttribute().getBool(), true);
+    Token comment=tokenizer.nextToken();
+    TEST_EQUALS_INT(comment.getType(), TokenType_COMMENT);
+    TEST_EQUALS_BOOL(comment.getText().isOwned(), false);
+    TEST_EQUALS_WXSTR(comment.getText().toWxString(), "note");
+}
+
+void testTokenizer_NegativeNumbers() {
+    const char*source="<Panel x=-5 y=- 7 scale=-  1.5/>";
+    TagsTokenizer tokenizer(source, strlen(source));
+    Token token=tokenizer.nextToken();
+    std::vector<TokenAttribute>&attributes=token.getAttributes();
+    TEST_EQUALS_INT((int)attributes.size(), 3);
+    TEST_EQUALS_BOOL(attributes[0].value.isOwned(), false);
+    TEST_EQUALS_INT(attributes[0].toTagAttribute().getInt(), -5);
+    //blanks after minus are dropped from the literal
+    TEST_EQUALS_INT(attributes[1].toTagAttribute().getInt(), -7);
+    TEST_EQUALS_BOOL(attributes[2].toTagAttribute().getType()==TA_DOUBLE, true);
+    TEST_EQUALS_BOOL(attributes[2].toTagAttribute().getDouble()==-1.5, true);
+}
+
+void testTagsParser_RawBuffer() {
+    const char*source="<Application>\n  <Label text=\"\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82\"/>\n  <Script>if a<b then x='</Label>' end</Script>\n</Application>";
+    TagsParser parser(source, strlen(source), "test");
+    parser.addTagWithRawTextContent("Script");
+    TagsDocument*document=parser.parseTags();
+    TEST_EQUALS_INT((int)document->getTags().size(), 1);
+    Tag*root=document->getTags()[0];
+    TEST_EQUALS_WXSTR(root->getTagName(), "Application");
+    TEST_EQUALS_INT(root->getChildrenCount(), 2);
+    Tag*label=root->getChild(0);
+    TEST_EQUALS_INT(label->getLine(), 1);
+    TEST_EQUALS_WXSTR(label->getAttribute("text").getString(), wxString::FromUTF8("\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82"));
+    Tag*script=root->getChild(1);
+    TEST_EQUALS_WXSTR(script->getChild(0)->getText(), "if a<b then x='</Label>' end");
+    delete document;
+}
+
+void testScanDelimiters_MatchesScalar() {
+    //delimiter at every position checks both vectorized blocks and scalar tail
+    for (int position = 0; position <= 100; position++) {
+        std::string buffer(100, 'a');
+        if (position < (int)buffer.size()) {
+            buffer[position] = '"';
+        }
+        const char*begin = buffer.data();
+        const char*end = begin + buffer.size();
+        const char*found = scanDelimiters(begin, end, "\"\\");
+        const char*scalarFound = scanDelimitersScalar(begin, end, "\"\\");
+        TEST_EQUALS_INT((int)(found - begin), (int)(scalarFound - begin));
+        //more delimiters than vector registers are prepared for
+        found = scanDelimiters(begin, end, "<>&'\"");
+        TEST_EQUALS_INT((int)(found - begin), (int)(scalarFound - begin));
+        TEST_EQUALS_INT((int)(scanDelimiters(begin, end, "") - begin), (int)buffer.size());
+    }
+}
+
+void testTokenizer_LineNumbersAfterSkippedText() {
+    const char*source="<Application>\n<!-- a\n-- b\n -->\n<Script>\nx=1\ny='<'\n</Script>\n<Label text='a\\nb\nc'/>\n<Label/>\n</Application>";
+    TagsParser parser(source, strlen(source), "test");
+    parser.addTagWithRawTextContent("Script");
+    TagsDocument*document=parser.parseTags();
+    Tag*root=document->getTags()[0];
+    TEST_EQUALS_INT(root->getChildrenCount(), 4);
+    TEST_EQUALS_INT(root->getChild(1)->getLine(), 4);
+    TEST_EQUALS_WXSTR(root->getChild(2)->getAttribute("text").getString(), "a\nb\nc");
+    TEST_EQUALS_INT(root->getChild(3)->getLine(), 10);
+    delete document;
+}
+
+class RecordingTagsHandler: public TagsHandler {
+public:
+    wxArrayString events;
+    void onOpenTag(std::string_view tagName, int line)override {events.push_back("open:"+spanToWxString(tagName));}
+    void onAttribute(const TokenAttribute&attribute, int line)override {events.push_back("attr:"+spanToWxString(attribute.name));}
+    void onText(std::string_view text, int line)override {events.push_back("text:"+spanToWxString(text));}
+    void onCloseTag(std::string_view tagName, int line)override {events.push_back("close:"+spanToWxString(tagName));}
+};
+
+void testTagsParser_StreamingEvents() {
+    const char*source="<Root a=1><Child b='x'/><!--c--><Script>x=1</Script></Root>";
+    TagsParser parser(source, strlen(source), "test");
+    parser.addTagWithRawTextContent("Script");
+    RecordingTagsHandler handler;
+    parser.parse(&handler);
+    TEST_EQUALS_INT((int)handler.events.size(), 9);
+    TEST_EQUALS_WXSTR(handler.events[0], "open:Root");
+    TEST_EQUALS_WXSTR(handler.events[1], "attr:a");
+    TEST_EQUALS_WXSTR(handler.events[2], "open:Child");
+    TEST_EQUALS_WXSTR(handler.events[3], "attr:b");
+    TEST_EQUALS_WXSTR(handler.events[4], "close:Child");
+    TEST_EQUALS_WXSTR(handler.events[5], "open:Script");
+    TEST_EQUALS_WXSTR(handler.events[6], "text:x=1");
+    TEST_EQUALS_WXSTR(handler.events[7], "close:Script");
+    TEST_EQUALS_WXSTR(handler.events[8], "close:Root");
+}
+
+class TestContainerElement: public virtual DomElement {
+public:
+    wxArrayString*initLog;
+    TestContainerElement(wxArrayString*initLog, bool initChildrenBefore) {
+        this->initLog=initLog;
+        setChildrenAllowed(true);
+        setInitChildrenBeforeTag(initChildrenBefore);
+    }
+    void initElement(DomElement*parent, wxArrayString*attributesNames)override {
+        initLog->push_back(getTagName());
+    }
+};
+
+void testDomElementsBuilder_InitOrder() {
+    wxArrayString initLog;
+    Engine engine;
+    engine.registerTagFactory("Root", [&initLog](){return new TestContainerElement(&initLog, false);});
+    engine.registerTagFactory("Child", [&initLog](){return new TestContainerElement(&initLog, false);});
+    engine.registerTagFactory("Tree", [&initLog](){return new TestContainerElement(&initLog, true);});
+    const char*source="<Root><Child/><Tree><Child/></Tree><Script>local x=1</Script></Root>";
+    TagsParser parser(source, strlen(source), "test");
+    parser.addTagWithRawTextContent("Script");
+    DomElementsBuilder builder(&engine, NULL, true);
+    parser.parse(&builder);
+    TEST_EQUALS_INT((int)builder.getCreatedElements().size(), 1);
+    DomElement*root=builder.getCreatedElements()[0];
+    TEST_EQUALS_INT(root->getChildrenCount(), 3);
+    TEST_EQUALS_WXSTR(root->getChild(2)->getTextContent(), "local x=1");
+    //Tree initializes its children before itself
+    TEST_EQUALS_INT((int)initLog.size(), 4);
+    TEST_EQUALS_WXSTR(initLog[0], "Root");
+    TEST_EQUALS_WXSTR(initLog[1], "Child");
+    TEST_EQUALS_WXSTR(initLog[2], "Child");
+    TEST_EQUALS_WXSTR(initLog[3], "Tree");
+}
+
+void testDomElementsBuilder_BrokenSourceLeavesNoElements() {
+    wxArrayString initLog;
+    Engine engine;
+    engine.registerTagFactory("Root", [&initLog](){return new TestContainerElement(&initLog, false);});
+    //syntax error is found before any element is created
+    const char*source="<Root id='root'><Root id='ok'/><Root id='second'> </Broken></Root>";
+    engine.run(source, strlen(source), "test");
+    TEST_EQUALS_INT((int)initLog.size(), 0);
+    TEST_EQUALS_BOOL(engine.getDomElementById("ok")==NULL, true);
+
+    //elements created before runtime error are removed
+    const char*unknownTag="<Root id='root'><Root id='ok'/><Unknown/></Root>";
+    engine.run(unknownTag, strlen(unknownTag), "test");
+    TEST_EQUALS_INT((int)initLog.size(), 2);
+    TEST_EQUALS_BOOL(engine.getDomElementById("root")==NULL, true);
+    TEST_EQUALS_BOOL(engine.getDomElementById("ok")==NULL, true);
+    TEST_EQUALS_INT(engine.getElementsIndex().getSize(), 0);
+
+    //unknown names in fragments are rejected without adding atoms
+    const char*container="<Root id='container'/>";
+    engine.run(container, strlen(container), "test");
+    DomElement*containerElement=engine.getDomElementById("container");
+    TEST_ASSERT(containerElement!=NULL);
+    int atomsCount=AtomTable::instance().getSize();
+    wxString unknownAttribute="<Root fragmentOnlyAttribute='1'/>";
+    TEST_EXCEPTION(engine.replaceChildrenFromString(containerElement, unknownAttribute), RuntimeException);
+    wxString unknownFragmentTag="<FragmentOnlyTag/>";
+    TEST_EXCEPTION(engine.replaceChildrenFromString(containerElement, unknownFragmentTag), RuntimeException);
+    TEST_EQUALS_INT(AtomTable::instance().getSize(), atomsCount);
+    TEST_EQUALS_INT(containerElement->getChildrenCount(), 0);
+}
+
+void testMonotonicArena() {
+    MonotonicArena arena(1024);
+    for (int i = 0; i < 100; i++) {
+        int*value = arena.create<int>(i);
+        TEST_EQUALS_INT(*value, i);
+        double*doubleValue = arena.create<double>(1.5);
+        TEST_EQUALS_BOOL(((size_t)doubleValue % alignof(double)) == 0, true);
+    }
+    TEST_EQUALS_BOOL(arena.getBlocksCount() < 3, true);
+    std::string_view copy = arena.copyString("some text");
+    TEST_EQUALS_BOOL(copy == "some text", true);
+    //object bigger than block gets its own block
+    arena.allocate(4096, 8);
+    TEST_EQUALS_BOOL(arena.getBlocksCount() < 4, true);
+    arena.release();
+    TEST_EQUALS_INT(arena.getBlocksCount(), 0);
+}
+
+void testTagsParser_DocumentInArena() {
+    std::string source = "<Application>";
+    for (int i = 0; i < 200; i++) {
+        source += "<Label text='label' width=10 visible=true/>";
+    }
+    source += "</Application>";
+    TagsParser parser(source.data(), source.size(), "test");
+    TagsDocument*document = parser.parseTags();
+    Tag*root = document->getTags()[0];
+    TEST_EQUALS_INT(root->getChildrenCount(), 200);
+    int count = 0;
+    for (Tag*child = root->getFirstChild(); child != NULL; child = child->getNextSibling()) {
+        TEST_EQUALS_INT(child->getAttribute("width").getInt(), 10);
+        count++;
+    }
+    TEST_EQUALS_INT(count, 200);
+    TEST_EQUALS_BOOL(root->getChild(5)->hasAttribute("visible"), true);
+    TEST_EQUALS_BOOL(root->getChild(5)->hasAttribute("height"), false);
+    //all 200 tags with 600 attributes fit into couple of blocks
+    TEST_EQUALS_BOOL(document->getArena().getBlocksCount() <= 2, true);
+    delete document;
+}
+
+class RecordingTypedTagsHandler: public RecordingTagsHandler {
+public:
+    std::vector<TagAttribute>values;
+    void onTypedAttribute(std::string_view name, const TagAttribute&value, int line)override {
+        events.push_back("attr:"+spanToWxString(name));
+        values.push_back(value);
+    }
+    void onPrecompiledText(std::string_view bytecode, int line)override {events.push_back("bytecode");}
+};
+
+void testCompiledLxml_RoundTrip() {
+    const char*source="<Root count=5 ratio=0.5 enabled=true title='a\\'b'>\n<Child title='a\\'b'/><Script>compiledValue=40+2</Script></Root>";
+    std::string compiled=Engine::compileLxml(source, strlen(source), "test");
+    TEST_EQUALS_BOOL(CompiledLxmlReader::isCompiledLxml(compiled.data(), compiled.size()), true);
+    TEST_EQUALS_BOOL(CompiledLxmlReader::isCompiledLxml(source, strlen(source)), false);
+
+    RecordingTypedTagsHandler handler;
+    CompiledLxmlReader reader(compiled.data(), compiled.size());
+    reader.read(&handler);
+    TEST_EQUALS_INT((int)handler.events.size(), 12);
+    TEST_EQUALS_WXSTR(handler.events[0], "open:Root");
+    TEST_EQUALS_WXSTR(handler.events[5], "open:Child");
+    TEST_EQUALS_WXSTR(handler.events[9], "bytecode");
+    TEST_EQUALS_WXSTR(handler.events[11], "close:Root");
+    TEST_EQUALS_INT(handler.values[0].getInt(), 5);
+    TEST_EQUALS_DBL(handler.values[1].getDouble(), 0.5);
+    TEST_EQUALS_BOOL(handler.values[2].getBool(), true);
+    TEST_EQUALS_WXSTR(handler.values[3].getString(), "a'b");
+    TEST_EQUALS_WXSTR(handler.values[4].getString(), "a'b");
+
+    //truncated file should fail with error instead of reading out of the buffer
+    CompiledLxmlReader truncatedReader(compiled.data(), compiled.size()-3);
+    bool failed=false;
+    try {
+        truncatedReader.read(&handler);
+    } catch(ParseException&ex) {
+        failed=true;
+    }
+    TEST_EQUALS_BOOL(failed, true);
+}
+
+void testCompiledLxml_EngineRunsBytecode() {
+    wxArrayString initLog;
+    Engine engine;
+    engine.registerTagFactory("Root", [&initLog](){return new TestContainerElement(&initLog, false);});
+    const char*source="<Root id='main'><Script>compiledValue=40+2</Script></Root>";
+    std::string compiled=Engine::compileLxml(source, strlen(source), "test");
+    DomElementsBuilder builder(&engine, NULL, true);
+    CompiledLxmlReader reader(compiled.data(), compiled.size());
+    reader.read(&builder);
+    DomElement*root=builder.getCreatedElements()[0];
+    wxString id="main";
+    TEST_EQUALS_BOOL(engine.getDomElementById(id)==root, true);
+    TEST_EQUALS_INT(engine.getLua()->globalInt("compiledValue"), 42);
+}
+
+void testScriptBytecodeCache() {
+    std::filesystem::path directory=std::filesystem::temp_directory_path()/"lxeScriptCacheTest";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    const char*source="<Root><Script>cachedValue=(cachedValue or 0)+1\ncachedLine=debug.getinfo(1, 'l').currentline</Script></Root>";
+    for(int run=0;run<2;run++) {
+        wxArrayString initLog;
+        Engine engine;
+        engine.setScriptCacheDirectory(wxString::FromUTF8(directory.string().c_str()));
+        engine.registerTagFactory("Root", [&initLog](){return new TestContainerElement(&initLog, false);});
+        engine.run(source, strlen(source), "test");
+        TEST_EQUALS_INT(engine.getLua()->globalInt("cachedValue"), 1);
+        //bytecode in cache keeps line numbers
+        TEST_EQUALS_INT(engine.getLua()->globalInt("cachedLine"), 2);
+        TEST_EQUALS_INT((int)engine.getScriptCacheMisses(), run==0?1:0);
+        TEST_EQUALS_INT((int)engine.getScriptCacheHits(), run==0?0:1);
+    }
+    int cachedFiles=0;
+    for(auto&entry: std::filesystem::directory_iterator(directory)) {
+        TEST_EQUALS_WXSTR(wxString(entry.path().extension().string()), ".luac");
+        cachedFiles++;
+    }
+    TEST_EQUALS_INT(cachedFiles, 1);
+    //truncated file is compiled again instead of being run
+    for(auto&entry: std::filesystem::directory_iterator(directory)) {
+        std::filesystem::resize_file(entry.path(), std::filesystem::file_size(entry.path())-8);
+    }
+    {
+        wxArrayString initLog;
+        Engine engine;
+        engine.setScriptCacheDirectory(wxString::FromUTF8(directory.string().c_str()));
+        engine.registerTagFactory("Root", [&initLog](){return new TestContainerElement(&initLog, false);});
+        engine.run(source, strlen(source), "test");
+        TEST_EQUALS_INT(engine.getLua()->globalInt("cachedValue"), 1);
+        TEST_EQUALS_INT((int)engine.getScriptCacheMisses(), 1);
+    }
+    //files of older scripts are removed beyond the limit
+    for(int version=0;version<3;version++) {
+        wxArrayString initLog;
+        Engine engine;
+        engine.setScriptCacheDirectory(wxString::FromUTF8(directory.string().c_str()));
+        engine.setScriptCacheLimit(2);
+        engine.registerTagFactory("Root", [&initLog](){return new TestContainerElement(&initLog, false);});
+        std::string versionSource="<Root><Script>cachedVersion="+std::to_string(version)+"</Script></Root>";
+        engine.run(versionSource.data(), versionSource.size(), "test");
+        TEST_EQUALS_INT(engine.getLua()->globalInt("cachedVersion"), version);
+    }
+    cachedFiles=0;
+    for(auto&entry: std::filesystem::directory_iterator(directory)) {
+        (void)entry;
+        cachedFiles++;
+    }
+    TEST_EQUALS_INT(cachedFiles, 2);
+    std::filesystem::remove_all(directory);
+}
+
+void testCompiledLxml_ScriptSyntaxError() {
+    const char*source="<Root><Script>local = 1</Script></Root>";
+    bool failed=false;
+    try {
+        Engine::compileLxml(source, strlen(source), "test");
+    } catch(ParseException&ex) {
+        failed=true;
+    }
+    TEST_EQUALS_BOOL(failed, true);
+}
+
+void testLruCache() {
+    LruCache<wxString, int>cache(2);
+    int created=0;
+    auto create=[&created](){return ++created;};
+    TEST_EQUALS_INT(cache.get("a", create), 1);
+    TEST_EQUALS_INT(cache.get("b", create), 2);
+    TEST_EQUALS_INT(cache.get("a", create), 1);
+    //b is least recently used and goes away
+    TEST_EQUALS_INT(cache.get("c", create), 3);
+    TEST_EQUALS_INT(cache.get("b", create), 4);
+    TEST_EQUALS_INT((int)cache.getHits(), 1);
+    TEST_EQUALS_INT((int)cache.getMisses(), 4);
+    TEST_EQUALS_INT((int)cache.getEvictions(), 2);
+    TEST_EQUALS_INT((int)cache.getSize(), 2);
+    //value that failed to be created is not cached
+    bool failed=false;
+    try {
+        cache.get("bad", []()->int{throw RuntimeException("bad value");});
+    } catch(RuntimeException&ex) {
+        failed=true;
+    }
+    TEST_ASSERT(failed);
+    TEST_EQUALS_INT(cache.get("bad", create), 5);
+    cache.setLimit(1);
+    TEST_EQUALS_INT((int)cache.getSize(), 1);
+    cache.clear();
+    TEST_EQUALS_INT((int)cache.getSize(), 0);
+}
+
+void testFragmentsCache_Lru() {
+    FragmentsCache cache;
+    cache.setLimit(2);
+    std::shared_ptr<TagsDocument> document(new TagsDocument());
+    TEST_EQUALS_BOOL(cache.find("a", 1)==NULL, true);
+    cache.put("a", 1, document);
+    cache.put("b", 2, document);
+    TEST_EQUALS_BOOL(cache.find("a", 1)==document, true);
+    //"b" is least recently used now
+    cache.put("c", 3, document);
+    TEST_EQUALS_BOOL(cache.find("b", 2)==NULL, true);
+    TEST_EQUALS_BOOL(cache.find("a", 1)==document, true);
+    //same hash but different text is a miss
+    TEST_EQUALS_BOOL(cache.find("other", 3)==NULL, true);
+    TEST_EQUALS_INT((int)cache.getHits(), 2);
+    TEST_EQUALS_INT((int)cache.getMisses(), 3);
+    TEST_EQUALS_INT((int)cache.getEvictions(), 1);
+    cache.setLimit(0);
+    TEST_EQUALS_INT(cache.getSize(), 0);
+    TEST_EQUALS_INT((int)cache.getEvictions(), 3);
+}
+
+void testFragmentsCache_InnerLXML() {
+    wxArrayString initLog;
+    Engine engine;
+    engine.registerTagFactory("Root", [&initLog](){return new TestContainerElement(&initLog, false);});
+    engine.registerTagFactory("Child", [&initLog](){return new TestContainerElement(&initLog, false);});
+    const char*source="<Root/>";
+    DomElementsBuilder builder(&engine, NULL, true);
+    TagsParser parser(source, strlen(source), "test");
+    parser.parse(&builder);
+    DomElement*root=builder.getCreatedElements()[0];
+    for (int i = 0; i < 3; i++) {
+        wxString fragment="<Child/><Child><Script>fragmentRuns=(fragmentRuns or 0)+1</Script></Child>";
+        engine.replaceChildrenFromString(root, fragment);
+        TEST_EQUALS_INT(root->getChildrenCount(), 2);
+    }
+    TEST_EQUALS_INT(engine.getLua()->globalInt("fragmentRuns"), 3);
+    TEST_EQUALS_INT((int)engine.getFragmentsCache().getMisses(), 1);
+    TEST_EQUALS_INT((int)engine.getFragmentsCache().getHits(), 2);
+
+    engine.getLua()->evalExpression("lxe.setFragmentCacheLimit(5) local stats=lxe.getFragmentCacheStats() cacheHits=stats.hits cacheLimit=stats.limit");
+    TEST_EQUALS_INT(engine.getLua()->globalInt("cacheHits"), 2);
+    TEST_EQUALS_INT(engine.getLua()->globalInt("cacheLimit"), 5);
+}
+
+void testStringParser_LineAndColumn() {
+    const char*source="ab\ncd\n\nefg";
+    StringParser parser(source, (int)strlen(source));
+    TEST_EQUALS_INT(parser.getLineAt(0), 0);
+    TEST_EQUALS_INT(parser.getColumnAt(1), 1);
+    TEST_EQUALS_INT(parser.getLineAt(2), 0);
+    TEST_EQUALS_INT(parser.getLineAt(3), 1);
+    TEST_EQUALS_INT(parser.getColumnAt(4), 1);
+    TEST_EQUALS_INT(parser.getLineAt(6), 2);
+    TEST_EQUALS_INT(parser.getLineAt(9), 3);
+    TEST_EQUALS_INT(parser.getColumnAt(9), 2);
+}
+
+void testTagsParser_ErrorHasColumn() {
+    const char*source="<Application>\n  <Label text=?/>\n</Application>";
+    TagsParser parser(source, strlen(source), "test");
+    bool failed=false;
+    try {
+        TagsDocument*document=parser.parseTags();
+        delete document;
+    } catch(ParseException&ex) {
+        failed=true;
+        TEST_EQUALS_INT(ex.getLine(), 1);
+        TEST_EQUALS_INT(ex.getColumn(), 14);
+    }
+    TEST_EQUALS_BOOL(failed, true);
+}
+
+void testAtomTable() {
+    int size=AtomTable::instance().getSize();
+    TEST_EQUALS_INT(findAtom("atomTestName"), NO_ATOM);
+    TEST_EQUALS_INT(AtomTable::instance().getSize(), size);
+    Atom atom=internAtom(wxString("atomTestName"));
+    TEST_EQUALS_INT(internAtom(std::string_view("atomTestName")), atom);
+    TEST_EQUALS_INT(findAtom("atomTestName"), atom);
+    TEST_EQUALS_WXSTR(atomName(atom), "atomTestName");
+    TEST_EQUALS_BOOL(AtomTable::instance().getUtf8Name(atom)=="atomTestName", true);
+    TEST_EQUALS_INT(AtomTable::instance().getSize(), size+1);
+
+    wxArrayString initLog;
+    Engine engine;
+    engine.registerTagFactory("Root", [&initLog](){return new TestContainerElement(&initLog, false);});
+    const char*source="<Root id=\"atomRoot\"/>";
+    DomElementsBuilder builder(&engine, NULL, true);
+    TagsParser parser(source, strlen(source), "test");
+    parser.parse(&builder);
+    DomElement*root=builder.getCreatedElements()[0];
+    TEST_EQUALS_INT(root->getTagNameAtom(), findAtom("Root"));
+    TEST_EQUALS_WXSTR(root->getTagName(), "Root");
+    TEST_EQUALS_BOOL(root->hasSettedAttribute(findAtom("id")), true);
+    TEST_EQUALS_WXSTR(root->getAttribute("id"), "atomRoot");
+    //lookup of never interned name does not add it
+    size=AtomTable::instance().getSize();
+    TEST_EQUALS_BOOL(root->hasSettedAttribute(wxString("neverUsedAttribute")), false);
+    TEST_EQUALS_INT(AtomTable::instance().getSize(), size);
+}
+
+void testTagAttribute_CopyAndMove() {
+    TagAttribute text;
+    text.setString("label");
+    TagAttribute copy = text;
+    TEST_EQUALS_BOOL(copy.equals(text), true);
+    TEST_EQUALS_BOOL(&copy.getStringRef() == &text.getStringRef(), true);
+    text.setInt(5);
+    TEST_EQUALS_WXSTR(copy.getString(), "label");
+    TEST_EQUALS_INT(text.getInt(), 5);
+    TagAttribute moved = std::move(copy);
+    TEST_EQUALS_BOOL(copy.isNull(), true);
+    TEST_EQUALS_WXSTR(moved.getString(), "label");
+    moved = text;
+    TEST_EQUALS_INT(moved.getInt(), 5);
+    TEST_EQUALS_BOOL(TagAttribute().setDouble(1.5).getDouble() == 1.5, true);
+    TEST_EQUALS_BOOL(TagAttribute().setString("true").getBool(), true);
+    //every type keeps its value through copy and move of the union
+    TagAttribute flag;
+    flag.setBool(true);
+    TagAttribute flagCopy = flag;
+    TEST_EQUALS_BOOL(flagCopy.getBool(), true);
+    TagAttribute number;
+    number.setDouble(-2.25);
+    TagAttribute numberMoved = std::move(number);
+    TEST_EQUALS_BOOL(numberMoved.getDouble() == -2.25, true);
+    flagCopy = numberMoved;
+    TEST_EQUALS_BOOL(flagCopy.equals(numberMoved), true);
+}
+
+void testAttributesStorage_MergedView() {
+    Atom width=internAtom(wxString("width"));
+    Atom height=internAtom(wxString("height"));
+    Atom text=internAtom(wxString("text"));
+    AttributeDeclaration declarations[]={{"width", false, 0}, {"height", false, 0}, {"text", false, 0}};
+    AttributesSchema schema(NULL, declarations);
+    AttributesStorage storage;
+    storage.setSchema(&schema);
+    wxArrayString changes;
+    storage.setOnChangeEventHandler([&changes](const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue) {
+        changes.push_back(atomName(attribute.name));
+    });
+    TagAttribute value;
+    storage.setAttribute(text, value.setString("hello"), false);
+    storage.setAttribute(width, value.setInt(10), false);
+    TEST_EQUALS_INT(storage.getSettedAttributesCount(), 2);
+
+    PropertiesAttributes properties;
+    properties.propertiesId=1;
+    properties.order=0;
+    properties.attributes.set(width, TagAttribute().setInt(20));
+    properties.attributes.set(height, TagAttribute().setInt(30));
+    storage.addProperties(properties, true);
+    //direct attribute wins over properties layer
+    TEST_EQUALS_INT(storage.getAttribute(width).getInt(), 10);
+    TEST_EQUALS_INT(storage.getAttribute(height).getInt(), 30);
+    TEST_EQUALS_INT(storage.getSettedAttributesCount(), 3);
+    TEST_EQUALS_INT((int)changes.size(), 1);
+    TEST_EQUALS_WXSTR(changes[0], "height");
+    for(int i=1;i<storage.getSettedAttributesCount();i++) {
+        TEST_EQUALS_BOOL(storage.getSettedAttributeName(i-1) < storage.getSettedAttributeName(i), true);
+    }
+
+    storage.removeAttribute(width, true);
+    TEST_EQUALS_INT(storage.getAttribute(width).getInt(), 20);
+    storage.removeProperties(1, true);
+    TEST_EQUALS_BOOL(storage.findAttribute(height)==NULL, true);
+    TEST_EQUALS_INT(storage.getSettedAttributesCount(), 1);
+    TEST_EQUALS_WXSTR(storage.getAllSettedAtributeNames()[0], "text");
+}
+
+void testAttributesSchema() {
+    AttributeDeclaration baseDeclarations[]={{"schemaBase", false, 1}, {"schemaShared", false, 2}};
+    AttributeDeclaration declarations[]={{"schemaShared", true, 3}, {"schemaOwn", false, 4}};
+    AttributesSchema base(NULL, baseDeclarations);
+    AttributesSchema schema(&base, declarations);
+    TEST_EQUALS_INT(schema.getSize(), 3);
+    TEST_EQUALS_BOOL(schema.find(findAtom("schemaOwn"))!=NULL, true);
+    TEST_EQUALS_BOOL(base.find(findAtom("schemaOwn"))==NULL, true);
+    TEST_EQUALS_BOOL(schema.find(NO_ATOM)==NULL, true);
+    //derived declaration overrides declaration of parent
+    const AttributeSchemaEntry*shared=schema.find(findAtom("schemaShared"));
+    TEST_EQUALS_BOOL(shared->recreationRequired, true);
+    TEST_EQUALS_INT(shared->handlerId, 3);
+    TEST_EQUALS_BOOL(base.find(findAtom("schemaShared"))->recreationRequired, false);
+    //every atom of the table maps to its own slot
+    for(int i=0;i<schema.getSize();i++) {
+        TEST_EQUALS_BOOL(schema.find(schema.getEntry(i).name)==&schema.getEntry(i), true);
+    }
+    //names not in schema never match
+    for(Atom atom=0; atom<AtomTable::instance().getSize(); atom++) {
+        const AttributeSchemaEntry*entry=schema.find(atom);
+        TEST_EQUALS_BOOL(entry==NULL || entry->name==atom, true);
+    }
+
+    //element uses schema of its most derived class
+    Script script;
+    TEST_EQUALS_BOOL(script.getSchema()==Script::getAttributesSchema(), true);
+    TEST_EQUALS_BOOL(script.getSchema()->find(findAtom("innerLXML"))!=NULL, true);
+    TEST_EQUALS_BOOL(script.getSchema()->find(findAtom("id"))!=NULL, true);
+}
+
+enum {
+    TEST_HANDLER_COLOR=DOM_ELEMENT_HANDLERS_END,
+    TEST_HANDLER_SIZE
+};
+
+static constexpr AttributeDeclaration handlersTestAttributes[]={
+    {"testColor", false, TEST_HANDLER_COLOR},
+    {"testSize", false, TEST_HANDLER_SIZE},
+    {"testPlain", false, NO_ATTRIBUTE_HANDLER},
+    {"testRecreate", true, NO_ATTRIBUTE_HANDLER},
+};
+
+class HandlersTestElement: public virtual DomElement {
+public:
+    wxArrayString handled;
+    int initCount=0;
+    int batchesApplied=0;
+    bool failInit=false;
+    static const AttributesSchema*getAttributesSchema() {
+        static AttributesSchema schema(DomElement::getAttributesSchema(), handlersTestAttributes);
+        return &schema;
+    }
+    HandlersTestElement() {
+        setAttributesSchema(getAttributesSchema());
+    }
+    void initElement(DomElement*parent, wxArrayString*attributesNames)override {
+        initCount++;
+        if(failInit) throw RuntimeException("init failed");
+    }
+    void onAttributeBatchApplied()override {
+        batchesApplied++;
+    }
+    bool handleChangedAttribute(const AttributeSchemaEntry&attribute, TagAttribute&oldValue, TagAttribute&newValue)override {
+        switch(attribute.handlerId) {
+            case TEST_HANDLER_COLOR:
+                handled.push_back("color:"+getAttribute(atomName(attribute.name)));
+                return true;
+            case TEST_HANDLER_SIZE:
+                handled.push_back(wxString::Format("size:%d", getAttribute(atomName(attribute.name), 0)));
+                return true;
+        }
+        return DomElement::handleChangedAttribute(attribute, oldValue, newValue);
+    }
+};
+
+void testAttributeHandlers_DispatchById() {
+    Engine engine;
+    engine.registerTagFactory("Handlers", [](){return new HandlersTestElement();});
+    const char*source="<Handlers id='first' testColor='red' testPlain='x'/>";
+    TagsParser parser(source, strlen(source), "test");
+    DomElementsBuilder builder(&engine, NULL, true);
+    parser.parse(&builder);
+    HandlersTestElement*element=dynamic_cast<HandlersTestElement*>(builder.getCreatedElements()[0]);
+    //attributes without handler are skipped when applied after creation
+    TEST_EQUALS_INT((int)element->handled.size(), 1);
+    TEST_EQUALS_WXSTR(element->handled[0], "color:red");
+
+    engine.getLua()->evalExpression("local el=document:getElementById('first') el:setAttribute('testSize', 5) el:setAttribute('id', 'second')");
+    TEST_EQUALS_INT((int)element->handled.size(), 2);
+    TEST_EQUALS_WXSTR(element->handled[1], "size:5");
+    //ids are kept by elements index of engine, old id is released
+    TEST_EQUALS_BOOL(engine.getDomElementById("second")==element, true);
+    TEST_EQUALS_BOOL(engine.getDomElementById("first")==NULL, true);
+}
+
+void testAttributeBatch() {
+    Engine engine;
+    engine.registerTagFactory("Handlers", [](){return new HandlersTestElement();});
+    const char*source="<Handlers id='batch' testColor='red'/>";
+    TagsParser parser(source, strlen(source), "test");
+    DomElementsBuilder builder(&engine, NULL, true);
+    parser.parse(&builder);
+    HandlersTestElement*element=dynamic_cast<HandlersTestElement*>(builder.getCreatedElements()[0]);
+    element->handled.clear();
+
+    Atom color=findAtom("testColor");
+    Atom size=findAtom("testSize");
+    {
+        AttributeBatch batch(element);
+        TagAttribute value;
+        element->setAttribute(color, value.setString("green"));
+        element->setAttribute(color, value.setString("red"));
+        element->setAttribute(size, value.setInt(1));
+        element->setAttribute(size, value.setInt(2));
+        TEST_EQUALS_INT((int)element->handled.size(), 0);
+    }
+    //color returned to its value before batch, size fires once with final value
+    TEST_EQUALS_INT((int)element->handled.size(), 1);
+    TEST_EQUALS_WXSTR(element->handled[0], "size:2");
+    TEST_EQUALS_INT(element->batchesApplied, 1);
+
+    element->handled.clear();
+    TEST_EQUALS_INT(element->initCount, 1);
+    engine.getLua()->evalExpression("document:getElementById('batch'):setAttributes{testRecreate=true, testColor='white', testSize=7}");
+    //single recreation applies all attributes, handlers are not fired twice
+    TEST_EQUALS_INT(element->initCount, 2);
+    TEST_EQUALS_INT((int)element->handled.size(), 2);
+    TEST_EQUALS_WXSTR(element->getAttribute("testColor"), "white");
+    TEST_EQUALS_INT(element->getAttribute("testSize", 0), 7);
+    TEST_EQUALS_BOOL(element->isAttributeBatchActive(), false);
+
+    bool failed=false;
+    engine.getLua()->evalExpression("document:getElementById('batch'):setAttributes{testColor='black', unknownAttribute=1}", [&failed](bool state, wxString&result) {
+        failed=!state;
+    });
+    TEST_EQUALS_BOOL(failed, true);
+    TEST_EQUALS_BOOL(element->isAttributeBatchActive(), false);
+}
+
+void testDeferredRecreation() {
+    Engine engine;
+    std::vector<std::function<void()>>idleCallbacks;
+    engine.setIdleScheduler([&idleCallbacks](std::function<void()>callback) {
+        idleCallbacks.push_back(callback);
+    });
+    engine.registerTagFactory("Handlers", [](){return new HandlersTestElement();});
+    const char*source="<Handlers id='deferred' testColor='red'/>";
+    TagsParser parser(source, strlen(source), "test");
+    DomElementsBuilder builder(&engine, NULL, true);
+    parser.parse(&builder);
+    HandlersTestElement*element=dynamic_cast<HandlersTestElement*>(builder.getCreatedElements()[0]);
+    element->handled.clear();
+
+    engine.getLua()->evalExpression("local el=document:getElementById('deferred') el:setAttribute('testRecreate', true) el:setAttribute('testColor', 'blue') el:setAttribute('testRecreate', false)");
+    TEST_EQUALS_INT(element->initCount, 1);
+    TEST_EQUALS_INT((int)element->handled.size(), 0);
+    TEST_EQUALS_INT((int)idleCallbacks.size(), 1);
+    idleCallbacks[0]();
+    //both requests collapsed into one recreation that applied the new color
+    TEST_EQUALS_INT(element->initCount, 2);
+    TEST_EQUALS_INT((int)element->handled.size(), 1);
+    TEST_EQUALS_WXSTR(element->handled[0], "color:blue");
+
+    //reading attributes from script runs scheduled recreation before idle
+    engine.getLua()->evalExpression("local el=document:getElementById('deferred') el:setAttribute('testRecreate', true) readColor=el:getAttribute('testColor')");
+    TEST_EQUALS_INT(element->initCount, 3);
+    TEST_EQUALS_INT((int)idleCallbacks.size(), 2);
+    idleCallbacks[1]();
+    TEST_EQUALS_INT(element->initCount, 3);
+
+    engine.getLua()->evalExpression("local stats=lxe.getRecreationStats() requested=stats.requested avoided=stats.avoided");
+    TEST_EQUALS_INT(engine.getLua()->globalInt("requested"), 3);
+    TEST_EQUALS_INT(engine.getLua()->globalInt("avoided"), 1);
+}
+
+void testDeferredRecreation_RemovedAndFailing() {
+    Engine engine;
+    std::vector<std::function<void()>>idleCallbacks;
+    engine.setIdleScheduler([&idleCallbacks](std::function<void()>callback) {
+        idleCallbacks.push_back(callback);
+    });
+    engine.registerTagFactory("Handlers", [](){return new HandlersTestElement();});
+    HandlersTestElement*parent=dynamic_cast<HandlersTestElement*>(engine.createDomElement("Handlers"));
+    HandlersTestElement*child=dynamic_cast<HandlersTestElement*>(engine.createDomElement("Handlers"));
+    parent->addChild(child);
+    child->setParent(parent);
+    child->scheduleRecreation();
+    //recreation of descendant is dropped with removed ancestor
+    engine.removeDomElement(parent);
+    TEST_EQUALS_BOOL(child->isRecreationScheduled(), false);
+    TEST_EQUALS_INT((int)idleCallbacks.size(), 1);
+    idleCallbacks[0]();
+    TEST_EQUALS_INT(child->initCount, 0);
+
+    //failed recreation does not stop the others
+    HandlersTestElement*failing=dynamic_cast<HandlersTestElement*>(engine.createDomElement("Handlers"));
+    HandlersTestElement*other=dynamic_cast<HandlersTestElement*>(engine.createDomElement("Handlers"));
+    failing->failInit=true;
+    failing->scheduleRecreation();
+    other->scheduleRecreation();
+    TEST_EQUALS_INT((int)idleCallbacks.size(), 2);
+    idleCallbacks[1]();
+    TEST_EQUALS_INT(failing->initCount, 1);
+    TEST_EQUALS_INT(other->initCount, 1);
+    TEST_EQUALS_BOOL(other->isRecreationScheduled(), false);
+    delete parent;
+    delete child;
+    delete failing;
+    delete other;
+}
+
+static wxString joinIds(const std::vector<DomElement*>&elements) {
+    wxString result;
+    for(int i=0;i<elements.size();i++) {
+        if(i!=0) result+=",";
+        result+=elements[i]->getAttribute("id");
+    }
+    return result;
+}
+
+static wxString queryIds(Engine&engine, const wxString&selector) {
+    std::vector<DomElement*>elements;
+    engine.querySelectorAll(selector, elements);
+    return joinIds(elements);
+}
+
+///idle callbacks come from worker threads of async operations too
+class TestIdleQueue {
+    std::mutex mutex;
+    std::condition_variable added;
+    std::deque<std::function<void()>>callbacks;
+public:
+    void schedule(std::function<void()>callback) {
+        std::lock_guard<std::mutex>lock(mutex);
+        callbacks.push_back(callback);
+        added.notify_one();
+    }
+    ///runs callbacks on this thread until condition holds, false on timeout
+    bool runUntil(std::function<bool()>condition) {
+        auto deadline=std::chrono::steady_clock::now()+std::chrono::seconds(10);
+        while(!condition()) {
+            std::function<void()>callback;
+            {
+                std::unique_lock<std::mutex>lock(mutex);
+                if(!added.wait_until(lock, deadline, [this](){return !callbacks.empty();})) return false;
+                callback=callbacks.front();
+                callbacks.pop_front();
+            }
+            callback();
+        }
+        return true;
+    }
+};
+
+void testAsyncEventHandlers() {
+    std::filesystem::path file=std::filesystem::temp_directory_path()/"lxeAsyncTest.txt";
+    std::ofstream(file, std::ios::binary)<<std::string("file\0content", 12);
+    TestIdleQueue idleQueue;
+    std::vector<std::function<void()>>timers;
+    {
+        Engine engine;
+        engine.setIdleScheduler([&idleQueue](std::function<void()>callback) {
+            idleQueue.schedule(callback);
+        });
+        engine.getAsyncTasks().setTimerScheduler([&timers](int milliseconds, std::function<void()>callback) {
+            timers.push_back(callback);
+        });
+        engine.registerTagFactory("Handlers", [](){return new HandlersTestElement();});
+        engine.getLua()->evalExpression(wxString::Format(R"(
+           testFile=%s
+           function loadAll()
+               steps='start'
+               lxe.sleep(10)
+               steps=steps..',timer'
+               local content=lxe.await(lxe.readFileAsync(testFile))
+               fileContent=content
+               local missing, message=lxe.await(lxe.readFileAsync(testFile..'.missing'))
+               missingError=missing==nil and string.find(message, 'Cannot read file')~=nil
+               processOutput, processCode=lxe.await(lxe.processOutputAsync('echo async'))
+               steps=steps..',done'
+           end
+           function waitForever()
+               lxe.sleep(10)
+               afterCancel=true
+           end
+           function yieldWithoutAwait()
+               coroutine.yield()
+               afterYield=true
+           end
+           function touchElement()
+               local el=document:getElementById('asyncTarget')
+               beforeAwait=tostring(el:hasAttribute('id'))..','..el:getAttribute('id')..','..el.testColor
+               el:setAttribute('testColor', 'blue')
+               lxe.sleep(10)
+               el.testColor='green'
+               afterAwait=tostring(el.id)..','..el:getAttribute('testColor')
+           end
+           local ok, message=pcall(lxe.timer, 10)
+           outsideHandler=not ok and string.find(message, 'only in event handlers')~=nil
+        )", "'"+wxString(file.string())+"'"));
+        TEST_ASSERT(engine.getLua()->globalBool("outsideHandler"));
+
+        TagAttribute loadAll;
+        loadAll.setString("loadAll");
+        engine.runEventHandler(NULL, loadAll);
+        TEST_EQUALS_WXSTR(engine.getLua()->globalString("steps"), "start");
+        TEST_EQUALS_INT(engine.getAsyncTasks().getSuspendedCount(), 1);
+        TEST_EQUALS_INT((int)timers.size(), 1);
+        timers[0]();
+        TEST_EQUALS_WXSTR(engine.getLua()->globalString("steps"), "start,timer");
+        TEST_ASSERT(idleQueue.runUntil([&engine](){return engine.getAsyncTasks().getSuspendedCount()==0;}));
+        TEST_EQUALS_WXSTR(engine.getLua()->globalString("steps"), "start,timer,done");
+        //handler resumed after every await is one sample of handler duration
+        TEST_EQUALS_INT((int)engine.getGcScheduler().getHandlers().getCount(), 1);
+        Lua*lua=engine.getLua();
+        lua->evalExpression("fileContentMatches=fileContent=='file\\0content'");
+        TEST_ASSERT(lua->globalBool("fileContentMatches"));
+        TEST_ASSERT(lua->globalBool("missingError"));
+        TEST_EQUALS_WXSTR(lua->globalString("processOutput"), "async\n");
+        TEST_EQUALS_INT(lua->globalInt("processCode"), 0);
+        TEST_EQUALS_INT(engine.getAsyncTasks().getPendingOperationsCount(), 0);
+
+        //handler runs on its own thread, attributes are resolved on its stack before and after await
+        const char*source="<Handlers id='asyncTarget' testColor='red'/>";
+        TagsParser parser(source, strlen(source), "test");
+        DomElementsBuilder builder(&engine, NULL, true);
+        parser.parse(&builder);
+        HandlersTestElement*target=dynamic_cast<HandlersTestElement*>(builder.getCreatedElements()[0]);
+        target->handled.clear();
+        TagAttribute touchElement;
+        touchElement.setString("touchElement");
+        engine.runEventHandler(target, touchElement);
+        TEST_EQUALS_WXSTR(lua->globalString("beforeAwait"), "true,asyncTarget,red");
+        TEST_EQUALS_WXSTR(target->getAttribute("testColor"), "blue");
+        timers[1]();
+        TEST_EQUALS_WXSTR(lua->globalString("afterAwait"), "asyncTarget,green");
+        TEST_EQUALS_INT((int)target->handled.size(), 2);
+
+        //removing ancestor of owner cancels the task, its timer completes into nothing
+        DomElement*parent=engine.createDomElement("Handlers");
+        DomElement*child=engine.createDomElement("Handlers");
+        child->setParent(parent);
+        TagAttribute waitForever;
+        waitForever.setString("waitForever");
+        engine.runEventHandler(child, waitForever);
+        TEST_EQUALS_INT(engine.getAsyncTasks().getSuspendedCount(), 1);
+        engine.removeDomElement(parent);
+        TEST_EQUALS_INT(engine.getAsyncTasks().getSuspendedCount(), 0);
+        TEST_EQUALS_INT((int)engine.getAsyncTasks().getTasksCancelled(), 1);
+        timers[2]();
+        TEST_EQUALS_BOOL(lua->globalBool("afterCancel"), false);
+        TEST_EQUALS_INT(engine.getAsyncTasks().getPendingOperationsCount(), 0);
+
+        //only lxe.await may suspend handler
+        TagAttribute yieldWithoutAwait;
+        yieldWithoutAwait.setString("yieldWithoutAwait");
+        engine.runEventHandler(NULL, yieldWithoutAwait);
+        TEST_EQUALS_INT(engine.getAsyncTasks().getSuspendedCount(), 0);
+        TEST_EQUALS_BOOL(lua->globalBool("afterYield"), false);
+        TEST_EQUALS_INT((int)engine.getAsyncTasks().getTasksStarted(), 4);
+        delete parent;
+        delete child;
+    }
+    std::filesystem::remove(file);
+}
+
+void testQuerySelector() {
+    wxArrayString initLog;
+    Engine engine;
+    engine.registerTagFactory("Root", [&initLog](){return new TestContainerElement(&initLog, false);});
+    engine.registerTagFactory("Child", [&initLog](){return new TestContainerElement(&initLog, false);});
+    engine.registerTagFactory("Handlers", [](){return new HandlersTestElement();});
+    const char*source="<Root id='root'>"
+        "<Child id='main' class='panel main'><Handlers id='a' class='primary' testColor='red'/><Handlers id='b'/></Child>"
+        "<Child id='side' class='panel'><Handlers id='c' class='primary'/></Child>"
+        "</Root>";
+    TagsParser parser(source, strlen(source), "test");
+    DomElementsBuilder builder(&engine, NULL, true);
+    parser.parse(&builder);
+    TEST_EQUALS_INT(engine.getElementsIndex().getSize(), 6);
+
+    //missing id does not create entry
+    TEST_EQUALS_BOOL(engine.getDomElementById("missing")==NULL, true);
+    TEST_EQUALS_INT(engine.getElementsIndex().getSize(), 6);
+
+    TEST_EQUALS_WXSTR(queryIds(engine, "Handlers"), "a,b,c");
+    TEST_EQUALS_WXSTR(queryIds(engine, ".primary"), "a,c");
+    TEST_EQUALS_WXSTR(queryIds(engine, ".panel.main Handlers"), "a,b");
+    TEST_EQUALS_WXSTR(queryIds(engine, "Root #c"), "c");
+    TEST_EQUALS_WXSTR(queryIds(engine, "[testColor]"), "a");
+    TEST_EQUALS_WXSTR(queryIds(engine, "#side .primary, #b, Handlers[testColor]"), "a,b,c");
+    TEST_EQUALS_WXSTR(queryIds(engine, "* Child"), "main,side");
+    TEST_EQUALS_WXSTR(queryIds(engine, "Unknown, [unknownAttribute], .unknown"), "");
+    TEST_EQUALS_BOOL(engine.querySelector("Handlers.primary")==engine.getDomElementById("a"), true);
+    TEST_EQUALS_BOOL(engine.querySelector("Child Child")==NULL, true);
+
+    //indexes follow attributes set from script
+    engine.getLua()->evalExpression("document:getElementById('b'):setAttribute('class', 'primary') document:getElementById('c'):setAttribute('testColor', 'blue') document:getElementById('c'):setAttribute('id', 'z')");
+    TEST_EQUALS_WXSTR(queryIds(engine, ".primary"), "a,b,z");
+    TEST_EQUALS_WXSTR(queryIds(engine, "[testColor]"), "a,z");
+    TEST_EQUALS_BOOL(engine.getDomElementById("c")==NULL, true);
+    TEST_EQUALS_WXSTR(queryIds(engine, "#z"), "z");
+
+    engine.getLua()->evalExpression("panelsCount=#document:querySelectorAll('.panel') missingIsNil=document:querySelector('#missing')==nil and document:getElementById('missing')==nil");
+    TEST_EQUALS_INT(engine.getLua()->globalInt("panelsCount"), 2);
+    TEST_EQUALS_BOOL(engine.getLua()->globalBool("missingIsNil"), true);
+
+    //removed element leaves indexes together with its descendants
+    engine.removeDomElement(engine.getDomElementById("main"));
+    TEST_EQUALS_WXSTR(queryIds(engine, ".primary"), "z");
+    TEST_EQUALS_BOOL(engine.getDomElementById("a")==NULL, true);
+    TEST_EQUALS_INT(engine.getElementsIndex().getSize(), 3);
+
+    bool failed=false;
+    try {
+        engine.querySelector("Handlers[testColor");
+    } catch(RuntimeException&ex) {
+        failed=true;
+    }
+    TEST_EQUALS_BOOL(failed, true);
+}
+
+void testLazyLuaObjects() {
+    Engine engine;
+    engine.registerTagFactory("Handlers", [](){return new HandlersTestElement();});
+    const char*source="<Handlers id='first'/><Handlers id='second'/>";
+    TagsParser parser(source, strlen(source), "test");
+    DomElementsBuilder builder(&engine, NULL, false);
+    parser.parse(&builder);
+    DomElement*first=builder.getCreatedElements()[0];
+    DomElement*second=builder.getCreatedElements()[1];
+    TEST_EQUALS_BOOL(first->hasLuaRef(), false);
+    TEST_EQUALS_INT((int)engine.getLuaObjectsCreated(), 0);
+
+    //object is created on first access and reused after that
+    engine.getLua()->evalExpression("sameObject=document:getElementById('first')==document:getElementById('first') firstId=document:getElementById('first'):getAttribute('id')");
+    TEST_EQUALS_BOOL(engine.getLua()->globalBool("sameObject"), true);
+    TEST_EQUALS_WXSTR(engine.getLua()->globalString("firstId"), "first");
+    TEST_EQUALS_BOOL(first->hasLuaRef(), true);
+    TEST_EQUALS_BOOL(second->hasLuaRef(), false);
+    TEST_EQUALS_INT((int)engine.getLuaObjectsCreated(), 1);
+
+    //removing element that was never accessed from script does not create its object
+    engine.removeDomElement(second);
+    TEST_EQUALS_INT((int)engine.getLuaObjectsCreated(), 1);
+}
+
+void testDomElementFields() {
+    Engine engine;
+    engine.registerTagFactory("Handlers", [](){return new HandlersTestElement();});
+    const char*source="<Handlers id='fields' testColor='red'/>";
+    TagsParser parser(source, strlen(source), "test");
+    DomElementsBuilder builder(&engine, NULL, true);
+    parser.parse(&builder);
+    HandlersTestElement*element=dynamic_cast<HandlersTestElement*>(builder.getCreatedElements()[0]);
+    element->handled.clear();
+    Lua*lua=engine.getLua();
+
+    lua->evalExpression("local el=document:getElementById('fields') elementType=type(el) color=el.testColor el.testColor='blue' el.testSize=3 missing=el.testPlain==nil and el[1]==nil");
+    TEST_EQUALS_WXSTR(lua->globalString("elementType"), "userdata");
+    TEST_EQUALS_WXSTR(lua->globalString("color"), "red");
+    TEST_EQUALS_BOOL(lua->globalBool("missing"), true);
+    TEST_EQUALS_INT((int)element->handled.size(), 2);
+    TEST_EQUALS_WXSTR(element->handled[0], "color:blue");
+    TEST_EQUALS_WXSTR(element->handled[1], "size:3");
+    TEST_EQUALS_WXSTR(element->getAttribute("testColor"), "blue");
+
+    //methods are found before attributes, unknown attributes cannot be set
+    TEST_EQUALS_BOOL(lua->evalExpression("document:getElementById('fields'):setAttribute('testPlain', 'x')"), true);
+    TEST_EQUALS_BOOL(lua->evalExpression("document:getElementById('fields').unknownAttribute=1"), false);
+
+    //objects kept by scripts reject calls after element is removed
+    lua->evalExpression("keptElement=document:getElementById('fields')");
+    engine.removeDomElement(element);
+    TEST_EQUALS_BOOL(lua->evalExpression("return keptElement.testColor"), false);
+    TEST_EQUALS_BOOL(lua->evalExpression("keptElement:getAttribute('id')"), false);
+    TEST_EQUALS_BOOL(lua->evalExpression("lxe.DomElementPrototype.getAttribute({}, 'id')"), false);
+
+    //descendants are removed with their parent
+    wxArrayString initLog;
+    engine.registerTagFactory("Root", [&initLog](){return new TestContainerElement(&initLog, false);});
+    const char*treeSource="<Root id='tree'><Handlers id='nestedField' testColor='green'/></Root>";
+    TagsParser treeParser(treeSource, strlen(treeSource), "test");
+    DomElementsBuilder treeBuilder(&engine, NULL, true);
+    treeParser.parse(&treeBuilder);
+    lua->evalExpression("keptChild=document:getElementById('nestedField')");
+    TEST_EQUALS_BOOL(lua->evalExpression("return keptChild.testColor"), true);
+    engine.removeDomElement(treeBuilder.getCreatedElements()[0]);
+    TEST_EQUALS_BOOL(lua->evalExpression("return keptChild.testColor"), false);
+}
+
 ACUTEST_MODULE_INITIALIZER(lxe_module) {
     ACUTEST_ADD_TEST_(testSerializedFolderReader);
     ACUTEST_ADD_TEST_(testSerializedFolderReader_GetByPath);
+    ACUTEST_ADD_TEST_(testTokenizer_SpansPointToSource);
+    ACUTEST_ADD_TEST_(testTokenizer_NegativeNumbers);
+    ACUTEST_ADD_TEST_(testTagsParser_RawBuffer);
+    ACUTEST_ADD_TEST_(testScanDelimiters_MatchesScalar);
+    ACUTEST_ADD_TEST_(testTokenizer_LineNumbersAfterSkippedText);
+    ACUTEST_ADD_TEST_(testTagsParser_StreamingEvents);
+    ACUTEST_ADD_TEST_(testDomElementsBuilder_InitOrder);
+    ACUTEST_ADD_TEST_(testDomElementsBuilder_BrokenSourceLeavesNoElements);
+    ACUTEST_ADD_TEST_(testMonotonicArena);
+    ACUTEST_ADD_TEST_(testTagsParser_DocumentInArena);
+    ACUTEST_ADD_TEST_(testCompiledLxml_RoundTrip);
+    ACUTEST_ADD_TEST_(testCompiledLxml_EngineRunsBytecode);
+    ACUTEST_ADD_TEST_(testCompiledLxml_ScriptSyntaxError);
+    ACUTEST_ADD_TEST_(testLruCache);
+    ACUTEST_ADD_TEST_(testFragmentsCache_Lru);
+    ACUTEST_ADD_TEST_(testFragmentsCache_InnerLXML);
+    ACUTEST_ADD_TEST_(testStringParser_LineAndColumn);
+    ACUTEST_ADD_TEST_(testTagsParser_ErrorHasColumn);
+    ACUTEST_ADD_TEST_(testAtomTable);
+    ACUTEST_ADD_TEST_(testTagAttribute_CopyAndMove);
+    ACUTEST_ADD_TEST_(testAttributesStorage_MergedView);
+    ACUTEST_ADD_TEST_(testAttributesSchema);
+    ACUTEST_ADD_TEST_(testAttributeHandlers_DispatchById);
+    ACUTEST_ADD_TEST_(testAttributeBatch);
+    ACUTEST_ADD_TEST_(testDeferredRecreation);
+    ACUTEST_ADD_TEST_(testDeferredRecreation_RemovedAndFailing);
+    ACUTEST_ADD_TEST_(testQuerySelector);
+    ACUTEST_ADD_TEST_(testLazyLuaObjects);
+    ACUTEST_ADD_TEST_(testDomElementFields);
+    ACUTEST_ADD_TEST_(testStdLibIsPrecompiled);
+    ACUTEST_ADD_TEST_(testScriptBytecodeCache);
+    ACUTEST_ADD_TEST_(testMemoryStats);
+    ACUTEST_ADD_TEST_(testIdleGarbageCollection);
+    ACUTEST_ADD_TEST_(testIdleGarbageCollection_AfterEngineDestroyed);
+    ACUTEST_ADD_TEST_(testAsyncEventHandlers);
 }
 
 #endif
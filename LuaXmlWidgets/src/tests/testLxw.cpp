@@ -0,0 +1,45 @@
+//
+//  testLxw.cpp
+//  LuaXmlWidgets
+//
+
+#include "lxw.hpp"
+
+#ifdef LUA_XML_TEST
+
+#define TEST_NO_MAIN
+#include "accutestWrapper.hpp"
+
+void testResourcesCache() {
+    ResourcesCache cache;
+    wxColour red=cache.getColor("#ff0000", "bgcolor");
+    TEST_EQUALS_INT(red.Red(), 255);
+    long long misses=cache.getMisses();
+    long long hits=cache.getHits();
+    TEST_EQUALS_BOOL(cache.getColor("#ff0000", "bgcolor")==red, true);
+    TEST_EQUALS_INT((int)(cache.getHits()-hits), 1);
+    TEST_EQUALS_INT((int)(cache.getMisses()-misses), 0);
+    //wrong value throws and is not cached
+    bool failed=false;
+    try {
+        cache.getColor("notAColor", "bgcolor");
+    } catch(RuntimeException&ex) {
+        failed=true;
+    }
+    TEST_ASSERT(failed);
+    TEST_EQUALS_INT(cache.getSize(), 1);
+    //generated colors do not grow the cache over its limit
+    cache.setLimit(4);
+    for(int i=0;i<100;i++) {
+        cache.getColor(wxString::Format("#%02x0000", i), "bgcolor");
+    }
+    TEST_EQUALS_INT(cache.getSize(), 4);
+    cache.clear();
+    TEST_EQUALS_INT(cache.getSize(), 0);
+}
+
+ACUTEST_MODULE_INITIALIZER(lxw_module) {
+    ACUTEST_ADD_TEST_(testResourcesCache);
+}
+
+#endif
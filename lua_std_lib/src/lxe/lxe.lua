@@ -54,25 +54,72 @@ lxe = {
         end
     end,
 
+    -- innerLXML fragments are cached after parsing, limit is the max count of cached fragments(0 disables cache)
+    setFragmentCacheLimit = LuaWrapperFFI.Lxe_setFragmentCacheLimit,
+    -- returns table with hits, misses, evictions, size and limit of the fragment cache
+    getFragmentCacheStats = LuaWrapperFFI.Lxe_getFragmentCacheStats,
+    -- returns table with requested, performed and avoided counts of widget recreations, which are coalesced until idle
+    getRecreationStats = LuaWrapperFFI.Lxe_getRecreationStats,
+    -- returns table with live, peak and pool bytes of Lua heap of the engine, count of allocations, allocated bytes
+    -- and allocationRate in bytes per second since the engine started
+    memoryStats = LuaWrapperFFI.Lxe_getMemoryStats,
+    -- sets collector policy from table, missing fields keep current values:
+    -- mode("incremental" or "generational"), pause, stepMultiplier, stepSize, minorMultiplier, majorMultiplier
+    -- (0 is Lua default), idleBudgetMs(time of collector work per idle slice, 0 disables it) and
+    -- deferDuringEvents(collector is stopped while event handlers run)
+    configureGc = LuaWrapperFFI.Lxe_configureGc,
+    -- returns table with counts and durations in milliseconds of idle collector slices and event handlers,
+    -- percentiles are computed from the last 1024 samples
+    gcStats = LuaWrapperFFI.Lxe_getGcStats,
+
+    -- widget event handlers run as coroutines and can wait for async operations without blocking the window.
+    -- Operations belong to the handler that started them, handler is cancelled when its element is removed.
+    -- await suspends handler until operation completes and returns results of the operation
+    await = function(operation)
+        LuaWrapperFFI.Lxe_await(coroutine.running(), operation)
+        return coroutine.yield()
+    end,
+    -- operation completing after milliseconds
+    timer = function(milliseconds)
+        return LuaWrapperFFI.Lxe_startTimer(coroutine.running(), milliseconds)
+    end,
+    sleep = function(milliseconds)
+        return lxe.await(lxe.timer(milliseconds))
+    end,
+    -- reads file on worker thread, await returns its content or nil and error message
+    readFileAsync = function(path)
+        return LuaWrapperFFI.Lxe_startFileRead(coroutine.running(), path)
+    end,
+    -- runs shell command on worker thread, await returns its output and exit code or nil and error message
+    processOutputAsync = function(command)
+        return LuaWrapperFFI.Lxe_startProcessOutput(coroutine.running(), command)
+    end,
+
     newInheritedTable = function(baseTable)
         o = {__index = baseTable}
         setmetatable(o, baseTable)
         return o
     end,
     
+    -- methods of dom elements. Elements are userdata, their other fields are attributes: el.text = "x"
     DomElementPrototype = {
         getAttribute = LuaWrapperFFI.DomElementPrototype_getAttribute,
         setAttribute = LuaWrapperFFI.DomElementPrototype_setAttribute,
+        -- sets all attributes from table, element is recreated and each change handler runs at most once
+        setAttributes = LuaWrapperFFI.DomElementPrototype_setAttributes,
         hasAttribute = LuaWrapperFFI.DomElementPrototype_hasAttribute
      --   createElement = LuaWrapperFFI.ffi_DomElementPrototype_createElement,
      --   remove = LuaWrapperFFI.ffi_DomElementPrototype_remove
     }
 }
 
-lxe.DomElementPrototype.__index = lxe.DomElementPrototype
-
 
 document = {
-    getElementById = LuaWrapperFFI.Document_getElementById
+    -- returns nil when no element has the id
+    getElementById = LuaWrapperFFI.Document_getElementById,
+    -- selectors support tag names, #id, .class and [attribute], e.g. "Panel .primary[onClick]", alternatives separated by comma
+    querySelector = LuaWrapperFFI.Document_querySelector,
+    -- returns array of matching elements in order they were added to document
+    querySelectorAll = LuaWrapperFFI.Document_querySelectorAll
 }
 
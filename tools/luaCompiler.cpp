@@ -0,0 +1,40 @@
+// Compiles Lua source file to stripped bytecode. It is built from the same minilua.hpp as the library,
+// so produced chunks always match the Lua version and number sizes of the application.
+//
+// Usage: luaCompiler input.lua output.luac
+//C++ headers have to come before minilua.hpp, it includes C headers inside extern "C" and defines short macros
+#include <cstdio>
+#include <cmath>
+#define LUA_IMPL
+#include "../LuaXmlWidgets/src/minilua.hpp"
+
+static int writeChunk(lua_State*state, const void*data, size_t size, void*userData) {
+    return fwrite(data, 1, size, (FILE*)userData)!=size;
+}
+
+int main(int argc, char**argv) {
+    if(argc!=3) {
+        fprintf(stderr, "Usage: luaCompiler input.lua output.luac\n");
+        return 1;
+    }
+    lua_State*state=luaL_newstate();
+    if(luaL_loadfile(state, argv[1])!=LUA_OK) {
+        fprintf(stderr, "%s\n", lua_tostring(state, -1));
+        lua_close(state);
+        return 1;
+    }
+    FILE*output=fopen(argv[2], "wb");
+    if(output==NULL) {
+        fprintf(stderr, "Cannot write file '%s'\n", argv[2]);
+        lua_close(state);
+        return 1;
+    }
+    int status=lua_dump(state, writeChunk, output, 1);
+    if(fclose(output)!=0 || status!=0) {
+        fprintf(stderr, "Cannot write file '%s'\n", argv[2]);
+        lua_close(state);
+        return 1;
+    }
+    lua_close(state);
+    return 0;
+}
@@ -1,11 +1,38 @@
+import os
+import shutil
 import subprocess
+import sys
+
+SOURCE_DIR = "./lua_std_lib/src"
+PRECOMPILED_DIR = "./lua_std_lib/generated/precompiled"
+COMPILER = "./lua_std_lib/generated/luaCompiler" + (".exe" if os.name == "nt" else "")
 
 
 # This script is used to generate the lua standard library file tree
+# .lua files are embedded as stripped bytecode, pass --source to embed them as text, for example to see line numbers
+# in errors of the standard library. C++ compiler is taken from CXX environment variable, default is c++
 def main():
-    execute(["python3", "./tools/fileTreeSerializer.py", "-s", "./lua_std_lib/src", "./lua_std_lib/generated/lua_std_lib.dat"])
+    tree = SOURCE_DIR if "--source" in sys.argv else precompile()
+    execute(["python3", "./tools/fileTreeSerializer.py", "-s", tree, "./lua_std_lib/generated/lua_std_lib.dat"])
     execute(["python3", "./tools/binToC.py", "-i", "./lua_std_lib/generated/lua_std_lib.dat", "-o", "./lua_std_lib/generated/lua_std_lib.hpp", "-v", "LUA_STD_LIB"])
 
+# Copies the tree to PRECOMPILED_DIR with .lua files replaced by bytecode under the same names, so require paths do not change
+def precompile():
+    os.makedirs(os.path.dirname(COMPILER), exist_ok=True)
+    execute([os.environ.get("CXX", "c++"), "-std=c++17", "-O1", "-w", "-o", COMPILER, "./tools/luaCompiler.cpp", "-lm"])
+    shutil.rmtree(PRECOMPILED_DIR, ignore_errors=True)
+    for root, dirs, files in os.walk(SOURCE_DIR):
+        target_root = os.path.join(PRECOMPILED_DIR, os.path.relpath(root, SOURCE_DIR))
+        os.makedirs(target_root, exist_ok=True)
+        for name in files:
+            source = os.path.join(root, name)
+            target = os.path.join(target_root, name)
+            if name.endswith(".lua"):
+                execute([COMPILER, source, target])
+            else:
+                shutil.copyfile(source, target)
+    return PRECOMPILED_DIR
+
 def execute(args):
     try:
         # Start the external application